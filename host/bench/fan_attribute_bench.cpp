@@ -0,0 +1,327 @@
+/*
+  Attribute traffic benchmark for MatterMultiSpeedFan.
+
+  Runs every public operation of the fan endpoint (and the controller writes
+  that reach attributeChangeCB) against the host esp_matter store and records
+  the data model calls each one makes:
+
+    set        attribute::set_val()      (setAttributeVal)
+    update     attribute::update()       (updateAttributeVal / controller write)
+    report     attribute::report()       (explicit reports)
+    dirty      attributes marked changed for subscribers (update() + report())
+    callbacks  PRE_UPDATE callbacks into attributeChangeCB()
+    reentrant  callbacks that ran while another attributeChangeCB() was active
+
+  Counts are per operation, together with the time per operation. With a budget
+  file the run fails (exit code 1) when an operation exceeds its budget, so a
+  change that adds Matter round trips shows up before it reaches a device.
+
+  Usage:
+    fan-attribute-bench [--budget FILE] [--iterations N] [--no-time] [--write-budget FILE]
+
+    --budget        check against this budget (see attribute_budget.txt)
+    --iterations    calls per operation (default 10000)
+    --no-time       only check the call counts (for noisy CI machines)
+    --write-budget  write the measured counts as a new budget file
+*/
+
+#include <Matter.h>
+#include <MatterMultiSpeedFan.h>
+
+#include <chrono>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace chip::app::Clusters;
+
+struct CallCounts {
+  uint64_t setVal = 0;
+  uint64_t update = 0;
+  uint64_t report = 0;
+  uint64_t dirty = 0;
+  uint64_t callbacks = 0;
+  uint64_t reentrant = 0;
+};
+
+struct BenchOperation {
+  const char *name;
+  // Bring the fan into the state the operation starts from (not measured)
+  std::function<void(MatterMultiSpeedFan &fan)> prepare;
+  // One call; i alternates the target so every call is a real change
+  std::function<void(MatterMultiSpeedFan &fan, uint32_t i)> run;
+};
+
+struct BenchResult {
+  std::string name;
+  double setVal;
+  double update;
+  double report;
+  double dirty;
+  double callbacks;
+  double reentrant;
+  double nsPerOp;
+};
+
+struct BenchBudget {
+  std::string name;
+  double limits[6];  // set, update, report, dirty, callbacks, reentrant
+  double maxNs;      // < 0: not checked
+};
+
+static CallCounts gCounts;
+
+static void recordCall(esp_matter::host::call_t call, uint16_t, uint32_t, uint32_t, uint8_t depth) {
+  switch (call) {
+    case esp_matter::host::CALL_SET_VAL:
+      gCounts.setVal++;
+      break;
+    case esp_matter::host::CALL_UPDATE:
+      gCounts.update++;
+      break;
+    case esp_matter::host::CALL_REPORT:
+      gCounts.report++;
+      break;
+    case esp_matter::host::CALL_PRE_UPDATE:
+      gCounts.callbacks++;
+      gCounts.reentrant += depth > 1 ? 1 : 0;
+      break;
+  }
+}
+
+// A controller write arrives through the data model exactly like attribute::update()
+static void controllerWrite(MatterMultiSpeedFan &fan, uint32_t attributeId, uint8_t value) {
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_UINT8;
+  val.val.u8 = value;
+  esp_matter::attribute::update(fan.getEndPointId(), FanControl::Id, attributeId, &val);
+}
+
+static void startAtMediumSpeed(MatterMultiSpeedFan &fan) {
+  fan.setSpeed(FAN_SPEED_MEDIUM, false);
+}
+
+static std::vector<BenchOperation> benchOperations() {
+  auto idle = [](MatterMultiSpeedFan &) {};
+  return {
+    {"setSpeed.update", idle, [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setSpeed(i % 2 ? FAN_SPEED_LOW : FAN_SPEED_HIGH, true); }},
+    {"setSpeed.set", idle, [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setSpeed(i % 2 ? FAN_SPEED_LOW : FAN_SPEED_HIGH, false); }},
+    {"setOnOff.update", idle, [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setOnOff(i % 2 == 0, true); }},
+    {"setOnOff.set", idle, [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setOnOff(i % 2 == 0, false); }},
+    {"toggle.update", idle, [](MatterMultiSpeedFan &fan, uint32_t) { fan.toggle(true); }},
+    {"toggle.set", idle, [](MatterMultiSpeedFan &fan, uint32_t) { fan.toggle(false); }},
+    {"setRockSetting.update", startAtMediumSpeed,
+     [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setRockSetting(i % 2 ? 0 : ROCK_SETTING_LEFT_RIGHT, true); }},
+    {"setRockSetting.set", startAtMediumSpeed,
+     [](MatterMultiSpeedFan &fan, uint32_t i) { fan.setRockSetting(i % 2 ? 0 : ROCK_SETTING_LEFT_RIGHT, false); }},
+    {"applyActuationPlan", idle,
+     [](MatterMultiSpeedFan &fan, uint32_t i) {
+       FanActuationPlan plan;
+       plan.hasSpeed = true;
+       plan.speed = i % 2 ? FAN_SPEED_LOW : FAN_SPEED_HIGH;
+       plan.hasRock = true;
+       plan.rockSetting = i % 2 ? 0 : ROCK_SETTING_LEFT_RIGHT;
+       fan.applyActuationPlan(plan);
+     }},
+    {"write.SpeedSetting", idle,
+     [](MatterMultiSpeedFan &fan, uint32_t i) {
+       controllerWrite(fan, FanControl::Attributes::SpeedSetting::Id, i % 2 ? FAN_SPEED_LOW : FAN_SPEED_HIGH);
+     }},
+    {"write.RockSetting", startAtMediumSpeed,
+     [](MatterMultiSpeedFan &fan, uint32_t i) {
+       controllerWrite(fan, FanControl::Attributes::RockSetting::Id, i % 2 ? 0 : ROCK_SETTING_LEFT_RIGHT);
+     }},
+    {"write.FanMode", idle,
+     [](MatterMultiSpeedFan &fan, uint32_t i) {
+       FanControl::FanModeEnum mode = i % 2 ? FanControl::FanModeEnum::kLow : FanControl::FanModeEnum::kHigh;
+       controllerWrite(fan, FanControl::Attributes::FanMode::Id, static_cast<uint8_t>(mode));
+     }},
+    {"write.PercentSetting", idle,
+     [](MatterMultiSpeedFan &fan, uint32_t i) { controllerWrite(fan, FanControl::Attributes::PercentSetting::Id, i % 2 ? 33 : 100); }},
+    // Three local steps while the hardware is still moving, then one flush once it has settled
+    {"pulseTrain.windowed", [](MatterMultiSpeedFan &fan) { fan.setReportWindow(1000); },
+     [](MatterMultiSpeedFan &fan, uint32_t i) {
+       fan.setActuationSettled(false);
+       for (uint8_t step = 1; step <= 3; step++) {
+         fan.setSpeed(i % 2 ? FAN_SPEED_HIGH - step : step, false);
+         fan.loop();
+       }
+       fan.setActuationSettled(true);
+       fan.loop();
+     }},
+  };
+}
+
+static BenchResult runOperation(const BenchOperation &operation, uint32_t iterations) {
+  // Fresh node and endpoint per operation, with hardware callbacks like main.cpp registers
+  esp_matter::host::reset();
+  std::unique_ptr<MatterMultiSpeedFan> fan(new MatterMultiSpeedFan());
+  fan->begin(FAN_SPEED_HIGH, ROCK_LEFT_RIGHT);
+  fan->onChangeSpeed([](uint8_t) { return true; });
+  fan->onChangeRock([](uint8_t) { return true; });
+  operation.prepare(*fan);
+
+  gCounts = CallCounts();
+  esp_matter::host::set_call_hook(recordCall);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    operation.run(*fan, i);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  esp_matter::host::set_call_hook(nullptr);
+
+  double n = iterations;
+  return {operation.name,
+          gCounts.setVal / n,
+          gCounts.update / n,
+          gCounts.report / n,
+          gCounts.dirty / n,
+          gCounts.callbacks / n,
+          gCounts.reentrant / n,
+          std::chrono::duration<double, std::nano>(elapsed).count() / n};
+}
+
+// ============================================================================
+// Budget file
+// ============================================================================
+
+static bool readBudget(const char *path, std::vector<BenchBudget> &budgets) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  char line[256];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    lineNumber++;
+    if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+      continue;
+    }
+    char name[64];
+    char maxNs[32];
+    BenchBudget budget;
+    if (sscanf(line, "%63s %lf %lf %lf %lf %lf %lf %31s", name, &budget.limits[0], &budget.limits[1], &budget.limits[2],
+               &budget.limits[3], &budget.limits[4], &budget.limits[5], maxNs) != 8) {
+      fprintf(stderr, "%s:%d: expected: operation set update report dirty callbacks reentrant max_ns\n", path, lineNumber);
+      fclose(file);
+      return false;
+    }
+    budget.name = name;
+    budget.maxNs = strcmp(maxNs, "-") == 0 ? -1 : atof(maxNs);
+    budgets.push_back(budget);
+  }
+  fclose(file);
+  return true;
+}
+
+static bool writeBudget(const char *path, const std::vector<BenchResult> &results) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  fprintf(file, "# Attribute traffic budget for host/bench (per operation, see fan_attribute_bench.cpp)\n");
+  fprintf(file, "# Lower a count when a change removes calls; raising one needs a reason in the commit.\n");
+  fprintf(file, "# max_ns is deliberately loose (10x a desktop run); use --no-time on slow machines.\n");
+  fprintf(file, "# %-22s %5s %6s %6s %5s %9s %9s %8s\n", "operation", "set", "update", "report", "dirty", "callbacks",
+          "reentrant", "max_ns");
+  for (const BenchResult &r : results) {
+    double maxNs = ceil(r.nsPerOp * 10 / 1000) * 1000;
+    fprintf(file, "%-24s %5g %6g %6g %5g %9g %9g %8.0f\n", r.name.c_str(), r.setVal, r.update, r.report, r.dirty,
+            r.callbacks, r.reentrant, maxNs);
+  }
+  fclose(file);
+  printf("Budget written to %s\n", path);
+  return true;
+}
+
+static int checkBudget(const std::vector<BenchResult> &results, const std::vector<BenchBudget> &budgets, bool checkTime) {
+  static const char *kColumns[] = {"set", "update", "report", "dirty", "callbacks", "reentrant"};
+  int failures = 0;
+  for (const BenchResult &r : results) {
+    const BenchBudget *budget = nullptr;
+    for (const BenchBudget &b : budgets) {
+      if (b.name == r.name) {
+        budget = &b;
+      }
+    }
+    if (budget == nullptr) {
+      printf("FAIL %s: no budget\n", r.name.c_str());
+      failures++;
+      continue;
+    }
+    const double measured[] = {r.setVal, r.update, r.report, r.dirty, r.callbacks, r.reentrant};
+    for (int c = 0; c < 6; c++) {
+      if (measured[c] > budget->limits[c]) {
+        printf("FAIL %s: %s %g > budget %g\n", r.name.c_str(), kColumns[c], measured[c], budget->limits[c]);
+        failures++;
+      }
+    }
+    if (checkTime && budget->maxNs >= 0 && r.nsPerOp > budget->maxNs) {
+      printf("FAIL %s: %.0f ns/op > budget %.0f ns/op\n", r.name.c_str(), r.nsPerOp, budget->maxNs);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+int main(int argc, char *argv[]) {
+  const char *budgetPath = nullptr;
+  const char *writeBudgetPath = nullptr;
+  uint32_t iterations = 10000;
+  bool checkTime = true;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+      budgetPath = argv[++i];
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--no-time") == 0) {
+      checkTime = false;
+    } else if (strcmp(argv[i], "--write-budget") == 0 && i + 1 < argc) {
+      writeBudgetPath = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--budget FILE] [--iterations N] [--no-time] [--write-budget FILE]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (iterations < 2) {
+    fprintf(stderr, "--iterations must be at least 2\n");
+    return 1;
+  }
+
+  // Warnings from the fan code would otherwise dominate the timing
+  hostSetLogLevel(HOST_LOG_ERROR);
+  esp_matter::host::set_report_hook([](uint16_t, uint32_t, uint32_t) { gCounts.dirty++; });
+
+  std::vector<BenchResult> results;
+  printf("%-24s %5s %6s %6s %5s %9s %9s %10s\n", "operation", "set", "update", "report", "dirty", "callbacks", "reentrant",
+         "ns/op");
+  for (const BenchOperation &operation : benchOperations()) {
+    BenchResult r = runOperation(operation, iterations);
+    printf("%-24s %5g %6g %6g %5g %9g %9g %10.0f\n", r.name.c_str(), r.setVal, r.update, r.report, r.dirty, r.callbacks,
+           r.reentrant, r.nsPerOp);
+    results.push_back(r);
+  }
+
+  if (writeBudgetPath != nullptr && !writeBudget(writeBudgetPath, results)) {
+    return 1;
+  }
+  if (budgetPath == nullptr) {
+    return 0;
+  }
+
+  std::vector<BenchBudget> budgets;
+  if (!readBudget(budgetPath, budgets)) {
+    return 1;
+  }
+  int failures = checkBudget(results, budgets, checkTime);
+  printf("%s: %d operation%s checked against %s, %d over budget\n", failures == 0 ? "PASS" : "FAIL", (int)results.size(),
+         results.size() == 1 ? "" : "s", budgetPath, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Compare two on-device benchmark reports of the smart fan.
+
+The firmware prints a report after the "bench" serial command (or three BOOT
+button presses): a block of lines starting with "FANBEN v1", e.g.
+
+  FANBEN v1 meta fw=1.4.0 idf=v5.1.4 chip=esp32c6 cpu_mhz=160 iterations=100
+  FANBEN v1 update_us min=41 mean=47 max=118 n=100
+  FANBEN v1 speed_high_us min=200012 mean=200410 max=200987 n=4
+  FANBEN v1 speed_high_us nominal=200000
+  FANBEN v1 end
+
+Save the serial output of a run on each firmware version (any other log lines
+may stay in the file; the last complete report is used) and compare them:
+
+  - timings (min/mean/max): the candidate's mean or max is a regression when
+    it grows by more than --threshold percent and by more than --min-us
+  - pulse widths (metrics with a nominal value): every captured width of the
+    candidate must lie within --tolerance percent of the nominal width, and a
+    loopback that captured nothing fails
+
+Exits with 1 on any regression, 2 when a file holds no complete report.
+
+Example:
+  pio device monitor -e esp32-c6-devkitc-1 | tee candidate.log     # then type "bench"
+  ./fanben_compare.py baseline.log candidate.log --threshold 20
+"""
+
+import argparse
+import sys
+
+PREFIX = "FANBEN v1 "
+
+
+def parse_report(path):
+    """Return (meta, metrics) of the last complete report in a log file."""
+    reports = []
+    current = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            index = line.find(PREFIX)
+            if index < 0:
+                continue
+            fields = line[index + len(PREFIX):].split()
+            if not fields:
+                continue
+            name = fields[0]
+            if name == "meta":
+                current = {"meta": {}, "metrics": {}}
+            if current is None:
+                continue
+            if name == "end":
+                reports.append(current)
+                current = None
+                continue
+            target = current["meta"] if name == "meta" else current["metrics"].setdefault(name, {})
+            for field in fields[1:]:
+                key, _, value = field.partition("=")
+                if name == "meta":
+                    target[key] = value
+                else:
+                    try:
+                        target[key] = int(value)
+                    except ValueError:
+                        target[key] = value
+    if not reports:
+        return None
+    return reports[-1]["meta"], reports[-1]["metrics"]
+
+
+def describe(meta):
+    return " ".join(f"{key}={meta[key]}" for key in ("fw", "idf", "chip", "cpu_mhz") if key in meta)
+
+
+def compare_timing(name, base, cand, threshold, min_us):
+    problems = []
+    for key in ("mean", "max"):
+        if key not in base or key not in cand:
+            continue
+        before, after = base[key], cand[key]
+        if after - before > min_us and after > before * (1 + threshold / 100.0):
+            change = (after - before) * 100.0 / before if before else float("inf")
+            problems.append(f"{name} {key}: {before} -> {after} us (+{change:.0f}%)")
+    return problems
+
+
+def check_width(name, cand, tolerance):
+    nominal = cand.get("nominal", 0)
+    if cand.get("n", 0) == 0:
+        return [f"{name}: no edges captured (is the loopback wired?)"]
+    problems = []
+    for key in ("min", "max"):
+        deviation = abs(cand[key] - nominal) * 100.0 / nominal
+        if deviation > tolerance:
+            problems.append(f"{name} {key}: {cand[key]} us, nominal {nominal} us ({deviation:.1f}% off)")
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline", help="log with the report of the reference firmware")
+    parser.add_argument("candidate", help="log with the report of the firmware under test")
+    parser.add_argument("--threshold", type=float, default=20.0, help="allowed timing growth in percent")
+    parser.add_argument("--min-us", type=int, default=5, help="ignore timing growth up to this many microseconds")
+    parser.add_argument("--tolerance", type=float, default=5.0, help="allowed pulse width deviation in percent")
+    args = parser.parse_args()
+
+    parsed = []
+    for path in (args.baseline, args.candidate):
+        report = parse_report(path)
+        if report is None:
+            print(f"{path}: no complete FANBEN report found", file=sys.stderr)
+            return 2
+        parsed.append(report)
+    (base_meta, base), (cand_meta, cand) = parsed
+
+    print(f"baseline:  {describe(base_meta)}")
+    print(f"candidate: {describe(cand_meta)}")
+    if base_meta.get("cpu_mhz") != cand_meta.get("cpu_mhz") or base_meta.get("chip") != cand_meta.get("chip"):
+        print("warning: reports come from different chips or clock speeds")
+    if base.get("locking") != cand.get("locking"):
+        print("warning: the attribute timings were measured with different CHIP stack locking")
+
+    print(f"{'metric':<16}{'base mean':>11}{'cand mean':>11}{'base max':>11}{'cand max':>11}")
+    problems = []
+    for name in sorted(set(base) | set(cand)):
+        b, c = base.get(name, {}), cand.get(name, {})
+        if "mean" in b or "mean" in c:
+            print(f"{name:<16}{b.get('mean', '-'):>11}{c.get('mean', '-'):>11}{b.get('max', '-'):>11}{c.get('max', '-'):>11}")
+        if "nominal" in c:
+            problems += check_width(name, c, args.tolerance)
+        elif b and c:
+            problems += compare_timing(name, b, c, args.threshold, args.min_us)
+        elif not c and "mean" in b:
+            print(f"warning: {name} missing from the candidate report")
+
+    if problems:
+        print("\nREGRESSION:")
+        for problem in problems:
+            print(f"  {problem}")
+        return 1
+    print("\nPASS: no regression")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,34 @@
+#pragma once
+
+// Benchmark stand-in for the generated CHIP header: only the enums the fan endpoint uses.
+
+#include <cstdint>
+
+namespace chip {
+namespace app {
+namespace Clusters {
+namespace FanControl {
+
+enum class FanModeEnum : uint8_t {
+  kOff = 0,
+  kLow = 1,
+  kMedium = 2,
+  kHigh = 3,
+  kOn = 4,
+  kAuto = 5,
+  kSmart = 6,
+};
+
+enum class FanModeSequenceEnum : uint8_t {
+  kOffLowMedHigh = 0,
+  kOffLowHigh = 1,
+  kOffLowMedHighAuto = 2,
+  kOffLowHighAuto = 3,
+  kOffHighAuto = 4,
+  kOffHigh = 5,
+};
+
+} // namespace FanControl
+} // namespace Clusters
+} // namespace app
+} // namespace chip
@@ -0,0 +1,36 @@
+#pragma once
+
+// Benchmark stand-in for the generated CHIP header: only the attributes the fan endpoint uses.
+
+#include <cstdint>
+
+namespace chip {
+namespace app {
+namespace Clusters {
+
+namespace FanControl {
+namespace Attributes {
+namespace FanMode { static constexpr uint32_t Id = 0x0000; }
+namespace FanModeSequence { static constexpr uint32_t Id = 0x0001; }
+namespace PercentSetting { static constexpr uint32_t Id = 0x0002; }
+namespace PercentCurrent { static constexpr uint32_t Id = 0x0003; }
+namespace SpeedMax { static constexpr uint32_t Id = 0x0004; }
+namespace SpeedSetting { static constexpr uint32_t Id = 0x0005; }
+namespace SpeedCurrent { static constexpr uint32_t Id = 0x0006; }
+namespace RockSupport { static constexpr uint32_t Id = 0x0007; }
+namespace RockSetting { static constexpr uint32_t Id = 0x0008; }
+namespace FeatureMap { static constexpr uint32_t Id = 0xFFFC; }
+namespace ClusterRevision { static constexpr uint32_t Id = 0xFFFD; }
+} // namespace Attributes
+} // namespace FanControl
+
+namespace BridgedDeviceBasicInformation {
+namespace Attributes {
+namespace Reachable { static constexpr uint32_t Id = 0x0011; }
+namespace ClusterRevision { static constexpr uint32_t Id = 0xFFFD; }
+} // namespace Attributes
+} // namespace BridgedDeviceBasicInformation
+
+} // namespace Clusters
+} // namespace app
+} // namespace chip
@@ -0,0 +1,21 @@
+#pragma once
+
+// Benchmark stand-in for the generated CHIP header: only the clusters the fan endpoint uses.
+
+#include <cstdint>
+
+namespace chip {
+namespace app {
+namespace Clusters {
+
+namespace FanControl {
+static constexpr uint32_t Id = 0x0202;
+} // namespace FanControl
+
+namespace BridgedDeviceBasicInformation {
+static constexpr uint32_t Id = 0x0039;
+} // namespace BridgedDeviceBasicInformation
+
+} // namespace Clusters
+} // namespace app
+} // namespace chip
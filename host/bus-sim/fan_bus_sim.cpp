@@ -0,0 +1,406 @@
+/*
+  Fan bus simulator.
+
+  Plays N fan controllers on the fan bus behind a pseudo terminal, so the
+  bridge (the Linux app in bridge mode, or a real ESP32 through a USB-UART
+  adapter) can be exercised without hardware. Fans answer DISCOVER with their
+  capabilities and POLL in their reply slot, only when their state changed,
+  a command was applied or a reply was forced - exactly like the firmware on
+  the bus devices is expected to.
+
+  Usage:
+    fan-bus-sim [--fans N] [--link PATH] [--button-interval MS] [--loss PERCENT]
+    fan-bus-sim --self-test
+
+    --fans             number of fans, on bus addresses 1..N (default 4)
+    --link             symlink to the pty slave, e.g. /tmp/fan-bus (default: print it only)
+    --button-interval  press a random fan's speed button every MS (default 0 = never)
+    --loss             drop this percentage of replies (exercises retries and Reachable)
+    --self-test        run FanBusMaster in-process against the simulated fans over a
+                       socket pair, with commands written while a poll is on the bus
+                       and from a second thread; exit code 1 on failure
+*/
+
+#include <FanBusMaster.h>
+#include <FanBusProtocol.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <sys/socket.h>
+#include <thread>
+
+struct SimulatedBusFan {
+  uint8_t address;
+  uint8_t speedMax;
+  uint8_t rockSupport;
+  FanBusState state;
+};
+
+static std::atomic<bool> gRunning(true);
+static uint32_t gFramesReceived = 0;
+static uint32_t gRepliesSent = 0;
+static uint32_t gRepliesDropped = 0;
+
+static uint64_t nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void sleepUntilUs(uint64_t deadlineUs) {
+  uint64_t now = nowUs();
+  if (deadlineUs > now) {
+    usleep((useconds_t)(deadlineUs - now));
+  }
+}
+
+static int openPty(const char *linkPath) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+    perror("posix_openpt");
+    return -1;
+  }
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio);
+
+  const char *slave = ptsname(fd);
+  printf("Fan bus on %s\n", slave);
+  if (linkPath != nullptr) {
+    unlink(linkPath);
+    if (symlink(slave, linkPath) != 0) {
+      perror("symlink");
+      return -1;
+    }
+    printf("Linked %s -> %s\n", linkPath, slave);
+  }
+  fflush(stdout);
+  return fd;
+}
+
+static void sendFrame(int fd, const uint8_t *frame, size_t length, uint32_t lossPercent) {
+  if (lossPercent > 0 && (uint32_t)(rand() % 100) < lossPercent) {
+    gRepliesDropped++;
+    return;
+  }
+  if (write(fd, frame, length) == (ssize_t)length) {
+    gRepliesSent++;
+  }
+}
+
+static SimulatedBusFan *findFan(SimulatedBusFan *fans, int count, uint8_t address) {
+  for (int i = 0; i < count; i++) {
+    if (fans[i].address == address) {
+      return &fans[i];
+    }
+  }
+  return nullptr;
+}
+
+static void handleFrame(int fd, const FanBusFrame &frame, SimulatedBusFan *fans, int count, uint64_t frameEndUs, uint32_t lossPercent) {
+  uint8_t out[FAN_BUS_MAX_FRAME];
+
+  if (frame.command == FAN_BUS_CMD_DISCOVER) {
+    SimulatedBusFan *fan = findFan(fans, count, frame.address);
+    if (fan != nullptr) {
+      FanBusInfo info = {fan->speedMax, fan->rockSupport, fan->state};
+      sendFrame(fd, out, fanBusEncodeInfo(fan->address, info, out, sizeof(out)), lossPercent);
+    }
+    return;
+  }
+
+  if (frame.command != FAN_BUS_CMD_POLL) {
+    return;
+  }
+  FanBusPollEntry entries[FAN_BUS_MAX_DEVICES];
+  uint8_t entryCount = fanBusDecodePoll(frame, entries, FAN_BUS_MAX_DEVICES);
+  for (uint8_t slot = 0; slot < entryCount; slot++) {
+    const FanBusPollEntry &entry = entries[slot];
+    SimulatedBusFan *fan = findFan(fans, count, entry.address);
+    if (fan == nullptr) {
+      continue;
+    }
+
+    bool commanded = (entry.flags & (FAN_BUS_POLL_SET_SPEED | FAN_BUS_POLL_SET_ROCK)) != 0;
+    if ((entry.flags & FAN_BUS_POLL_SET_SPEED) && entry.speed <= fan->speedMax && entry.speed != fan->state.speed) {
+      fan->state.speed = entry.speed;
+      fan->state.sequence++;
+    }
+    uint8_t rockSetting = entry.rockSetting & fan->rockSupport;
+    if ((entry.flags & FAN_BUS_POLL_SET_ROCK) && rockSetting != fan->state.rockSetting) {
+      fan->state.rockSetting = rockSetting;
+      fan->state.sequence++;
+    }
+
+    // Change-only: silent unless something is new for the bridge
+    if (commanded || (entry.flags & FAN_BUS_POLL_FORCE_REPLY) || fan->state.sequence != entry.ackSequence) {
+      sleepUntilUs(frameEndUs + (uint64_t)slot * FAN_BUS_SLOT_US);
+      sendFrame(fd, out, fanBusEncodeState(fan->address, fan->state, out, sizeof(out)), lossPercent);
+    }
+  }
+}
+
+// Answer the bridge until gRunning is cleared
+static void serveBus(int fd, SimulatedBusFan *fans, int fanCount, uint32_t buttonIntervalMs, uint32_t lossPercent, FanBusParser &parser) {
+  uint64_t nextButtonUs = buttonIntervalMs > 0 ? nowUs() + buttonIntervalMs * 1000ULL : 0;
+
+  while (gRunning) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, 10);
+    if (ready < 0 && errno != EINTR) {
+      break;
+    }
+    if (ready > 0 && (pfd.revents & POLLIN)) {
+      uint8_t buffer[256];
+      ssize_t length = read(fd, buffer, sizeof(buffer));
+      for (ssize_t i = 0; i < length; i++) {
+        if (parser.feed(buffer[i])) {
+          gFramesReceived++;
+          handleFrame(fd, parser.frame(), fans, fanCount, nowUs(), lossPercent);
+        }
+      }
+    } else if (ready > 0) {
+      // POLLHUP until the bridge opens the slave side
+      usleep(100000);
+    }
+
+    // Somebody changed a fan by hand; the bridge learns about it on the next poll
+    if (nextButtonUs != 0 && nowUs() >= nextButtonUs) {
+      SimulatedBusFan &fan = fans[rand() % fanCount];
+      fan.state.speed = (fan.state.speed + 1) % (fan.speedMax + 1);
+      fan.state.sequence++;
+      printf("Fan %d button: speed %d\n", fan.address, fan.state.speed);
+      fflush(stdout);
+      nextButtonUs += buttonIntervalMs * 1000ULL;
+    }
+  }
+}
+
+// ============================================================================
+// Self test
+// ============================================================================
+
+static int gSelfTestFailures = 0;
+
+#define SELF_TEST_CHECK(condition)                                                  \
+  do {                                                                              \
+    if (!(condition)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      gSelfTestFailures++;                                                          \
+    }                                                                               \
+  } while (0)
+
+// Bridge end of the socket pair; the hooks run inside FanBusMaster::loop(), the way a
+// command from another task can land while a poll is being sent or its replies collected
+class SocketTransport : public FanBusTransport {
+public:
+  int fd = -1;
+  std::function<void(const FanBusFrame &frame)> onFrameSent = nullptr;
+  std::function<void()> onReplyByte = nullptr;
+
+  size_t write(const uint8_t *data, size_t length) override {
+    ssize_t written = ::write(fd, data, length);
+    for (size_t i = 0; i < length; i++) {
+      if (sent.feed(data[i]) && onFrameSent != nullptr) {
+        onFrameSent(sent.frame());
+      }
+    }
+    return written > 0 ? (size_t)written : 0;
+  }
+
+  int read() override {
+    uint8_t b;
+    if (::read(fd, &b, 1) != 1) {
+      return -1;
+    }
+    if (onReplyByte != nullptr) {
+      onReplyByte();
+    }
+    return b;
+  }
+
+protected:
+  FanBusParser sent;
+};
+
+static uint32_t nowMs() {
+  return (uint32_t)(nowUs() / 1000);
+}
+
+static void runMaster(FanBusMaster &master, uint32_t durationMs) {
+  uint32_t start = nowMs();
+  while (nowMs() - start < durationMs) {
+    master.loop(nowMs());
+    usleep(1000);
+  }
+}
+
+static int runSelfTest() {
+  const int fanCount = 2;
+  SimulatedBusFan fans[fanCount];
+  for (int i = 0; i < fanCount; i++) {
+    fans[i] = {(uint8_t)(i + 1), 3, 0x01, {0, 0, 0}};
+  }
+
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+    perror("socketpair");
+    return 1;
+  }
+  fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+
+  FanBusParser simParser;
+  std::thread sim([&]() { serveBus(sockets[1], fans, fanCount, 0, 0, simParser); });
+
+  SocketTransport transport;
+  transport.fd = sockets[0];
+  FanBusMaster master;
+  FanBusState reported[fanCount + 1] = {};
+  master.onDeviceState([&](uint8_t address, const FanBusState &state) { reported[address] = state; });
+  master.begin(transport);
+
+  // Discovery
+  uint32_t start = nowMs();
+  while (master.getDeviceCount() < fanCount && nowMs() - start < 5000) {
+    runMaster(master, 10);
+  }
+  SELF_TEST_CHECK(master.getDeviceCount() == fanCount);
+
+  // Commands arriving while a POLL goes out and while its replies come in
+  bool pollHookArmed = true;
+  bool replyHookArmed = false;
+  transport.onFrameSent = [&](const FanBusFrame &frame) {
+    if (pollHookArmed && frame.command == FAN_BUS_CMD_POLL) {
+      pollHookArmed = false;
+      replyHookArmed = true;
+      SELF_TEST_CHECK(master.setSpeed(1, 2));
+      SELF_TEST_CHECK(master.setRockSetting(1, 0x01));
+    }
+  };
+  transport.onReplyByte = [&]() {
+    if (replyHookArmed) {
+      replyHookArmed = false;
+      SELF_TEST_CHECK(master.setSpeed(2, 3));
+    }
+  };
+  master.setSpeed(2, 1);  // Gets the fans talking in the poll the hooks fire in
+  runMaster(master, 500);
+  transport.onFrameSent = nullptr;
+  transport.onReplyByte = nullptr;
+  SELF_TEST_CHECK(!pollHookArmed && !replyHookArmed);
+  SELF_TEST_CHECK(reported[1].speed == 2 && reported[1].rockSetting == 0x01);
+  SELF_TEST_CHECK(reported[2].speed == 3);
+  SELF_TEST_CHECK(!master.setSpeed(9, 1));
+
+  // A second thread writing as fast as it can while the bus runs
+  std::atomic<bool> writing(true);
+  uint8_t lastSpeed[fanCount + 1] = {};
+  uint8_t lastRock[fanCount + 1] = {};
+  std::thread writer([&]() {
+    for (uint32_t i = 0; writing; i++) {
+      uint8_t address = 1 + i % fanCount;
+      lastSpeed[address] = (uint8_t)(i / fanCount % 4);
+      lastRock[address] = (uint8_t)(i / 7 % 2);
+      master.setSpeed(address, lastSpeed[address]);
+      master.setRockSetting(address, lastRock[address]);
+      if (i % 64 == 0) {
+        usleep(500);
+      }
+    }
+  });
+  start = nowMs();
+  while (nowMs() - start < 500) {
+    runMaster(master, 10);
+  }
+  writing = false;
+  writer.join();
+  runMaster(master, 500);
+
+  gRunning = false;
+  sim.join();
+  for (int address = 1; address <= fanCount; address++) {
+    SELF_TEST_CHECK(fans[address - 1].state.speed == lastSpeed[address]);
+    SELF_TEST_CHECK(fans[address - 1].state.rockSetting == lastRock[address]);
+    SELF_TEST_CHECK(reported[address].speed == lastSpeed[address]);
+    SELF_TEST_CHECK(reported[address].rockSetting == lastRock[address]);
+  }
+  close(sockets[0]);
+  close(sockets[1]);
+
+  printf("Polls: %u, replies: %u, CRC errors: %u\n", master.getPollCount(), master.getReplyCount(), master.getCrcErrors());
+  if (gSelfTestFailures != 0) {
+    printf("FAIL: %d failed checks\n", gSelfTestFailures);
+    return 1;
+  }
+  printf("PASS: commands written during polls and from a second thread reached the fans\n");
+  return 0;
+}
+
+static void onSignal(int) {
+  gRunning = false;
+}
+
+int main(int argc, char *argv[]) {
+  int fanCount = 4;
+  const char *linkPath = nullptr;
+  uint32_t buttonIntervalMs = 0;
+  uint32_t lossPercent = 0;
+
+  if (argc == 2 && strcmp(argv[1], "--self-test") == 0) {
+    return runSelfTest();
+  }
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fans") == 0 && i + 1 < argc) {
+      fanCount = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+      linkPath = argv[++i];
+    } else if (strcmp(argv[i], "--button-interval") == 0 && i + 1 < argc) {
+      buttonIntervalMs = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      lossPercent = (uint32_t)atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [--fans N] [--link PATH] [--button-interval MS] [--loss PERCENT] | --self-test\n", argv[0]);
+      return 1;
+    }
+  }
+  if (fanCount < 1 || fanCount > FAN_BUS_MAX_ADDRESS) {
+    fprintf(stderr, "--fans must be 1..%d\n", FAN_BUS_MAX_ADDRESS);
+    return 1;
+  }
+
+  SimulatedBusFan fans[FAN_BUS_MAX_ADDRESS];
+  for (int i = 0; i < fanCount; i++) {
+    fans[i] = {(uint8_t)(i + 1), 3, 0x01, {0, 0, 0}};
+  }
+
+  int fd = openPty(linkPath);
+  if (fd < 0) {
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  srand((unsigned)time(nullptr));
+
+  FanBusParser parser;
+  serveBus(fd, fans, fanCount, buttonIntervalMs, lossPercent, parser);
+
+  printf("Frames received: %u, replies sent: %u, replies dropped: %u, CRC errors: %u\n", gFramesReceived, gRepliesSent,
+         gRepliesDropped, parser.getCrcErrors());
+  if (linkPath != nullptr) {
+    unlink(linkPath);
+  }
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include "FanBusTty.h"
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <lib/support/logging/CHIPLogging.h>
+
+static speed_t baudToSpeed(uint32_t baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    default: return B115200;
+  }
+}
+
+FanBusTty::~FanBusTty() {
+  close();
+}
+
+bool FanBusTty::open(const char *path, uint32_t baud) {
+  fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    ChipLogError(AppServer, "Cannot open fan bus %s", path);
+    return false;
+  }
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, baudToSpeed(baud));
+  tio.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(fd, TCSANOW, &tio);
+  ChipLogProgress(AppServer, "Fan bus on %s at %u baud", path, baud);
+  return true;
+}
+
+void FanBusTty::close() {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+size_t FanBusTty::write(const uint8_t *data, size_t length) {
+  ssize_t written = fd < 0 ? -1 : ::write(fd, data, length);
+  return written < 0 ? 0 : (size_t)written;
+}
+
+int FanBusTty::read() {
+  if (pos == length) {
+    ssize_t received = fd < 0 ? -1 : ::read(fd, buffer, sizeof(buffer));
+    if (received <= 0) {
+      return -1;
+    }
+    length = (size_t)received;
+    pos = 0;
+  }
+  return buffer[pos++];
+}
@@ -0,0 +1,24 @@
+#ifndef FAN_BUS_TTY_H
+#define FAN_BUS_TTY_H
+
+#include <FanBusMaster.h>
+
+// Fan bus over a tty: a USB-RS485 adapter or the pty of fan-bus-sim
+class FanBusTty : public FanBusTransport {
+public:
+  ~FanBusTty();
+
+  bool open(const char *path, uint32_t baud = 115200);
+  void close();
+
+  size_t write(const uint8_t *data, size_t length) override;
+  int read() override;
+
+protected:
+  int fd = -1;
+  uint8_t buffer[256];
+  size_t length = 0;
+  size_t pos = 0;
+};
+
+#endif // FAN_BUS_TTY_H
@@ -0,0 +1,183 @@
+#include "FanDynamicEndpoint.h"
+
+#include <app-common/zap-generated/attribute-type.h>
+#include <app/reporting/reporting.h>
+#include <app/util/af-types.h>
+#include <app/util/attribute-storage.h>
+#include <app/util/endpoint-config-api.h>
+#include <lib/support/logging/CHIPLogging.h>
+#include <protocols/interaction_model/StatusCode.h>
+
+using namespace chip;
+using namespace chip::app::Clusters;
+using chip::Protocols::InteractionModel::Status;
+
+static const uint16_t kDescriptorAttributeArraySize = 254;
+static const uint16_t kFanDeviceTypeId = 0x002B;
+static const uint8_t kFanDeviceTypeVersion = 2;
+static const uint16_t kBridgedNodeDeviceTypeId = 0x0013;
+static const uint8_t kBridgedNodeDeviceTypeVersion = 2;
+static const uint16_t kDescriptorClusterRevision = 2;
+
+// ============================================================================
+// Endpoint declaration - mirrors the attributes MatterMultiSpeedFan::begin() creates
+// ============================================================================
+
+// clang-format off
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(fanControlAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::FanMode::Id, ENUM8, 1, ZAP_ATTRIBUTE_MASK(WRITABLE)),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::FanModeSequence::Id, ENUM8, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::PercentSetting::Id, INT8U, 1, ZAP_ATTRIBUTE_MASK(WRITABLE) | ZAP_ATTRIBUTE_MASK(NULLABLE)),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::PercentCurrent::Id, INT8U, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::SpeedMax::Id, INT8U, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::SpeedSetting::Id, INT8U, 1, ZAP_ATTRIBUTE_MASK(WRITABLE) | ZAP_ATTRIBUTE_MASK(NULLABLE)),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::SpeedCurrent::Id, INT8U, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::RockSupport::Id, BITMAP8, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::RockSetting::Id, BITMAP8, 1, ZAP_ATTRIBUTE_MASK(WRITABLE)),
+DECLARE_DYNAMIC_ATTRIBUTE(FanControl::Attributes::FeatureMap::Id, BITMAP32, 4, 0),
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(descriptorAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::DeviceTypeList::Id, ARRAY, kDescriptorAttributeArraySize, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ServerList::Id, ARRAY, kDescriptorAttributeArraySize, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ClientList::Id, ARRAY, kDescriptorAttributeArraySize, 0),
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::PartsList::Id, ARRAY, kDescriptorAttributeArraySize, 0),
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(fanClusters)
+DECLARE_DYNAMIC_CLUSTER(FanControl::Id, fanControlAttrs, ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr)
+DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_ENDPOINT(fanEndpoint, fanClusters);
+
+// Bridged fans (parent is an Aggregator) also carry BridgedDeviceBasicInformation
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(bridgedBasicInformationAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(BridgedDeviceBasicInformation::Attributes::Reachable::Id, BOOLEAN, 1, 0),
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(bridgedFanClusters)
+DECLARE_DYNAMIC_CLUSTER(FanControl::Id, fanControlAttrs, ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr),
+DECLARE_DYNAMIC_CLUSTER(BridgedDeviceBasicInformation::Id, bridgedBasicInformationAttrs, ZAP_CLUSTER_MASK(SERVER), nullptr, nullptr)
+DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_ENDPOINT(bridgedFanEndpoint, bridgedFanClusters);
+// clang-format on
+
+static const EmberAfDeviceType gFanDeviceTypes[] = { { kFanDeviceTypeId, kFanDeviceTypeVersion } };
+static const EmberAfDeviceType gBridgedFanDeviceTypes[] = { { kFanDeviceTypeId, kFanDeviceTypeVersion },
+                                                            { kBridgedNodeDeviceTypeId, kBridgedNodeDeviceTypeVersion } };
+
+// One slot per dynamic endpoint
+static MatterEndPoint *gFans[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT];
+static DataVersion gFanDataVersions[CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT][ArraySize(bridgedFanClusters)];
+
+namespace FanDynamicEndpoint {
+
+void init() {
+  esp_matter::host::set_report_hook([](uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id) {
+    MatterReportingAttributeChangeCallback(endpoint_id, cluster_id, attribute_id);
+  });
+}
+
+EndpointId firstDynamicEndpointId() {
+  return static_cast<EndpointId>(emberAfEndpointFromIndex(static_cast<uint16_t>(emberAfFixedEndpointCount() - 1)) + 1);
+}
+
+CHIP_ERROR add(MatterEndPoint &fan, EndpointId parentEndpointId) {
+  for (uint16_t index = 0; index < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT; index++) {
+    if (gFans[index] != nullptr) {
+      continue;
+    }
+    bool bridged = parentEndpointId != kInvalidEndpointId;
+    CHIP_ERROR err;
+    if (bridged) {
+      err = emberAfSetDynamicEndpoint(index, fan.getEndPointId(), &bridgedFanEndpoint, Span<DataVersion>(gFanDataVersions[index]),
+                                      Span<const EmberAfDeviceType>(gBridgedFanDeviceTypes), parentEndpointId);
+    } else {
+      err = emberAfSetDynamicEndpoint(index, fan.getEndPointId(), &fanEndpoint,
+                                      Span<DataVersion>(gFanDataVersions[index], ArraySize(fanClusters)),
+                                      Span<const EmberAfDeviceType>(gFanDeviceTypes), parentEndpointId);
+    }
+    if (err == CHIP_NO_ERROR) {
+      gFans[index] = &fan;
+      ChipLogProgress(DeviceLayer, "Fan added on dynamic endpoint %d (index %d)", fan.getEndPointId(), index);
+    }
+    return err;
+  }
+  return CHIP_ERROR_NO_MEMORY;
+}
+
+CHIP_ERROR remove(MatterEndPoint &fan) {
+  for (uint16_t index = 0; index < CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT; index++) {
+    if (gFans[index] == &fan) {
+      emberAfClearDynamicEndpoint(index);
+      gFans[index] = nullptr;
+      return CHIP_NO_ERROR;
+    }
+  }
+  return CHIP_ERROR_NOT_FOUND;
+}
+
+} // namespace FanDynamicEndpoint
+
+// ============================================================================
+// External attribute storage, backed by the esp_matter attribute store
+// ============================================================================
+
+static void encodeValue(const esp_matter_attr_val_t &val, uint8_t *buffer, uint16_t size) {
+  switch (size) {
+    case 1: buffer[0] = val.val.u8; break;
+    case 2: memcpy(buffer, &val.val.u16, 2); break;
+    case 4: memcpy(buffer, &val.val.u32, 4); break;
+    default: memcpy(buffer, &val.val.u64, size < 8 ? size : 8); break;
+  }
+}
+
+static void decodeValue(const uint8_t *buffer, uint16_t size, esp_matter_attr_val_t &val) {
+  switch (size) {
+    case 1: val.val.u8 = buffer[0]; break;
+    case 2: memcpy(&val.val.u16, buffer, 2); break;
+    case 4: memcpy(&val.val.u32, buffer, 4); break;
+    default: memcpy(&val.val.u64, buffer, size < 8 ? size : 8); break;
+  }
+}
+
+Status emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clusterId, const EmberAfAttributeMetadata *attributeMetadata,
+                                            uint8_t *buffer, uint16_t maxReadLength) {
+  uint32_t attributeId = attributeMetadata->attributeId;
+  if (attributeMetadata->size > maxReadLength) {
+    return Status::ResourceExhausted;
+  }
+
+  esp_matter::attribute_t *attribute = esp_matter::attribute::get(endpoint, clusterId, attributeId);
+  if (attribute == nullptr) {
+    // The store only models FanControl; Descriptor data comes from the endpoint declaration
+    if (clusterId == Descriptor::Id && attributeId == Descriptor::Attributes::ClusterRevision::Id) {
+      memcpy(buffer, &kDescriptorClusterRevision, sizeof(kDescriptorClusterRevision));
+      return Status::Success;
+    }
+    return Status::UnsupportedAttribute;
+  }
+
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  esp_matter::attribute::get_val(attribute, &val);
+  encodeValue(val, buffer, attributeMetadata->size);
+  return Status::Success;
+}
+
+Status emberAfExternalAttributeWriteCallback(EndpointId endpoint, ClusterId clusterId, const EmberAfAttributeMetadata *attributeMetadata,
+                                             uint8_t *buffer) {
+  esp_matter::attribute_t *attribute = esp_matter::attribute::get(endpoint, clusterId, attributeMetadata->attributeId);
+  if (attribute == nullptr) {
+    return Status::UnsupportedAttribute;
+  }
+
+  // Same path as a write on the ESP32: PRE_UPDATE -> attributeChangeCB() -> store -> report
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  esp_matter::attribute::get_val(attribute, &val);
+  decodeValue(buffer, attributeMetadata->size, val);
+  esp_err_t err = esp_matter::attribute::update(endpoint, clusterId, attributeMetadata->attributeId, &val);
+  return err == ESP_OK ? Status::Success : Status::Failure;
+}
@@ -0,0 +1,29 @@
+#ifndef FAN_DYNAMIC_ENDPOINT_H
+#define FAN_DYNAMIC_ENDPOINT_H
+
+#include <MatterEndPoint.h>
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+
+// Publishes fan endpoints from the host esp_matter store as CHIP dynamic endpoints.
+// Every FanControl attribute is declared with external storage, so controller reads
+// and writes go straight to the same attribute store and attributeChangeCB()
+// MatterMultiSpeedFan uses on the ESP32.
+namespace FanDynamicEndpoint {
+
+// Route attribute reports from the esp_matter store to the CHIP reporting engine
+void init();
+
+// Register the endpoint of an already started fan; its endpoint id must be the
+// one the store handed out (see esp_matter::host::set_next_endpoint_id())
+CHIP_ERROR add(MatterEndPoint &fan, chip::EndpointId parentEndpointId = chip::kInvalidEndpointId);
+
+// Remove a previously added fan endpoint
+CHIP_ERROR remove(MatterEndPoint &fan);
+
+// First endpoint id available for dynamic endpoints
+chip::EndpointId firstDynamicEndpointId();
+
+} // namespace FanDynamicEndpoint
+
+#endif // FAN_DYNAMIC_ENDPOINT_H
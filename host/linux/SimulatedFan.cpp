@@ -0,0 +1,92 @@
+#include "SimulatedFan.h"
+
+// ============================================================================
+// SimulatedGpio
+// ============================================================================
+
+SimulatedGpio::SimulatedGpio() {
+  // Outputs idle LOW, pulled-up inputs idle HIGH
+  for (uint8_t pin = 0; pin < SIM_PIN_COUNT; pin++) {
+    levels[pin] = HIGH;
+  }
+  levels[SIM_FAN_SPEED_CONTROL_PIN] = LOW;
+  levels[SIM_FAN_OSCILLATION_CONTROL_PIN] = LOW;
+}
+
+void SimulatedGpio::digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= SIM_PIN_COUNT) {
+    return;
+  }
+  levels[pin] = level;
+  if (_onWriteCB != nullptr) {
+    _onWriteCB(pin, level);
+  }
+}
+
+uint8_t SimulatedGpio::digitalRead(uint8_t pin) {
+  return pin < SIM_PIN_COUNT ? levels[pin] : HIGH;
+}
+
+void SimulatedGpio::onWrite(WriteCallback cb) {
+  _onWriteCB = cb;
+}
+
+// ============================================================================
+// SimulatedFan
+// ============================================================================
+
+SimulatedFan::SimulatedFan(SimulatedGpio &gpio) : gpio(gpio) {
+  gpio.onWrite([this](uint8_t pin, uint8_t level) { onControlWrite(pin, level); });
+  updateLeds();
+}
+
+void SimulatedFan::onControlWrite(uint8_t pin, uint8_t level) {
+  // The fan reacts on the falling edge, i.e. when the pulse ends
+  if (pin == SIM_FAN_SPEED_CONTROL_PIN) {
+    if (lastSpeedControl == HIGH && level == LOW) {
+      speedPulses++;
+      pressSpeedButton();
+    }
+    lastSpeedControl = level;
+  } else if (pin == SIM_FAN_OSCILLATION_CONTROL_PIN) {
+    if (lastOscillationControl == HIGH && level == LOW) {
+      oscillationPulses++;
+      pressOscillationButton();
+    }
+    lastOscillationControl = level;
+  }
+}
+
+void SimulatedFan::pressSpeedButton() {
+  speed = (speed + 1) % 4;
+  updateLeds();
+}
+
+void SimulatedFan::pressOscillationButton() {
+  oscillating = !oscillating;
+  updateLeds();
+}
+
+void SimulatedFan::updateLeds() {
+  // LED lines are active LOW
+  gpio.digitalWrite(SIM_FAN_SPEED_LOW_INPUT_PIN, speed == 1 ? LOW : HIGH);
+  gpio.digitalWrite(SIM_FAN_SPEED_MEDIUM_INPUT_PIN, speed == 2 ? LOW : HIGH);
+  gpio.digitalWrite(SIM_FAN_SPEED_HIGH_INPUT_PIN, speed == 3 ? LOW : HIGH);
+  gpio.digitalWrite(SIM_FAN_OSCILLATION_INPUT_PIN, oscillating ? LOW : HIGH);
+}
+
+uint8_t SimulatedFan::getSpeed() {
+  return speed;
+}
+
+bool SimulatedFan::isOscillating() {
+  return oscillating;
+}
+
+uint32_t SimulatedFan::getSpeedPulseCount() {
+  return speedPulses;
+}
+
+uint32_t SimulatedFan::getOscillationPulseCount() {
+  return oscillationPulses;
+}
@@ -0,0 +1,67 @@
+#ifndef SIMULATED_FAN_H
+#define SIMULATED_FAN_H
+
+#include <Arduino.h>
+
+// Pins of the real board, mirrored as simulated GPIO lines
+enum SimulatedPin : uint8_t {
+  SIM_FAN_SPEED_CONTROL_PIN = 0,
+  SIM_FAN_SPEED_LOW_INPUT_PIN,
+  SIM_FAN_SPEED_MEDIUM_INPUT_PIN,
+  SIM_FAN_SPEED_HIGH_INPUT_PIN,
+  SIM_FAN_OSCILLATION_CONTROL_PIN,
+  SIM_FAN_OSCILLATION_INPUT_PIN,
+  SIM_PIN_COUNT
+};
+
+// GPIO lines shared by the firmware logic and the simulated fan.
+// Inputs are active LOW like the pulled-up pins on the board.
+class SimulatedGpio {
+public:
+  typedef std::function<void(uint8_t pin, uint8_t level)> WriteCallback;
+
+  SimulatedGpio();
+
+  void digitalWrite(uint8_t pin, uint8_t level);
+  uint8_t digitalRead(uint8_t pin);
+
+  // Called after every write, used by the fan to watch its control lines
+  void onWrite(WriteCallback cb);
+
+protected:
+  uint8_t levels[SIM_PIN_COUNT];
+  WriteCallback _onWriteCB = nullptr;
+};
+
+// Physical fan model: a 4-state speed switch (Off -> Low -> Medium -> High -> Off)
+// advanced by a falling edge on the speed control line, an oscillation motor
+// toggled by the oscillation control line, and LED outputs for both.
+class SimulatedFan {
+public:
+  explicit SimulatedFan(SimulatedGpio &gpio);
+
+  // Somebody pressed the buttons on the fan itself
+  void pressSpeedButton();
+  void pressOscillationButton();
+
+  uint8_t getSpeed();
+  bool isOscillating();
+
+  // Total control pulses seen, for the load test report
+  uint32_t getSpeedPulseCount();
+  uint32_t getOscillationPulseCount();
+
+protected:
+  SimulatedGpio &gpio;
+  uint8_t speed = 0;
+  bool oscillating = false;
+  uint8_t lastSpeedControl = LOW;
+  uint8_t lastOscillationControl = LOW;
+  uint32_t speedPulses = 0;
+  uint32_t oscillationPulses = 0;
+
+  void onControlWrite(uint8_t pin, uint8_t level);
+  void updateLeds();
+};
+
+#endif // SIMULATED_FAN_H
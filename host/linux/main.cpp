@@ -0,0 +1,288 @@
+/*
+  Linux build of the Matter smart fan.
+
+  Runs MatterMultiSpeedFan - the same endpoint and attribute logic as the ESP32
+  firmware - on the connectedhomeip Linux platform. The fan hardware is replaced
+  by SimulatedFan on simulated GPIO lines, driven with the firmware's pulse timing
+  (200ms HIGH / 100ms LOW per speed step, 200ms oscillation pulse).
+
+  Everything runs on the CHIP event loop: controller writes arrive through the
+  external attribute callbacks, pulses are SystemLayer timers.
+
+  Environment:
+    FAN_SIM_BUTTON_INTERVAL_MS  press the fan's own speed button periodically
+                                (exercises the local change -> report path)
+    FAN_BUS_DEVICE              bridge mode: instead of the simulated fan, bridge the
+                                fans found on this tty (e.g. the pty of fan-bus-sim)
+                                as dynamic endpoints under the Aggregator endpoint
+    FAN_BUS_BAUD                fan bus baud rate (default 115200)
+    FAN_SIM_AUTO_PERIOD_S       advertise Auto mode, fed by a simulated room temperature that
+                                swings between 24 C and 32 C and back in this many seconds
+*/
+
+#include <AppMain.h>
+#include <app/server/Server.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <system/SystemLayer.h>
+
+#include <Matter.h>
+#include <MatterMultiSpeedFan.h>
+
+#include <FanAutoController.h>
+#include <FanBridge.h>
+#include <FanSensorSource.h>
+
+#include "FanBusTty.h"
+#include "FanDynamicEndpoint.h"
+#include "SimulatedFan.h"
+
+using namespace chip;
+
+MatterMultiSpeedFan SmartFan;
+SimulatedGpio gpio;
+SimulatedFan fanHardware(gpio);
+
+// Pulse timing, same as the firmware
+const uint32_t SPEED_PULSE_HIGH_MS = 200;
+const uint32_t SPEED_PULSE_LOW_MS = 100;
+const uint32_t OSCILLATION_PULSE_DURATION = 200;
+
+uint8_t expectedFanSpeed = 0;
+uint8_t currentFanSpeed = 0;
+bool isFanSpeedControlPulsing = false;
+bool expectedOscillationState = false;
+bool currentOscillationState = false;
+bool isOscillationControlPulsing = false;
+uint32_t simButtonIntervalMs = 0;
+
+// Auto mode on a simulated room temperature
+const uint32_t FAN_AUTO_LOOP_MS = 1000;
+const int16_t SIM_TEMPERATURE_LOW = 2400;
+const int16_t SIM_TEMPERATURE_HIGH = 3200;
+uint32_t simAutoPeriodS = 0;
+FanSimulatedSensor simTemperature;
+FanAutoController fanAuto;
+
+// Bridge mode
+const EndpointId kAggregatorEndpointId = 1;  // Fixed Aggregator endpoint of the bridge-app data model
+const uint32_t FAN_BUS_LOOP_MS = 5;
+const char *fanBusDevice = nullptr;
+FanBusTty fanBusTty;
+FanBridge fanBridge;
+
+// ============================================================================
+// Speed pulse train (pulseFanSpeedControl() in the firmware)
+// ============================================================================
+void onSpeedPulseLowDone(System::Layer *layer, void *context);
+
+void onSpeedPulseHighDone(System::Layer *layer, void *context) {
+  gpio.digitalWrite(SIM_FAN_SPEED_CONTROL_PIN, LOW);
+  layer->StartTimer(System::Clock::Milliseconds32(SPEED_PULSE_LOW_MS), onSpeedPulseLowDone, nullptr);
+}
+
+void startSpeedPulse() {
+  gpio.digitalWrite(SIM_FAN_SPEED_CONTROL_PIN, HIGH);
+  DeviceLayer::SystemLayer().StartTimer(System::Clock::Milliseconds32(SPEED_PULSE_HIGH_MS), onSpeedPulseHighDone, nullptr);
+}
+
+void onSpeedPulseLowDone(System::Layer *layer, void *context) {
+  currentFanSpeed = (currentFanSpeed + 1) % 4;
+  if (expectedFanSpeed != currentFanSpeed) {
+    startSpeedPulse();
+  } else {
+    isFanSpeedControlPulsing = false;
+    ChipLogProgress(AppServer, "Pulse sequence complete. Current speed now: %d", currentFanSpeed);
+  }
+}
+
+bool onSpeedChange(uint8_t newSpeed) {
+  ChipLogProgress(AppServer, "Matter Callback :: New Speed Level = %d", newSpeed);
+  expectedFanSpeed = newSpeed;
+  if (!isFanSpeedControlPulsing && expectedFanSpeed != currentFanSpeed) {
+    isFanSpeedControlPulsing = true;
+    startSpeedPulse();
+  }
+  return true;
+}
+
+// ============================================================================
+// Oscillation pulse (handleOscillationPulse() in the firmware)
+// ============================================================================
+void onOscillationPulseDone(System::Layer *layer, void *context) {
+  gpio.digitalWrite(SIM_FAN_OSCILLATION_CONTROL_PIN, LOW);
+  currentOscillationState = expectedOscillationState;
+  isOscillationControlPulsing = false;
+}
+
+bool onRockChange(uint8_t rockSetting) {
+  ChipLogProgress(AppServer, "Matter Callback :: Rock Setting = %d", rockSetting);
+  expectedOscillationState = rockSetting != 0;
+  if (!isOscillationControlPulsing && expectedOscillationState != currentOscillationState) {
+    isOscillationControlPulsing = true;
+    gpio.digitalWrite(SIM_FAN_OSCILLATION_CONTROL_PIN, HIGH);
+    DeviceLayer::SystemLayer().StartTimer(System::Clock::Milliseconds32(OSCILLATION_PULSE_DURATION), onOscillationPulseDone, nullptr);
+  }
+  return true;
+}
+
+// ============================================================================
+// Local changes on the fan itself (sync*BasedOnExternalInput() in the firmware)
+// ============================================================================
+void syncFanStateFromInputs() {
+  if (!isFanSpeedControlPulsing) {
+    uint8_t newSpeedLevel = 0;
+    if (gpio.digitalRead(SIM_FAN_SPEED_HIGH_INPUT_PIN) == LOW) {
+      newSpeedLevel = 3;
+    } else if (gpio.digitalRead(SIM_FAN_SPEED_MEDIUM_INPUT_PIN) == LOW) {
+      newSpeedLevel = 2;
+    } else if (gpio.digitalRead(SIM_FAN_SPEED_LOW_INPUT_PIN) == LOW) {
+      newSpeedLevel = 1;
+    }
+    if (currentFanSpeed != newSpeedLevel) {
+      expectedFanSpeed = newSpeedLevel;
+      currentFanSpeed = newSpeedLevel;
+      SmartFan.setSpeed(newSpeedLevel, false);
+    }
+  }
+  if (!isOscillationControlPulsing) {
+    bool physicalOscillationState = gpio.digitalRead(SIM_FAN_OSCILLATION_INPUT_PIN) == LOW;
+    if (currentOscillationState != physicalOscillationState) {
+      currentOscillationState = physicalOscillationState;
+      expectedOscillationState = physicalOscillationState;
+      SmartFan.setRockSetting(physicalOscillationState ? ROCK_LEFT_RIGHT : 0, false);
+    }
+  }
+}
+
+void onSimButtonTimer(System::Layer *layer, void *context) {
+  if (!isFanSpeedControlPulsing) {
+    fanHardware.pressSpeedButton();
+    syncFanStateFromInputs();
+  }
+  layer->StartTimer(System::Clock::Milliseconds32(simButtonIntervalMs), onSimButtonTimer, nullptr);
+}
+
+// ============================================================================
+// Auto mode (handleAutoMode() in the firmware)
+// ============================================================================
+void onFanAutoTimer(System::Layer *layer, void *context) {
+  // Triangle wave LOW -> HIGH -> LOW over one period
+  uint32_t periodMs = simAutoPeriodS * 1000;
+  uint32_t phase = millis() % periodMs;
+  uint32_t rise = phase < periodMs / 2 ? phase : periodMs - phase;
+  simTemperature.setTemperature(
+    (int16_t)(SIM_TEMPERATURE_LOW + (int32_t)(SIM_TEMPERATURE_HIGH - SIM_TEMPERATURE_LOW) * rise / (periodMs / 2)));
+  fanAuto.loop();
+  layer->StartTimer(System::Clock::Milliseconds32(FAN_AUTO_LOOP_MS), onFanAutoTimer, nullptr);
+}
+
+// ============================================================================
+// Bridge mode (fanBridge.loop() in the firmware)
+// ============================================================================
+void onFanBusTimer(System::Layer *layer, void *context) {
+  fanBridge.loop();
+  layer->StartTimer(System::Clock::Milliseconds32(FAN_BUS_LOOP_MS), onFanBusTimer, nullptr);
+}
+
+void startBridge() {
+  fanBridge.onFanAdded([](MatterMultiSpeedFan &fan) {
+    if (FanDynamicEndpoint::add(fan, fanBridge.getAggregatorEndpointId()) != CHIP_NO_ERROR) {
+      ChipLogError(AppServer, "Failed to publish bridged fan endpoint %d", fan.getEndPointId());
+    }
+  });
+  DeviceLayer::SystemLayer().StartTimer(System::Clock::Milliseconds32(FAN_BUS_LOOP_MS), onFanBusTimer, nullptr);
+}
+
+// ============================================================================
+// CHIP application hooks
+// ============================================================================
+void ApplicationInit() {
+  FanDynamicEndpoint::init();
+  Matter.setCommissioned(Server::GetInstance().GetFabricTable().FabricCount() > 0);
+
+  if (fanBusDevice != nullptr) {
+    startBridge();
+    return;
+  }
+
+  if (FanDynamicEndpoint::add(SmartFan) != CHIP_NO_ERROR) {
+    ChipLogError(AppServer, "Failed to add the fan endpoint");
+    return;
+  }
+
+  const char *interval = getenv("FAN_SIM_BUTTON_INTERVAL_MS");
+  if (interval != nullptr && atoi(interval) > 0) {
+    simButtonIntervalMs = (uint32_t)atoi(interval);
+    DeviceLayer::SystemLayer().StartTimer(System::Clock::Milliseconds32(simButtonIntervalMs), onSimButtonTimer, nullptr);
+    ChipLogProgress(AppServer, "Simulated speed button pressed every %u ms", simButtonIntervalMs);
+  }
+
+  if (simAutoPeriodS > 0) {
+    DeviceLayer::SystemLayer().StartTimer(System::Clock::Milliseconds32(FAN_AUTO_LOOP_MS), onFanAutoTimer, nullptr);
+    ChipLogProgress(AppServer, "Auto mode on a simulated room temperature, period %u s", simAutoPeriodS);
+  }
+}
+
+void ApplicationShutdown() {
+  if (fanBusDevice != nullptr) {
+    FanBusMaster &bus = fanBridge.getBus();
+    ChipLogProgress(AppServer, "Bridged fans: %u, polls: %u, replies: %u, CRC errors: %u", fanBridge.getFanCount(),
+                    bus.getPollCount(), bus.getReplyCount(), bus.getCrcErrors());
+    for (uint8_t address = 1; address <= FAN_BUS_MAX_ADDRESS; address++) {
+      MatterMultiSpeedFan *fan = fanBridge.getFan(address);
+      if (fan != nullptr) {
+        FanDynamicEndpoint::remove(*fan);
+      }
+    }
+    return;
+  }
+  ChipLogProgress(AppServer, "Speed pulses: %u, oscillation pulses: %u", fanHardware.getSpeedPulseCount(),
+                  fanHardware.getOscillationPulseCount());
+  if (simAutoPeriodS > 0) {
+    ChipLogProgress(AppServer, "Auto mode evaluations: %u, speed changes: %u, deferred: %u", fanAuto.getEvaluationCount(),
+                    fanAuto.getSpeedChangeCount(), fanAuto.getDeferredCount());
+  }
+  FanDynamicEndpoint::remove(SmartFan);
+}
+
+int main(int argc, char *argv[]) {
+  if (ChipLinuxAppInit(argc, argv) != 0) {
+    return -1;
+  }
+
+  Matter._init();
+
+  fanBusDevice = getenv("FAN_BUS_DEVICE");
+  if (fanBusDevice != nullptr) {
+    const char *baud = getenv("FAN_BUS_BAUD");
+    if (!fanBusTty.open(fanBusDevice, baud != nullptr ? (uint32_t)atoi(baud) : 115200)) {
+      return -1;
+    }
+    // Mirror the fixed Aggregator in the store; bridged fans then take the dynamic endpoint ids
+    esp_matter::host::set_next_endpoint_id(kAggregatorEndpointId);
+    fanBridge.begin(fanBusTty);
+    esp_matter::host::set_next_endpoint_id(FanDynamicEndpoint::firstDynamicEndpointId());
+    ChipLinuxAppMainLoop();
+    return 0;
+  }
+
+  // The fan endpoint takes the first dynamic endpoint id after the fixed ones of the data model
+  esp_matter::host::set_next_endpoint_id(FanDynamicEndpoint::firstDynamicEndpointId());
+  const char *autoPeriod = getenv("FAN_SIM_AUTO_PERIOD_S");
+  if (autoPeriod != nullptr && atoi(autoPeriod) > 0 && simTemperature.begin()) {
+    simAutoPeriodS = (uint32_t)atoi(autoPeriod);
+    SmartFan.setAutoSupported(true);
+  }
+  SmartFan.begin(3, ROCK_LEFT_RIGHT);
+  SmartFan.onChangeSpeed(onSpeedChange);
+  SmartFan.onChangeRock(onRockChange);
+  if (simAutoPeriodS > 0) {
+    // Short dwell so a period of a few minutes shows every level
+    FanAutoConfig autoConfig;
+    autoConfig.minDwellMs = 10000;
+    fanAuto.begin(SmartFan, simTemperature, autoConfig);
+  }
+
+  ChipLinuxAppMainLoop();
+  return 0;
+}
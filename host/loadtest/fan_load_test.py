@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+Controller load test for the Linux build of the smart fan (host/linux).
+
+Starts smart-fan-app (or attaches to a running one), commissions it with
+chip-tool over localhost, opens many concurrent subscriptions and hammers
+SpeedSetting / RockSetting writes. Reports:
+
+  - write latency percentiles (command sent -> write response)
+  - report fan-out: attribute reports received per write, report latency
+    percentiles and fan CPU time per write
+  - fan resident memory per subscription
+
+Only chip-tool's interactive mode is used, so a single CASE session carries
+all subscriptions and writes.
+
+Example:
+  ./fan_load_test.py --app ../linux/out/smart-fan-app --chip-tool chip-tool \
+      --subscriptions 32 --writes 200
+"""
+
+import argparse
+import os
+import queue
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+PROMPT = ">>> "
+FAN_CONTROL_CLUSTER = "0x0000_0202"
+REPORT_RE = re.compile(r"Endpoint: (\d+) Cluster: (0x[0-9A-Fa-f_]+) Attribute (0x[0-9A-Fa-f_]+)")
+ROCK_SETTING_RE = re.compile(r"RockSetting: (\d+)")
+
+SUBSCRIBED_ATTRIBUTES = ["speed-setting", "speed-current", "fan-mode", "percent-setting",
+                         "percent-current", "rock-setting"]
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    ordered = sorted(values)
+    k = (len(ordered) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (k - lo)
+
+
+def summarize(name, values_ms):
+    if not values_ms:
+        return f"{name}: no samples"
+    return (f"{name}: n={len(values_ms)} p50={percentile(values_ms, 50):.1f}ms "
+            f"p90={percentile(values_ms, 90):.1f}ms p99={percentile(values_ms, 99):.1f}ms "
+            f"max={max(values_ms):.1f}ms mean={statistics.mean(values_ms):.1f}ms")
+
+
+def proc_rss_kb(pid):
+    with open(f"/proc/{pid}/status") as f:
+        for line in f:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1])
+    return 0
+
+
+def proc_cpu_ms(pid):
+    with open(f"/proc/{pid}/stat") as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    # utime and stime are fields 14 and 15 (1-based), in clock ticks
+    ticks = int(fields[11]) + int(fields[12])
+    return ticks * 1000.0 / os.sysconf("SC_CLK_TCK")
+
+
+class ChipTool:
+    """chip-tool in interactive mode, with every output line timestamped."""
+
+    def __init__(self, chip_tool, storage_dir, verbose=False):
+        self.proc = subprocess.Popen(
+            [chip_tool, "interactive", "start", "--storage-directory", storage_dir],
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+            text=True, bufsize=1)
+        self.lines = queue.Queue()
+        self.verbose = verbose
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        self.reader.start()
+        self.wait_prompt(timeout=30)
+
+    def _read(self):
+        buf = ""
+        while True:
+            ch = self.proc.stdout.read(1)
+            if not ch:
+                self.lines.put((time.monotonic(), None))
+                return
+            buf += ch
+            # The prompt is not newline terminated
+            if ch == "\n" or buf.endswith(PROMPT):
+                if self.verbose:
+                    sys.stderr.write(buf)
+                self.lines.put((time.monotonic(), buf))
+                buf = ""
+
+    def send(self, command):
+        self.proc.stdin.write(command + "\n")
+        self.proc.stdin.flush()
+        return time.monotonic()
+
+    def wait_prompt(self, timeout, on_line=None):
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                raise TimeoutError("chip-tool did not return to the prompt")
+            ts, line = self.lines.get(timeout=remaining)
+            if line is None:
+                raise RuntimeError("chip-tool exited")
+            if on_line is not None:
+                on_line(ts, line)
+            if line.endswith(PROMPT):
+                return ts
+
+    def drain(self, duration, on_line):
+        deadline = time.monotonic() + duration
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return
+            try:
+                ts, line = self.lines.get(timeout=remaining)
+            except queue.Empty:
+                return
+            if line is None:
+                return
+            on_line(ts, line)
+
+    def close(self):
+        try:
+            self.send("quit()")
+            self.proc.wait(timeout=5)
+        except Exception:
+            self.proc.kill()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--chip-tool", default="chip-tool", help="chip-tool binary")
+    parser.add_argument("--app", help="smart-fan-app binary to start (omit to use --app-pid)")
+    parser.add_argument("--app-pid", type=int, help="pid of an already running, commissioned smart-fan-app")
+    parser.add_argument("--node-id", type=int, default=0x1234)
+    parser.add_argument("--endpoint", type=int, default=3, help="fan endpoint (first dynamic endpoint)")
+    parser.add_argument("--passcode", type=int, default=20202021)
+    parser.add_argument("--discriminator", type=int, default=3840)
+    parser.add_argument("--subscriptions", type=int, default=16, help="concurrent subscriptions to open")
+    parser.add_argument("--writes", type=int, default=100, help="writes to issue")
+    parser.add_argument("--interval-ms", type=int, default=0, help="pause between writes")
+    parser.add_argument("--settle-ms", type=int, default=1000, help="time to collect reports after the last write")
+    parser.add_argument("--storage-dir", help="chip-tool storage directory (default: temporary)")
+    parser.add_argument("--verbose", action="store_true", help="echo chip-tool output")
+    args = parser.parse_args()
+
+    if shutil.which(args.chip_tool) is None and not os.path.exists(args.chip_tool):
+        parser.error(f"chip-tool not found: {args.chip_tool}")
+    if args.app is None and args.app_pid is None:
+        parser.error("one of --app or --app-pid is required")
+
+    workdir = tempfile.mkdtemp(prefix="fan-load-")
+    storage_dir = args.storage_dir or os.path.join(workdir, "chip-tool")
+    os.makedirs(storage_dir, exist_ok=True)
+
+    app = None
+    app_pid = args.app_pid
+    if args.app is not None:
+        app_log = open(os.path.join(workdir, "smart-fan-app.log"), "w")
+        app = subprocess.Popen([args.app, "--KVS", os.path.join(workdir, "fan-kvs"),
+                                "--discriminator", str(args.discriminator),
+                                "--passcode", str(args.passcode)],
+                               stdout=app_log, stderr=subprocess.STDOUT)
+        app_pid = app.pid
+        time.sleep(2)
+
+    tool = ChipTool(args.chip_tool, storage_dir, args.verbose)
+    try:
+        if app is not None:
+            print(f"Commissioning node 0x{args.node_id:X} over localhost...")
+            tool.send(f"pairing onnetwork-long {args.node_id} {args.passcode} {args.discriminator}")
+            tool.wait_prompt(timeout=120)
+
+        # Warm up the CASE session so the first write is not an outlier, and read the oscillation
+        # state so the rock-setting writes below start from its opposite
+        rock = {"setting": 0}
+
+        def read_rock_setting(ts, line):
+            m = ROCK_SETTING_RE.search(line)
+            if m:
+                rock["setting"] = 1 if int(m.group(1)) else 0
+
+        tool.send(f"fancontrol read rock-setting {args.node_id} {args.endpoint}")
+        tool.wait_prompt(timeout=30, on_line=read_rock_setting)
+
+        rss_before = proc_rss_kb(app_pid)
+        print(f"Opening {args.subscriptions} subscriptions...")
+        for i in range(args.subscriptions):
+            attribute = SUBSCRIBED_ATTRIBUTES[i % len(SUBSCRIBED_ATTRIBUTES)]
+            tool.send(f"fancontrol subscribe {attribute} 0 60 {args.node_id} {args.endpoint} --keepSubscriptions true")
+            tool.wait_prompt(timeout=30)
+        tool.drain(1.0, lambda ts, line: None)
+        rss_after = proc_rss_kb(app_pid)
+
+        write_latencies = []
+        report_latencies = []
+        reports = 0
+        state = {"write_sent": None}
+
+        def count_reports(ts, line):
+            nonlocal reports
+            m = REPORT_RE.search(line)
+            if m and m.group(2) == FAN_CONTROL_CLUSTER and int(m.group(1)) == args.endpoint:
+                reports += 1
+                if state["write_sent"] is not None:
+                    report_latencies.append((ts - state["write_sent"]) * 1000.0)
+
+        print(f"Issuing {args.writes} writes...")
+        cpu_before = proc_cpu_ms(app_pid)
+        for i in range(args.writes):
+            # Alternate between every speed and toggling oscillation, never a no-op write
+            if i % 4 == 3:
+                command = f"fancontrol write rock-setting {(rock['setting'] + i // 4 + 1) % 2} {args.node_id} {args.endpoint}"
+            else:
+                command = f"fancontrol write speed-setting {(i % 3) + 1} {args.node_id} {args.endpoint}"
+            state["write_sent"] = tool.send(command)
+            done = tool.wait_prompt(timeout=30, on_line=count_reports)
+            write_latencies.append((done - state["write_sent"]) * 1000.0)
+            if args.interval_ms:
+                tool.drain(args.interval_ms / 1000.0, count_reports)
+        tool.drain(args.settle_ms / 1000.0, count_reports)
+        cpu_after = proc_cpu_ms(app_pid)
+
+        print()
+        print("=== Fan load test ===")
+        print(f"subscriptions: {args.subscriptions}, writes: {args.writes}")
+        print(summarize("write latency", write_latencies))
+        print(summarize("report latency", report_latencies))
+        print(f"reports received: {reports} ({reports / max(args.writes, 1):.2f} per write)")
+        print(f"fan CPU time: {(cpu_after - cpu_before) / max(args.writes, 1):.2f}ms per write")
+        print(f"fan RSS: {rss_before}kB -> {rss_after}kB, "
+              f"{(rss_after - rss_before) / max(args.subscriptions, 1):.1f}kB per subscription")
+    finally:
+        tool.close()
+        if app is not None:
+            app.terminate()
+            app.wait(timeout=5)
+        if args.storage_dir is None:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
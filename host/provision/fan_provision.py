@@ -0,0 +1,417 @@
+#!/usr/bin/env python3
+"""
+Factory provisioning for the smart fan (nvs_factory partition images).
+
+Reads a batch spec and generates, for every unit, a unique setup passcode and
+discriminator, a random SPAKE2+ salt and the matching verifier, a rotating
+device ID unique ID and the QR / manual pairing codes. Each unit gets a CSV in
+the "chip-factory" namespace and a ready-to-flash nvs_factory image, and the
+batch gets a manifest with everything that has to be printed on the label.
+
+Firmware built with -D MATTER_DEVICE_FACTORY_PARTITION=1 reads these values
+(see lib/MatterDeviceProvider), so one image serves every unit.
+
+The verifier work (PBKDF2 + a P-256 scalar multiplication) and the image
+generation run in a process pool, one worker per core.
+
+Batch spec (JSON):
+  {
+    "vendor_id": "0xFFF1",
+    "product_id": "0x8000",
+    "serial_prefix": "SF-2626-",
+    "serial_start": 1,
+    "count": 10000,
+    "iteration_count": 1000,
+    "rendezvous": ["ble", "onnetwork"],
+    "devices": [ {"serial": "SF-2626-X01", "passcode": 20202021, "discriminator": 3840} ]
+  }
+
+"devices" is optional and pins values for specific units (missing fields are
+generated); "count" more units are generated after them. Discriminators are
+unique while the batch has at most 4096 units and evenly spread beyond that.
+
+Example:
+  ./fan_provision.py batch.json --out out/batch-01
+  esptool.py write_flash 0x10000 out/batch-01/devices/SF-2626-00001.bin
+"""
+
+import argparse
+import base64
+import csv
+import hashlib
+import json
+import multiprocessing
+import os
+import secrets
+import shutil
+import subprocess
+import sys
+import time
+
+NVS_NAMESPACE = "chip-factory"
+NVS_PARTITION_SIZE = 0x6000         # nvs_factory in partitions.csv
+NVS_PARTITION_OFFSET = 0x10000
+
+SALT_LENGTH = 32
+ROTATING_ID_UNIQUE_ID_LENGTH = 16
+MIN_ITERATIONS = 1000
+MAX_ITERATIONS = 100000
+
+INVALID_PASSCODES = {0, 11111111, 22222222, 33333333, 44444444, 55555555, 66666666, 77777777, 88888888, 99999999,
+                     12345678, 87654321}
+MAX_PASSCODE = 99999998
+
+RENDEZVOUS_FLAGS = {"softap": 0x01, "ble": 0x02, "onnetwork": 0x04}
+
+# ============================================================================
+# P-256 (only what the SPAKE2+ verifier needs: L = w1 * G)
+# ============================================================================
+
+P256_P = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+P256_N = 0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551
+P256_A = P256_P - 3
+P256_GX = 0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296
+P256_GY = 0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5
+
+
+def _jacobian_double(point):
+    x, y, z = point
+    if y == 0:
+        return (0, 0, 0)
+    p = P256_P
+    yy = y * y % p
+    s = 4 * x * yy % p
+    zz = z * z % p
+    m = (3 * x * x + P256_A * zz * zz) % p
+    x3 = (m * m - 2 * s) % p
+    y3 = (m * (s - x3) - 8 * yy * yy) % p
+    z3 = 2 * y * z % p
+    return (x3, y3, z3)
+
+
+def _jacobian_add(p1, p2):
+    if p1[2] == 0:
+        return p2
+    if p2[2] == 0:
+        return p1
+    p = P256_P
+    x1, y1, z1 = p1
+    x2, y2, z2 = p2
+    z1z1 = z1 * z1 % p
+    z2z2 = z2 * z2 % p
+    u1 = x1 * z2z2 % p
+    u2 = x2 * z1z1 % p
+    s1 = y1 * z2 * z2z2 % p
+    s2 = y2 * z1 * z1z1 % p
+    if u1 == u2:
+        return _jacobian_double(p1) if s1 == s2 else (0, 0, 0)
+    h = (u2 - u1) % p
+    r = (s2 - s1) % p
+    hh = h * h % p
+    hhh = h * hh % p
+    v = u1 * hh % p
+    x3 = (r * r - hhh - 2 * v) % p
+    y3 = (r * (v - x3) - s1 * hhh) % p
+    z3 = h * z1 * z2 % p
+    return (x3, y3, z3)
+
+
+def p256_multiply_generator(scalar):
+    """Uncompressed SEC1 encoding of scalar * G."""
+    result = (0, 0, 0)
+    addend = (P256_GX, P256_GY, 1)
+    while scalar:
+        if scalar & 1:
+            result = _jacobian_add(result, addend)
+        addend = _jacobian_double(addend)
+        scalar >>= 1
+    x, y, z = result
+    z_inv = pow(z, -1, P256_P)
+    z_inv2 = z_inv * z_inv % P256_P
+    x = x * z_inv2 % P256_P
+    y = y * z_inv2 * z_inv % P256_P
+    return b"\x04" + x.to_bytes(32, "big") + y.to_bytes(32, "big")
+
+
+def spake2p_verifier(passcode, salt, iterations):
+    """Serialized SPAKE2+ verifier W0 || L, as Spake2pVerifier::Serialize() produces it."""
+    ws = hashlib.pbkdf2_hmac("sha256", passcode.to_bytes(4, "little"), salt, iterations, 2 * 40)
+    w0 = int.from_bytes(ws[:40], "big") % P256_N
+    w1 = int.from_bytes(ws[40:], "big") % P256_N
+    return w0.to_bytes(32, "big") + p256_multiply_generator(w1)
+
+# ============================================================================
+# Onboarding payloads
+# ============================================================================
+
+BASE38_CHARS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-."
+
+
+def base38_encode(data):
+    out = []
+    for i in range(0, len(data), 3):
+        chunk = data[i:i + 3]
+        value = int.from_bytes(chunk, "little")
+        for _ in range({1: 2, 2: 4, 3: 5}[len(chunk)]):
+            out.append(BASE38_CHARS[value % 38])
+            value //= 38
+    return "".join(out)
+
+
+def qr_code_payload(vendor_id, product_id, rendezvous, discriminator, passcode):
+    fields = [(0, 3), (vendor_id, 16), (product_id, 16), (0, 2), (rendezvous, 8), (discriminator, 12),
+              (passcode, 27), (0, 4)]
+    bits = 0
+    offset = 0
+    for value, width in fields:
+        bits |= value << offset
+        offset += width
+    return "MT:" + base38_encode(bits.to_bytes(offset // 8, "little"))
+
+
+VERHOEFF_D = [[0, 1, 2, 3, 4, 5, 6, 7, 8, 9], [1, 2, 3, 4, 0, 6, 7, 8, 9, 5], [2, 3, 4, 0, 1, 7, 8, 9, 5, 6],
+              [3, 4, 0, 1, 2, 8, 9, 5, 6, 7], [4, 0, 1, 2, 3, 9, 5, 6, 7, 8], [5, 9, 8, 7, 6, 0, 4, 3, 2, 1],
+              [6, 5, 9, 8, 7, 1, 0, 4, 3, 2], [7, 6, 5, 9, 8, 2, 1, 0, 4, 3], [8, 7, 6, 5, 9, 3, 2, 1, 0, 4],
+              [9, 8, 7, 6, 5, 4, 3, 2, 1, 0]]
+VERHOEFF_P = [[0, 1, 2, 3, 4, 5, 6, 7, 8, 9], [1, 5, 7, 6, 2, 8, 3, 0, 9, 4], [5, 8, 0, 3, 7, 9, 6, 1, 4, 2],
+              [8, 9, 1, 6, 0, 4, 3, 5, 2, 7], [9, 4, 5, 3, 1, 2, 6, 8, 7, 0], [4, 2, 8, 6, 5, 7, 3, 9, 0, 1],
+              [2, 7, 9, 3, 8, 0, 6, 4, 1, 5], [7, 0, 4, 6, 9, 1, 3, 2, 5, 8]]
+VERHOEFF_INV = [0, 4, 3, 2, 1, 5, 6, 7, 8, 9]
+
+
+def verhoeff_check_digit(digits):
+    c = 0
+    for i, digit in enumerate(reversed(digits)):
+        c = VERHOEFF_D[c][VERHOEFF_P[(i + 1) % 8][int(digit)]]
+    return str(VERHOEFF_INV[c])
+
+
+def manual_pairing_code(discriminator, passcode):
+    short_discriminator = discriminator >> 8
+    chunk1 = short_discriminator >> 2
+    chunk2 = ((short_discriminator & 0x3) << 14) | (passcode & 0x3FFF)
+    chunk3 = passcode >> 14
+    code = "%01d%05d%04d" % (chunk1, chunk2, chunk3)
+    return code + verhoeff_check_digit(code)
+
+# ============================================================================
+# Batch planning (parent process; cheap and needs the whole batch for uniqueness)
+# ============================================================================
+
+
+def parse_int(value):
+    return int(value, 0) if isinstance(value, str) else int(value)
+
+
+def valid_passcode(passcode):
+    return 1 <= passcode <= MAX_PASSCODE and passcode not in INVALID_PASSCODES
+
+
+def plan_batch(spec):
+    vendor_id = parse_int(spec.get("vendor_id", 0xFFF1))
+    product_id = parse_int(spec.get("product_id", 0x8000))
+    iterations = parse_int(spec.get("iteration_count", MIN_ITERATIONS))
+    if not MIN_ITERATIONS <= iterations <= MAX_ITERATIONS:
+        raise ValueError("iteration_count must be %d..%d" % (MIN_ITERATIONS, MAX_ITERATIONS))
+    rendezvous = 0
+    for name in spec.get("rendezvous", ["ble", "onnetwork"]):
+        rendezvous |= RENDEZVOUS_FLAGS[name.lower()]
+
+    units = [dict(d) for d in spec.get("devices", [])]
+    prefix = spec.get("serial_prefix", "SF-")
+    start = parse_int(spec.get("serial_start", 1))
+    width = parse_int(spec.get("serial_digits", 5))
+    for i in range(parse_int(spec.get("count", 0))):
+        units.append({"serial": "%s%0*d" % (prefix, width, start + i)})
+
+    serials = set()
+    used_passcodes = set()
+    used_discriminators = set()
+    for unit in units:
+        if "serial" not in unit or len(unit["serial"]) > 32:
+            raise ValueError("every device needs a serial of at most 32 characters: %r" % unit)
+        if unit["serial"] in serials:
+            raise ValueError("duplicate serial %s" % unit["serial"])
+        serials.add(unit["serial"])
+        if "passcode" in unit:
+            unit["passcode"] = parse_int(unit["passcode"])
+            if not valid_passcode(unit["passcode"]) or unit["passcode"] in used_passcodes:
+                raise ValueError("invalid or duplicate passcode for %s" % unit["serial"])
+            used_passcodes.add(unit["passcode"])
+        if "discriminator" in unit:
+            unit["discriminator"] = parse_int(unit["discriminator"])
+            if not 0 <= unit["discriminator"] <= 0xFFF:
+                raise ValueError("discriminator out of range for %s" % unit["serial"])
+            used_discriminators.add(unit["discriminator"])
+
+    # Discriminators come from shuffled permutations of 0..4095, skipping pinned ones
+    discriminator_pool = []
+    for unit in units:
+        if "passcode" not in unit:
+            passcode = 0
+            while not valid_passcode(passcode) or passcode in used_passcodes:
+                passcode = 1 + secrets.randbelow(MAX_PASSCODE)
+            used_passcodes.add(passcode)
+            unit["passcode"] = passcode
+        if "discriminator" not in unit:
+            if not discriminator_pool:
+                discriminator_pool = [d for d in range(0x1000) if d not in used_discriminators]
+                if not discriminator_pool:
+                    used_discriminators.clear()
+                    discriminator_pool = list(range(0x1000))
+                for i in range(len(discriminator_pool) - 1, 0, -1):
+                    j = secrets.randbelow(i + 1)
+                    discriminator_pool[i], discriminator_pool[j] = discriminator_pool[j], discriminator_pool[i]
+            unit["discriminator"] = discriminator_pool.pop()
+            used_discriminators.add(unit["discriminator"])
+        unit["vendor_id"] = vendor_id
+        unit["product_id"] = product_id
+        unit["iteration_count"] = iterations
+        unit["rendezvous"] = rendezvous
+    return units
+
+# ============================================================================
+# Per-unit work (pool workers)
+# ============================================================================
+
+
+def nvs_generator_command():
+    idf_path = os.environ.get("IDF_PATH")
+    if idf_path:
+        script = os.path.join(idf_path, "components", "nvs_flash", "nvs_partition_generator", "nvs_partition_gen.py")
+        if os.path.exists(script):
+            return [sys.executable, script]
+    return [sys.executable, "-m", "esp_idf_nvs_partition_gen"]
+
+
+def provision_unit(job):
+    unit, out_dir, nvs_gen = job
+    salt = bytes.fromhex(unit["salt"]) if "salt" in unit else secrets.token_bytes(SALT_LENGTH)
+    unique_id = secrets.token_bytes(ROTATING_ID_UNIQUE_ID_LENGTH)
+    verifier = spake2p_verifier(unit["passcode"], salt, unit["iteration_count"])
+
+    record = {
+        "serial": unit["serial"],
+        "vendor_id": "0x%04X" % unit["vendor_id"],
+        "product_id": "0x%04X" % unit["product_id"],
+        "discriminator": unit["discriminator"],
+        "passcode": unit["passcode"],
+        "iteration_count": unit["iteration_count"],
+        "salt": base64.b64encode(salt).decode(),
+        "verifier": base64.b64encode(verifier).decode(),
+        "rd_id_uid": unique_id.hex(),
+        "qr_code": qr_code_payload(unit["vendor_id"], unit["product_id"], unit["rendezvous"], unit["discriminator"],
+                                   unit["passcode"]),
+        "manual_code": manual_pairing_code(unit["discriminator"], unit["passcode"]),
+        "image": "",
+    }
+
+    # Keys and encodings match what the firmware reads from the "chip-factory" namespace
+    csv_path = os.path.join(out_dir, "devices", unit["serial"] + ".csv")
+    with open(csv_path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["key", "type", "encoding", "value"])
+        writer.writerow([NVS_NAMESPACE, "namespace", "", ""])
+        writer.writerow(["serial-num", "data", "string", record["serial"]])
+        writer.writerow(["discriminator", "data", "u32", record["discriminator"]])
+        writer.writerow(["pin-code", "data", "u32", record["passcode"]])
+        writer.writerow(["iteration-count", "data", "u32", record["iteration_count"]])
+        writer.writerow(["salt", "data", "string", record["salt"]])
+        writer.writerow(["verifier", "data", "string", record["verifier"]])
+        writer.writerow(["rd-id-uid", "data", "hex2bin", record["rd_id_uid"]])
+
+    if nvs_gen:
+        image_path = os.path.join(out_dir, "devices", unit["serial"] + ".bin")
+        result = subprocess.run(nvs_gen + ["generate", csv_path, image_path, hex(NVS_PARTITION_SIZE)],
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+        if result.returncode != 0:
+            raise RuntimeError("nvs_partition_gen failed for %s: %s" % (unit["serial"], result.stderr.strip()))
+        record["image"] = os.path.relpath(image_path, out_dir)
+    return record
+
+# ============================================================================
+# Self test
+# ============================================================================
+
+
+def self_test():
+    # Onboarding payload of the connectedhomeip example apps (0xFFF1/0x8001, 20202021 / 3840, BLE)
+    qr = qr_code_payload(0xFFF1, 0x8001, RENDEZVOUS_FLAGS["ble"], 3840, 20202021)
+    manual = manual_pairing_code(3840, 20202021)
+    # Test verifier shipped with connectedhomeip (passcode 20202021, "SPAKE2P Key Salt", 1000 iterations)
+    verifier = base64.b64encode(spake2p_verifier(20202021, b"SPAKE2P Key Salt", 1000)).decode()
+    expected = {
+        "qr": (qr, "MT:-24J042C00KA0648G00"),
+        "manual": (manual, "34970112332"),
+        "verifier": (verifier, "uWFwqugDNGiEck/po7KHwwMwwqZgN10XuyBajPGuyzUEV/iree4lOrao5GuwnlQ65CJzbeUB49s31EH+NEkg0J"
+                               "VI5MGCQGMMT/SRPFNRODm3wH/MBiehuFc6FJ/NH6Rmzw=="),
+    }
+    ok = True
+    for name, (got, want) in expected.items():
+        status = "ok" if got == want else "FAILED"
+        ok &= got == want
+        print("%-9s %s  %s" % (name, status, got))
+    return 0 if ok else 1
+
+# ============================================================================
+# Main
+# ============================================================================
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("spec", nargs="?", help="batch spec (JSON)")
+    parser.add_argument("--out", default="provision-out", help="output directory")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="worker processes (default: all cores)")
+    parser.add_argument("--csv-only", action="store_true", help="skip the nvs_factory images")
+    parser.add_argument("--nvs-gen", help="nvs_partition_gen command (default: $IDF_PATH copy, else the pip package)")
+    parser.add_argument("--force", action="store_true", help="overwrite an existing output directory")
+    parser.add_argument("--self-test", action="store_true", help="check the payload and verifier code and exit")
+    args = parser.parse_args()
+
+    if args.self_test:
+        return self_test()
+    if not args.spec:
+        parser.error("a batch spec is required")
+
+    with open(args.spec) as f:
+        units = plan_batch(json.load(f))
+    if not units:
+        parser.error("the batch spec has no devices")
+
+    if os.path.exists(args.out):
+        if not args.force:
+            parser.error("%s exists (use --force to overwrite)" % args.out)
+        shutil.rmtree(args.out)
+    os.makedirs(os.path.join(args.out, "devices"))
+
+    nvs_gen = None
+    if not args.csv_only:
+        nvs_gen = args.nvs_gen.split() if args.nvs_gen else nvs_generator_command()
+
+    start = time.monotonic()
+    jobs = [(unit, args.out, nvs_gen) for unit in units]
+    records = []
+    with multiprocessing.Pool(args.jobs) as pool:
+        for record in pool.imap(provision_unit, jobs, chunksize=max(1, len(jobs) // (args.jobs * 16))):
+            records.append(record)
+            if len(records) % 500 == 0:
+                print("%d/%d units" % (len(records), len(units)), flush=True)
+    elapsed = time.monotonic() - start
+
+    manifest_path = os.path.join(args.out, "manifest.csv")
+    with open(manifest_path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(records[0].keys()))
+        writer.writeheader()
+        writer.writerows(records)
+
+    print("Provisioned %d units in %.1f s (%.1f units/s, %d workers)" %
+          (len(records), elapsed, len(records) / elapsed, args.jobs))
+    print("Manifest: %s" % manifest_path)
+    if nvs_gen:
+        print("Flash:    esptool.py write_flash 0x%X %s/devices/<serial>.bin" % (NVS_PARTITION_OFFSET, args.out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
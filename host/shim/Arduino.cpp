@@ -0,0 +1,58 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <thread>
+
+static HostLogLevel sLogLevel = HOST_LOG_INFO;
+static const auto sStartTime = std::chrono::steady_clock::now();
+static bool sSimulatedClock = false;
+static unsigned long sSimulatedUs = 0;
+
+void hostSetLogLevel(HostLogLevel level) {
+  sLogLevel = level;
+}
+
+void hostLog(HostLogLevel level, const char *format, ...) {
+  if (level > sLogLevel) {
+    return;
+  }
+  static const char kLevelTag[] = "NEWIDV";
+  fprintf(stderr, "[%6lu][%c] ", millis(), kLevelTag[level]);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+unsigned long millis() {
+  if (sSimulatedClock) {
+    return sSimulatedUs / 1000;
+  }
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sStartTime).count();
+}
+
+unsigned long micros() {
+  if (sSimulatedClock) {
+    return sSimulatedUs;
+  }
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sStartTime).count();
+}
+
+void delay(uint32_t ms) {
+  if (sSimulatedClock) {
+    hostAdvanceClock(ms);
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void hostUseSimulatedClock(unsigned long startMs) {
+  sSimulatedClock = true;
+  sSimulatedUs = startMs * 1000;
+}
+
+void hostAdvanceClock(unsigned long ms) {
+  sSimulatedUs += ms * 1000;
+}
@@ -0,0 +1,52 @@
+#ifndef HOST_SHIM_ARDUINO_H
+#define HOST_SHIM_ARDUINO_H
+
+// Minimal Arduino core for host builds of the fan endpoint logic.
+// Only what MatterMultiSpeedFan and friends use is provided.
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+#ifndef HIGH
+#define HIGH 0x1
+#define LOW 0x0
+#endif
+
+// Log levels, same order as ARDUHAL_LOG_LEVEL_*
+enum HostLogLevel : uint8_t {
+  HOST_LOG_NONE = 0,
+  HOST_LOG_ERROR = 1,
+  HOST_LOG_WARN = 2,
+  HOST_LOG_INFO = 3,
+  HOST_LOG_DEBUG = 4,
+  HOST_LOG_VERBOSE = 5
+};
+
+void hostSetLogLevel(HostLogLevel level);
+void hostLog(HostLogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#define log_e(format, ...) hostLog(HOST_LOG_ERROR, format, ##__VA_ARGS__)
+#define log_w(format, ...) hostLog(HOST_LOG_WARN, format, ##__VA_ARGS__)
+#define log_i(format, ...) hostLog(HOST_LOG_INFO, format, ##__VA_ARGS__)
+#define log_d(format, ...) hostLog(HOST_LOG_DEBUG, format, ##__VA_ARGS__)
+#define log_v(format, ...) hostLog(HOST_LOG_VERBOSE, format, ##__VA_ARGS__)
+
+// Milliseconds since the process started (monotonic clock)
+unsigned long millis();
+// Microseconds since the process started (monotonic clock)
+unsigned long micros();
+void delay(uint32_t ms);
+
+// Simulated clock for host tests: from here on millis()/micros() start at startMs
+// and only move with hostAdvanceClock() (and delay(), which advances instead of sleeping)
+void hostUseSimulatedClock(unsigned long startMs);
+void hostAdvanceClock(unsigned long ms);
+
+#ifndef portMAX_DELAY
+#define portMAX_DELAY 0xFFFFFFFF
+#endif
+
+#endif // HOST_SHIM_ARDUINO_H
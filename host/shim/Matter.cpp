@@ -0,0 +1,46 @@
+#include "Matter.h"
+#include "MatterEndPoint.h"
+
+using namespace esp_matter;
+
+ArduinoMatter Matter;
+
+static bool sCommissioned = false;
+
+// Same dispatch as the Arduino Matter library: PRE_UPDATE goes to the endpoint object in priv_data
+static esp_err_t app_attribute_update_cb(
+  attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+  uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data
+) {
+  MatterEndPoint *ep = (MatterEndPoint *)priv_data;
+  if (type == attribute::PRE_UPDATE && ep != nullptr) {
+    return ep->attributeChangeCB(endpoint_id, cluster_id, attribute_id, val) ? ESP_OK : ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t app_identification_cb(
+  identification::callback_type_t type, uint16_t endpoint_id, uint8_t effect_id, uint8_t effect_variant, void *priv_data
+) {
+  return ESP_OK;
+}
+
+void ArduinoMatter::_init() {
+  if (node::get() != nullptr) {
+    return;
+  }
+  node::config_t node_config;
+  node::create(&node_config, app_attribute_update_cb, app_identification_cb);
+}
+
+bool ArduinoMatter::isDeviceCommissioned() {
+  return sCommissioned;
+}
+
+void ArduinoMatter::decommission() {
+  sCommissioned = false;
+}
+
+void ArduinoMatter::setCommissioned(bool commissioned) {
+  sCommissioned = commissioned;
+}
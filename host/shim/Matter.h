@@ -0,0 +1,21 @@
+#ifndef HOST_SHIM_MATTER_H
+#define HOST_SHIM_MATTER_H
+
+#include <Arduino.h>
+#include <esp_matter.h>
+
+// Host version of the Arduino Matter singleton. The node and its attribute
+// callback are created on first use, exactly like ArduinoMatter::_init().
+class ArduinoMatter {
+public:
+  static void _init();
+  static bool isDeviceCommissioned();
+  static void decommission();
+
+  // Host backends set the commissioning state they observe
+  static void setCommissioned(bool commissioned);
+};
+
+extern ArduinoMatter Matter;
+
+#endif // HOST_SHIM_MATTER_H
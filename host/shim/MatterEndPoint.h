@@ -0,0 +1,52 @@
+#ifndef HOST_SHIM_MATTER_END_POINT_H
+#define HOST_SHIM_MATTER_END_POINT_H
+
+#include <esp_matter.h>
+
+// Host version of the Arduino Matter endpoint base class
+class MatterEndPoint {
+public:
+  virtual ~MatterEndPoint() {}
+
+  uint16_t getEndPointId() {
+    return endpoint_id;
+  }
+
+  void setEndPointId(uint16_t ep) {
+    endpoint_id = ep;
+  }
+
+  esp_matter::attribute_t *getAttribute(uint32_t clusterId, uint32_t attributeId) {
+    return esp_matter::attribute::get(endpoint_id, clusterId, attributeId);
+  }
+
+  bool getAttributeVal(uint32_t clusterId, uint32_t attributeId, esp_matter_attr_val_t *attrVal) {
+    esp_matter::attribute_t *attribute = getAttribute(clusterId, attributeId);
+    if (attribute == nullptr) {
+      log_e("Endpoint %d: attribute 0x%04" PRIx32 " of cluster 0x%04" PRIx32 " not found", endpoint_id, attributeId, clusterId);
+      return false;
+    }
+    return esp_matter::attribute::get_val(attribute, attrVal) == ESP_OK;
+  }
+
+  bool setAttributeVal(uint32_t clusterId, uint32_t attributeId, esp_matter_attr_val_t *attrVal) {
+    esp_matter::attribute_t *attribute = getAttribute(clusterId, attributeId);
+    if (attribute == nullptr) {
+      log_e("Endpoint %d: attribute 0x%04" PRIx32 " of cluster 0x%04" PRIx32 " not found", endpoint_id, attributeId, clusterId);
+      return false;
+    }
+    return esp_matter::attribute::set_val(attribute, attrVal) == ESP_OK;
+  }
+
+  bool updateAttributeVal(uint32_t clusterId, uint32_t attributeId, esp_matter_attr_val_t *attrVal) {
+    return esp_matter::attribute::update(endpoint_id, clusterId, attributeId, attrVal) == ESP_OK;
+  }
+
+  // Called from the node attribute callback on PRE_UPDATE
+  virtual bool attributeChangeCB(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val) = 0;
+
+protected:
+  uint16_t endpoint_id = 0;
+};
+
+#endif // HOST_SHIM_MATTER_END_POINT_H
@@ -0,0 +1,30 @@
+#ifndef HOST_SHIM_ESP_HEAP_CAPS_H
+#define HOST_SHIM_ESP_HEAP_CAPS_H
+
+// Host version of the ESP-IDF heap capabilities API.
+// Allocations go to malloc; the host heap has no meaningful free size, so it reads as 0.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+  return malloc(size);
+}
+
+inline void heap_caps_free(void *ptr) {
+  free(ptr);
+}
+
+inline size_t heap_caps_get_free_size(uint32_t caps) {
+  return 0;
+}
+
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  return 0;
+}
+
+#endif // HOST_SHIM_ESP_HEAP_CAPS_H
@@ -0,0 +1,268 @@
+#ifndef HOST_SHIM_ESP_MATTER_H
+#define HOST_SHIM_ESP_MATTER_H
+
+// Host implementation of the subset of the esp_matter data model API used by the
+// fan endpoint code. Endpoints, clusters and attributes live in an in-memory store;
+// a backend (CHIP Linux platform, benchmark recorder, ...) plugs in through
+// esp_matter::host to serve them to the outside world.
+
+#include <Arduino.h>
+
+#include <app-common/zap-generated/cluster-enums.h>
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+
+// ============================================================================
+// esp_err_t
+// ============================================================================
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_FOUND 0x105
+
+// ============================================================================
+// Attribute values
+// ============================================================================
+#define ESP_MATTER_VAL_NULLABLE_BASE 0x80
+
+typedef enum {
+  ESP_MATTER_VAL_TYPE_INVALID = 0,
+  ESP_MATTER_VAL_TYPE_BOOLEAN = 2,
+  ESP_MATTER_VAL_TYPE_INTEGER = 3,
+  ESP_MATTER_VAL_TYPE_FLOAT = 4,
+  ESP_MATTER_VAL_TYPE_ARRAY = 5,
+  ESP_MATTER_VAL_TYPE_CHAR_STRING = 6,
+  ESP_MATTER_VAL_TYPE_OCTET_STRING = 7,
+  ESP_MATTER_VAL_TYPE_INT8 = 8,
+  ESP_MATTER_VAL_TYPE_UINT8 = 9,
+  ESP_MATTER_VAL_TYPE_INT16 = 10,
+  ESP_MATTER_VAL_TYPE_UINT16 = 11,
+  ESP_MATTER_VAL_TYPE_INT32 = 12,
+  ESP_MATTER_VAL_TYPE_UINT32 = 13,
+  ESP_MATTER_VAL_TYPE_INT64 = 14,
+  ESP_MATTER_VAL_TYPE_UINT64 = 15,
+  ESP_MATTER_VAL_TYPE_ENUM8 = 16,
+  ESP_MATTER_VAL_TYPE_BITMAP8 = 17,
+  ESP_MATTER_VAL_TYPE_BITMAP16 = 18,
+  ESP_MATTER_VAL_TYPE_BITMAP32 = 19,
+  ESP_MATTER_VAL_TYPE_ENUM16 = 20,
+  ESP_MATTER_VAL_TYPE_NULLABLE_UINT8 = ESP_MATTER_VAL_NULLABLE_BASE + ESP_MATTER_VAL_TYPE_UINT8,
+  ESP_MATTER_VAL_TYPE_NULLABLE_UINT16 = ESP_MATTER_VAL_NULLABLE_BASE + ESP_MATTER_VAL_TYPE_UINT16,
+  ESP_MATTER_VAL_TYPE_NULLABLE_ENUM8 = ESP_MATTER_VAL_NULLABLE_BASE + ESP_MATTER_VAL_TYPE_ENUM8,
+} esp_matter_val_type_t;
+
+typedef union {
+  bool b;
+  int i;
+  float f;
+  int8_t i8;
+  uint8_t u8;
+  int16_t i16;
+  uint16_t u16;
+  int32_t i32;
+  uint32_t u32;
+  int64_t i64;
+  uint64_t u64;
+  struct {
+    uint8_t *b;
+    uint16_t s;
+    uint16_t n;
+    uint16_t t;
+  } a;
+  void *p;
+} esp_matter_val_t;
+
+typedef struct {
+  esp_matter_val_type_t type;
+  esp_matter_val_t val;
+} esp_matter_attr_val_t;
+
+esp_matter_attr_val_t esp_matter_invalid(void *val);
+
+namespace esp_matter {
+
+typedef struct host_node node_t;
+typedef struct host_endpoint endpoint_t;
+typedef struct host_cluster cluster_t;
+typedef struct host_attribute attribute_t;
+typedef struct host_command command_t;
+
+enum attribute_flags {
+  ATTRIBUTE_FLAG_NONE = 0x00,
+  ATTRIBUTE_FLAG_WRITABLE = 0x01,
+  ATTRIBUTE_FLAG_NULLABLE = 0x04,
+  ATTRIBUTE_FLAG_NONVOLATILE = 0x40,
+};
+
+enum endpoint_flags {
+  ENDPOINT_FLAG_NONE = 0x00,
+  ENDPOINT_FLAG_DESTROYABLE = 0x01,
+  ENDPOINT_FLAG_BRIDGE = 0x02,
+};
+
+enum cluster_flags {
+  CLUSTER_FLAG_NONE = 0x00,
+  CLUSTER_FLAG_SERVER = 0x01,
+  CLUSTER_FLAG_CLIENT = 0x02,
+};
+
+template <typename T> struct nullable {
+  T value = T();
+  bool null = true;
+  nullable &operator=(T v) {
+    value = v;
+    null = false;
+    return *this;
+  }
+  bool is_null() const { return null; }
+};
+
+namespace attribute {
+typedef enum callback_type {
+  PRE_UPDATE,
+  POST_UPDATE,
+  READ,
+  WRITE,
+} callback_type_t;
+
+typedef esp_err_t (*callback_t)(callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+                                esp_matter_attr_val_t *val, void *priv_data);
+
+attribute_t *create(cluster_t *cluster, uint32_t attribute_id, uint16_t flags, esp_matter_attr_val_t val);
+attribute_t *get(cluster_t *cluster, uint32_t attribute_id);
+attribute_t *get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id);
+attribute_t *get_first(cluster_t *cluster);
+attribute_t *get_next(attribute_t *attribute);
+uint32_t get_id(attribute_t *attribute);
+uint16_t get_flags(attribute_t *attribute);
+esp_err_t set_val(attribute_t *attribute, esp_matter_attr_val_t *val);
+esp_err_t get_val(attribute_t *attribute, esp_matter_attr_val_t *val);
+
+// Runs PRE_UPDATE, stores the value, runs POST_UPDATE and reports it
+esp_err_t update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val);
+// Marks the attribute as changed for subscribers
+esp_err_t report(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val);
+} // namespace attribute
+
+namespace identification {
+typedef enum callback_type {
+  START,
+  STOP,
+  EFFECT,
+} callback_type_t;
+
+typedef esp_err_t (*callback_t)(callback_type_t type, uint16_t endpoint_id, uint8_t effect_id, uint8_t effect_variant,
+                                void *priv_data);
+} // namespace identification
+
+namespace node {
+typedef struct config {
+} config_t;
+
+node_t *create(config_t *config, attribute::callback_t attribute_callback, identification::callback_t identification_callback);
+node_t *get();
+} // namespace node
+
+namespace cluster {
+cluster_t *create(endpoint_t *endpoint, uint32_t cluster_id, uint8_t flags);
+cluster_t *get(endpoint_t *endpoint, uint32_t cluster_id);
+cluster_t *get_first(endpoint_t *endpoint);
+cluster_t *get_next(cluster_t *cluster);
+uint32_t get_id(cluster_t *cluster);
+} // namespace cluster
+
+// The host store has no commands; they are handled by the CHIP data model
+namespace command {
+command_t *get_first(cluster_t *cluster);
+command_t *get_next(command_t *command);
+} // namespace command
+
+namespace endpoint {
+endpoint_t *create(node_t *node, uint8_t flags, void *priv_data);
+endpoint_t *get(node_t *node, uint16_t endpoint_id);
+uint16_t get_id(endpoint_t *endpoint);
+void *get_priv_data(uint16_t endpoint_id);
+esp_err_t destroy(node_t *node, endpoint_t *endpoint);
+
+namespace fan {
+typedef struct config {
+  struct {
+    uint8_t fan_mode = 0;
+    uint8_t fan_mode_sequence = 0;
+    nullable<uint8_t> percent_setting;
+    uint8_t percent_current = 0;
+  } fan_control;
+} config_t;
+
+// Descriptor + Identify + Groups are not modelled on the host; FanControl carries the global attributes
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data);
+esp_err_t add(endpoint_t *endpoint, config_t *config);
+} // namespace fan
+
+namespace aggregator {
+typedef struct config {
+} config_t;
+
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data);
+} // namespace aggregator
+
+namespace bridged_node {
+typedef struct config {
+} config_t;
+
+// Carries BridgedDeviceBasicInformation with Reachable
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data);
+} // namespace bridged_node
+
+esp_err_t set_parent_endpoint(endpoint_t *endpoint, endpoint_t *parent_endpoint);
+// Host endpoints are published by FanDynamicEndpoint; enabling is a no-op
+esp_err_t enable(endpoint_t *endpoint);
+} // namespace endpoint
+
+namespace lock {
+typedef enum {
+  FAILED,
+  ALREADY_TAKEN,
+  SUCCESS,
+} status_t;
+
+// Host apps run everything on the CHIP event loop, so there is nothing to lock
+status_t chip_stack_lock(uint32_t ticks_to_wait);
+status_t chip_stack_unlock();
+} // namespace lock
+
+// False on the host: endpoints created after start-up are published by the host app
+bool is_started();
+
+// ============================================================================
+// Host backend hooks (not part of esp_matter)
+// ============================================================================
+namespace host {
+typedef std::function<void(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)> report_hook_t;
+
+// Data model calls made by the code under test (attribute::update()'s own store and report are not included)
+typedef enum {
+  CALL_SET_VAL,      // attribute::set_val()
+  CALL_UPDATE,       // attribute::update()
+  CALL_REPORT,       // attribute::report()
+  CALL_PRE_UPDATE,   // node attribute callback with PRE_UPDATE, depth > 1 when re-entered
+} call_t;
+
+typedef std::function<void(call_t call, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, uint8_t depth)> call_hook_t;
+
+// Endpoint id handed out by the next endpoint::create()
+void set_next_endpoint_id(uint16_t endpoint_id);
+// Called whenever an attribute is reported (attribute::update() or attribute::report())
+void set_report_hook(report_hook_t hook);
+// Called for every data model call listed in call_t (benchmark recorder)
+void set_call_hook(call_hook_t hook);
+// Drop every node, endpoint and attribute (between benchmark runs)
+void reset();
+} // namespace host
+
+} // namespace esp_matter
+
+#endif // HOST_SHIM_ESP_MATTER_H
@@ -0,0 +1,430 @@
+#include "esp_matter.h"
+
+#include <list>
+#include <vector>
+
+using namespace chip::app::Clusters;
+
+namespace esp_matter {
+
+struct host_attribute {
+  uint32_t id;
+  uint16_t flags;
+  esp_matter_attr_val_t val;
+  host_cluster *parent;
+};
+
+struct host_cluster {
+  uint32_t id;
+  uint8_t flags;
+  std::list<host_attribute> attributes;
+  host_endpoint *parent;
+};
+
+struct host_endpoint {
+  uint16_t id;
+  uint8_t flags;
+  void *priv_data;
+  std::list<host_cluster> clusters;
+  uint16_t parent_id;
+};
+
+struct host_node {
+  attribute::callback_t attribute_callback = nullptr;
+  identification::callback_t identification_callback = nullptr;
+  std::list<host_endpoint> endpoints;
+};
+
+// Never destroyed at exit: endpoint objects with static storage may still tear down after it
+static node_t *sNode = nullptr;
+static uint16_t sNextEndpointId = 1;
+static host::report_hook_t sReportHook = nullptr;
+static host::call_hook_t sCallHook = nullptr;
+static uint8_t sCallbackDepth = 0;
+
+static void recordCall(host::call_t call, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id) {
+  if (sCallHook != nullptr) {
+    sCallHook(call, endpoint_id, cluster_id, attribute_id, sCallbackDepth);
+  }
+}
+
+static uint16_t attributeEndpointId(attribute_t *attribute) {
+  return attribute->parent->parent->id;
+}
+
+static endpoint_t *findEndpoint(uint16_t endpoint_id) {
+  if (sNode == nullptr) {
+    return nullptr;
+  }
+  for (auto &ep : sNode->endpoints) {
+    if (ep.id == endpoint_id) {
+      return &ep;
+    }
+  }
+  return nullptr;
+}
+
+// ============================================================================
+// node
+// ============================================================================
+namespace node {
+node_t *create(config_t *config, attribute::callback_t attribute_callback, identification::callback_t identification_callback) {
+  if (sNode != nullptr) {
+    return nullptr;
+  }
+  sNode = new node_t();
+  sNode->attribute_callback = attribute_callback;
+  sNode->identification_callback = identification_callback;
+  return sNode;
+}
+
+node_t *get() {
+  return sNode;
+}
+} // namespace node
+
+// ============================================================================
+// endpoint
+// ============================================================================
+namespace endpoint {
+endpoint_t *create(node_t *node, uint8_t flags, void *priv_data) {
+  if (node == nullptr) {
+    return nullptr;
+  }
+  node->endpoints.push_back({sNextEndpointId++, flags, priv_data, {}, 0xFFFF});
+  return &node->endpoints.back();
+}
+
+endpoint_t *get(node_t *node, uint16_t endpoint_id) {
+  return node == sNode ? findEndpoint(endpoint_id) : nullptr;
+}
+
+uint16_t get_id(endpoint_t *endpoint) {
+  return endpoint == nullptr ? 0xFFFF : endpoint->id;
+}
+
+void *get_priv_data(uint16_t endpoint_id) {
+  endpoint_t *endpoint = findEndpoint(endpoint_id);
+  return endpoint == nullptr ? nullptr : endpoint->priv_data;
+}
+
+esp_err_t destroy(node_t *node, endpoint_t *endpoint) {
+  if (node == nullptr || endpoint == nullptr || !(endpoint->flags & ENDPOINT_FLAG_DESTROYABLE)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  node->endpoints.remove_if([endpoint](const host_endpoint &ep) { return &ep == endpoint; });
+  return ESP_OK;
+}
+
+esp_err_t set_parent_endpoint(endpoint_t *endpoint, endpoint_t *parent_endpoint) {
+  if (endpoint == nullptr || parent_endpoint == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  endpoint->parent_id = parent_endpoint->id;
+  return ESP_OK;
+}
+
+esp_err_t enable(endpoint_t *endpoint) {
+  return endpoint == nullptr ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+namespace fan {
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data) {
+  endpoint_t *endpoint = endpoint::create(node, flags, priv_data);
+  if (endpoint == nullptr) {
+    return nullptr;
+  }
+  add(endpoint, config);
+  return endpoint;
+}
+
+esp_err_t add(endpoint_t *endpoint, config_t *config) {
+  if (endpoint == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  cluster_t *fanControl = cluster::create(endpoint, FanControl::Id, CLUSTER_FLAG_SERVER);
+
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_BITMAP32;
+  val.val.u32 = 0;
+  attribute::create(fanControl, FanControl::Attributes::FeatureMap::Id, ATTRIBUTE_FLAG_NONE, val);
+  val.type = ESP_MATTER_VAL_TYPE_UINT16;
+  val.val.u16 = 4;
+  attribute::create(fanControl, FanControl::Attributes::ClusterRevision::Id, ATTRIBUTE_FLAG_NONE, val);
+  val.type = ESP_MATTER_VAL_TYPE_ENUM8;
+  val.val.u8 = config->fan_control.fan_mode;
+  attribute::create(fanControl, FanControl::Attributes::FanMode::Id, ATTRIBUTE_FLAG_WRITABLE, val);
+  val.val.u8 = config->fan_control.fan_mode_sequence;
+  attribute::create(fanControl, FanControl::Attributes::FanModeSequence::Id, ATTRIBUTE_FLAG_WRITABLE, val);
+  val.type = ESP_MATTER_VAL_TYPE_NULLABLE_UINT8;
+  val.val.u8 = config->fan_control.percent_setting.is_null() ? 0xFF : config->fan_control.percent_setting.value;
+  attribute::create(fanControl, FanControl::Attributes::PercentSetting::Id, ATTRIBUTE_FLAG_WRITABLE | ATTRIBUTE_FLAG_NULLABLE, val);
+  val.type = ESP_MATTER_VAL_TYPE_UINT8;
+  val.val.u8 = config->fan_control.percent_current;
+  attribute::create(fanControl, FanControl::Attributes::PercentCurrent::Id, ATTRIBUTE_FLAG_NONE, val);
+  return ESP_OK;
+}
+} // namespace fan
+
+namespace aggregator {
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data) {
+  return endpoint::create(node, flags, priv_data);
+}
+} // namespace aggregator
+
+namespace bridged_node {
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data) {
+  endpoint_t *endpoint = endpoint::create(node, flags, priv_data);
+  if (endpoint == nullptr) {
+    return nullptr;
+  }
+  cluster_t *basicInformation = cluster::create(endpoint, BridgedDeviceBasicInformation::Id, CLUSTER_FLAG_SERVER);
+
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_UINT16;
+  val.val.u16 = 3;
+  attribute::create(basicInformation, BridgedDeviceBasicInformation::Attributes::ClusterRevision::Id, ATTRIBUTE_FLAG_NONE, val);
+  val.type = ESP_MATTER_VAL_TYPE_BOOLEAN;
+  val.val.b = true;
+  attribute::create(basicInformation, BridgedDeviceBasicInformation::Attributes::Reachable::Id, ATTRIBUTE_FLAG_NONE, val);
+  return endpoint;
+}
+} // namespace bridged_node
+} // namespace endpoint
+
+// ============================================================================
+// cluster
+// ============================================================================
+namespace cluster {
+cluster_t *create(endpoint_t *endpoint, uint32_t cluster_id, uint8_t flags) {
+  if (endpoint == nullptr) {
+    return nullptr;
+  }
+  cluster_t *existing = get(endpoint, cluster_id);
+  if (existing != nullptr) {
+    return existing;
+  }
+  endpoint->clusters.push_back({cluster_id, flags, {}, endpoint});
+  return &endpoint->clusters.back();
+}
+
+cluster_t *get(endpoint_t *endpoint, uint32_t cluster_id) {
+  if (endpoint == nullptr) {
+    return nullptr;
+  }
+  for (auto &cl : endpoint->clusters) {
+    if (cl.id == cluster_id) {
+      return &cl;
+    }
+  }
+  return nullptr;
+}
+
+cluster_t *get_first(endpoint_t *endpoint) {
+  return endpoint == nullptr || endpoint->clusters.empty() ? nullptr : &endpoint->clusters.front();
+}
+
+cluster_t *get_next(cluster_t *cluster) {
+  if (cluster == nullptr) {
+    return nullptr;
+  }
+  auto &clusters = cluster->parent->clusters;
+  for (auto it = clusters.begin(); it != clusters.end(); ++it) {
+    if (&*it == cluster) {
+      ++it;
+      return it == clusters.end() ? nullptr : &*it;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t get_id(cluster_t *cluster) {
+  return cluster == nullptr ? 0xFFFFFFFF : cluster->id;
+}
+} // namespace cluster
+
+// ============================================================================
+// command
+// ============================================================================
+namespace command {
+command_t *get_first(cluster_t *cluster) {
+  return nullptr;
+}
+
+command_t *get_next(command_t *command) {
+  return nullptr;
+}
+} // namespace command
+
+// ============================================================================
+// attribute
+// ============================================================================
+namespace attribute {
+attribute_t *create(cluster_t *cluster, uint32_t attribute_id, uint16_t flags, esp_matter_attr_val_t val) {
+  if (cluster == nullptr) {
+    return nullptr;
+  }
+  attribute_t *existing = get(cluster, attribute_id);
+  if (existing != nullptr) {
+    return existing;
+  }
+  cluster->attributes.push_back({attribute_id, flags, val, cluster});
+  return &cluster->attributes.back();
+}
+
+attribute_t *get(cluster_t *cluster, uint32_t attribute_id) {
+  if (cluster == nullptr) {
+    return nullptr;
+  }
+  for (auto &attr : cluster->attributes) {
+    if (attr.id == attribute_id) {
+      return &attr;
+    }
+  }
+  return nullptr;
+}
+
+attribute_t *get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id) {
+  return get(cluster::get(findEndpoint(endpoint_id), cluster_id), attribute_id);
+}
+
+attribute_t *get_first(cluster_t *cluster) {
+  return cluster == nullptr || cluster->attributes.empty() ? nullptr : &cluster->attributes.front();
+}
+
+attribute_t *get_next(attribute_t *attribute) {
+  if (attribute == nullptr) {
+    return nullptr;
+  }
+  auto &attributes = attribute->parent->attributes;
+  for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+    if (&*it == attribute) {
+      ++it;
+      return it == attributes.end() ? nullptr : &*it;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t get_id(attribute_t *attribute) {
+  return attribute == nullptr ? 0xFFFFFFFF : attribute->id;
+}
+
+uint16_t get_flags(attribute_t *attribute) {
+  return attribute == nullptr ? 0 : attribute->flags;
+}
+
+static void storeVal(attribute_t *attribute, esp_matter_attr_val_t *val) {
+  // Keep the declared type, callers often pass UINT8 for ENUM8/BITMAP8 attributes
+  esp_matter_val_type_t type = attribute->val.type;
+  attribute->val.val = val->val;
+  if (type != ESP_MATTER_VAL_TYPE_INVALID) {
+    attribute->val.type = type;
+  }
+}
+
+static void markReported(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id) {
+  if (sReportHook != nullptr) {
+    sReportHook(endpoint_id, cluster_id, attribute_id);
+  }
+}
+
+esp_err_t set_val(attribute_t *attribute, esp_matter_attr_val_t *val) {
+  if (attribute == nullptr || val == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  recordCall(host::CALL_SET_VAL, attributeEndpointId(attribute), attribute->parent->id, attribute->id);
+  storeVal(attribute, val);
+  return ESP_OK;
+}
+
+esp_err_t get_val(attribute_t *attribute, esp_matter_attr_val_t *val) {
+  if (attribute == nullptr || val == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *val = attribute->val;
+  return ESP_OK;
+}
+
+esp_err_t update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val) {
+  attribute_t *attr = get(endpoint_id, cluster_id, attribute_id);
+  if (attr == nullptr) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  recordCall(host::CALL_UPDATE, endpoint_id, cluster_id, attribute_id);
+  void *priv_data = endpoint::get_priv_data(endpoint_id);
+  if (sNode->attribute_callback != nullptr) {
+    sCallbackDepth++;
+    recordCall(host::CALL_PRE_UPDATE, endpoint_id, cluster_id, attribute_id);
+    esp_err_t err = sNode->attribute_callback(PRE_UPDATE, endpoint_id, cluster_id, attribute_id, val, priv_data);
+    sCallbackDepth--;
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+  storeVal(attr, val);
+  if (sNode->attribute_callback != nullptr) {
+    sNode->attribute_callback(POST_UPDATE, endpoint_id, cluster_id, attribute_id, val, priv_data);
+  }
+  markReported(endpoint_id, cluster_id, attribute_id);
+  return ESP_OK;
+}
+
+esp_err_t report(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val) {
+  if (get(endpoint_id, cluster_id, attribute_id) == nullptr) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  recordCall(host::CALL_REPORT, endpoint_id, cluster_id, attribute_id);
+  markReported(endpoint_id, cluster_id, attribute_id);
+  return ESP_OK;
+}
+} // namespace attribute
+
+// ============================================================================
+// lock
+// ============================================================================
+namespace lock {
+status_t chip_stack_lock(uint32_t ticks_to_wait) {
+  return SUCCESS;
+}
+
+status_t chip_stack_unlock() {
+  return SUCCESS;
+}
+} // namespace lock
+
+bool is_started() {
+  return false;
+}
+
+// ============================================================================
+// host backend hooks
+// ============================================================================
+namespace host {
+void set_next_endpoint_id(uint16_t endpoint_id) {
+  sNextEndpointId = endpoint_id;
+}
+
+void set_report_hook(report_hook_t hook) {
+  sReportHook = hook;
+}
+
+void set_call_hook(call_hook_t hook) {
+  sCallHook = hook;
+}
+
+void reset() {
+  delete sNode;
+  sNode = nullptr;
+  sNextEndpointId = 1;
+}
+} // namespace host
+
+} // namespace esp_matter
+
+esp_matter_attr_val_t esp_matter_invalid(void *val) {
+  esp_matter_attr_val_t attr_val = {};
+  attr_val.type = ESP_MATTER_VAL_TYPE_INVALID;
+  attr_val.val.p = val;
+  return attr_val;
+}
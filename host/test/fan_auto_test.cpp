@@ -0,0 +1,170 @@
+/*
+  Auto mode controller (FanAutoController) on a simulated temperature.
+
+  Planner: levels turn on at their threshold, turn off only below the
+  hysteresis, and a jump over several levels is one step of the planner.
+  Control loop: a jump is one actuation, a crossing within the dwell time is
+  deferred and re-evaluated at its end with the temperature of that moment,
+  and a crossing that has passed again by then costs no actuation at all.
+*/
+
+#include <FanAutoController.h>
+#include <FanSensorSource.h>
+#include <Matter.h>
+#include <MatterMultiSpeedFan.h>
+
+#include <vector>
+
+#include "host_check.h"
+
+static const uint32_t kDwellMs = 60000;
+
+static FanAutoConfig testConfig() {
+  FanAutoConfig config;
+  config.startTemperature = 2600;
+  config.stepTemperature = 200;
+  config.hysteresis = 50;
+  config.minDwellMs = kDwellMs;
+  return config;
+}
+
+struct AutoFixture {
+  MatterMultiSpeedFan fan;
+  FanSimulatedSensor sensor;
+  FanAutoController controller;
+  std::vector<uint8_t> actuations;  // Every speed handed to the hardware
+
+  AutoFixture() {
+    esp_matter::host::reset();
+    fan.setAutoSupported(true);
+    CHECK(fan.begin(FAN_SPEED_HIGH, ROCK_LEFT_RIGHT));
+    fan.onChangeSpeed([this](uint8_t speed) {
+      actuations.push_back(speed);
+      return true;
+    });
+    fan.onChangeRock([](uint8_t) { return true; });
+    sensor.setSampleInterval(1000);
+    sensor.begin();
+    CHECK(controller.begin(fan, sensor, testConfig()));
+  }
+
+  // Run loop() through the given time in sample-sized steps
+  void run(uint32_t ms) {
+    for (uint32_t elapsed = 0; elapsed < ms; elapsed += 500) {
+      hostAdvanceClock(500);
+      controller.loop();
+    }
+  }
+};
+
+static void testPlanner() {
+  AutoFixture f;
+  FanAutoController &c = f.controller;
+
+  // Up at the threshold of the next level
+  CHECK_EQ(c.planSpeed(2599, 0), 0);
+  CHECK_EQ(c.planSpeed(2600, 0), 1);
+  CHECK_EQ(c.planSpeed(2799, 1), 1);
+  CHECK_EQ(c.planSpeed(2800, 1), 2);
+
+  // Down only below the hysteresis
+  CHECK_EQ(c.planSpeed(2750, 2), 2);
+  CHECK_EQ(c.planSpeed(2749, 2), 1);
+  CHECK_EQ(c.planSpeed(2550, 1), 1);
+  CHECK_EQ(c.planSpeed(2549, 1), 0);
+  // Inside the hysteresis the result depends on where the fan comes from
+  CHECK_EQ(c.planSpeed(2780, 1), 1);
+  CHECK_EQ(c.planSpeed(2780, 2), 2);
+
+  // Jumps over several levels, both ways, capped at speedMax
+  CHECK_EQ(c.planSpeed(3000, 0), 3);
+  CHECK_EQ(c.planSpeed(4000, 0), 3);
+  CHECK_EQ(c.planSpeed(2549, 3), 0);
+  CHECK_EQ(c.planSpeed(2700, 3), 1);
+  CHECK_EQ(c.planSpeed(FAN_TEMPERATURE_MIN, 3), 0);
+
+  // Bands: [on - hysteresis, next on)
+  int16_t low, high;
+  c.bandForSpeed(0, low, high);
+  CHECK_EQ(low, FAN_TEMPERATURE_MIN);
+  CHECK_EQ(high, 2600);
+  c.bandForSpeed(1, low, high);
+  CHECK_EQ(low, 2550);
+  CHECK_EQ(high, 2800);
+  c.bandForSpeed(3, low, high);
+  CHECK_EQ(low, 2950);
+  CHECK_EQ(high, FAN_TEMPERATURE_MAX);
+}
+
+static void testJumpIsOneActuation() {
+  AutoFixture f;
+  CHECK(f.fan.setAutoMode(true));
+  f.run(1000);
+  CHECK(f.controller.isActive());
+  CHECK_EQ(f.fan.getSpeed(), 0);
+
+  f.sensor.setTemperature(3000);
+  f.run(500);
+  CHECK_EQ(f.fan.getSpeed(), 3);
+  CHECK_EQ(f.actuations.size(), 1);
+  CHECK_EQ(f.actuations.back(), 3);
+  CHECK_EQ(f.controller.getSpeedChangeCount(), 1);
+  CHECK(f.fan.isAutoMode());
+}
+
+static void testDwell() {
+  AutoFixture f;
+  CHECK(f.fan.setAutoMode(true));
+  f.sensor.setTemperature(3000);
+  f.run(500);
+  CHECK_EQ(f.fan.getSpeed(), 3);
+  uint32_t changeTime = millis();
+
+  // A dip within the dwell time is held back ...
+  f.run(10000);
+  f.sensor.setTemperature(2500);
+  f.run(500);
+  CHECK_EQ(f.fan.getSpeed(), 3);
+  CHECK_EQ(f.controller.getDeferredCount(), 1);
+  // ... and loop() wants to run again when the dwell time is over
+  CHECK((int32_t)(f.controller.getNextWakeTime() - (changeTime + kDwellMs)) <= 0);
+
+  // Gone again before the dwell time ends: the re-evaluation keeps the speed
+  f.sensor.setTemperature(3000);
+  f.run(kDwellMs);
+  CHECK_EQ(f.fan.getSpeed(), 3);
+  CHECK_EQ(f.actuations.size(), 1);
+  CHECK_EQ(f.controller.getSpeedChangeCount(), 1);
+
+  // Past the dwell time a crossing acts at once
+  f.sensor.setTemperature(2500);
+  f.run(500);
+  CHECK_EQ(f.fan.getSpeed(), 0);
+  CHECK_EQ(f.actuations.size(), 2);
+
+  // Deferred, then re-evaluated with the temperature at the end of the dwell time
+  f.run(1000);
+  f.sensor.setTemperature(2850);
+  f.run(500);
+  CHECK_EQ(f.fan.getSpeed(), 0);
+  CHECK_EQ(f.controller.getDeferredCount(), 2);
+  f.sensor.setTemperature(2650);
+  f.run(kDwellMs);
+  CHECK_EQ(f.fan.getSpeed(), 1);
+  CHECK_EQ(f.actuations.size(), 3);
+  CHECK_EQ(f.actuations.back(), 1);
+
+  // Leaving Auto hands the band back
+  CHECK(f.fan.setAutoMode(false));
+  f.run(500);
+  CHECK(!f.controller.isActive());
+}
+
+int main() {
+  hostSetLogLevel(HOST_LOG_ERROR);
+  hostUseSimulatedClock(1000000);
+  testPlanner();
+  testJumpIsOneActuation();
+  testDwell();
+  return hostCheckResult("fan-auto-test");
+}
@@ -0,0 +1,119 @@
+/*
+  Idle policy of loop() (FanIdlePolicy).
+
+  keepAwake() wins over every deadline, the earliest deadline wins, waits are
+  clamped to [minSleepMs, maxSleepMs], a deadline in the past means no wait,
+  and deadlines and statistics survive millis() wrapping around.
+*/
+
+#include <FanIdlePolicy.h>
+
+#include "host_check.h"
+
+static void testKeepAwake() {
+  FanIdlePolicy policy;
+  policy.setSleepLimits(5, 1000);
+  policy.beginCycle(100);
+  policy.wakeAt(600);
+  policy.keepAwake();
+  CHECK_EQ(policy.planSleep(), 0);
+  CHECK_EQ(policy.getBusyCycleCount(), 1);
+
+  // The next pass starts over
+  policy.beginCycle(200);
+  policy.wakeAt(600);
+  CHECK_EQ(policy.planSleep(), 400);
+  CHECK_EQ(policy.getBusyCycleCount(), 1);
+}
+
+static void testEarliestDeadline() {
+  FanIdlePolicy policy;
+  policy.setSleepLimits(5, 1000);
+  policy.beginCycle(1000);
+  policy.wakeAt(1500);
+  policy.wakeAt(1200);
+  policy.wakeAt(1800);
+  CHECK_EQ(policy.planSleep(), 200);
+}
+
+static void testClamping() {
+  FanIdlePolicy policy;
+  policy.setSleepLimits(5, 1000);
+
+  policy.beginCycle(1000);
+  CHECK_EQ(policy.planSleep(), 1000);  // No deadline: maxSleepMs
+
+  policy.beginCycle(1000);
+  policy.wakeAt(9000);
+  CHECK_EQ(policy.planSleep(), 1000);
+
+  policy.beginCycle(1000);
+  policy.wakeAt(1004);
+  CHECK_EQ(policy.planSleep(), 0);     // Below minSleepMs: not worth sleeping
+
+  policy.beginCycle(1000);
+  policy.wakeAt(1005);
+  CHECK_EQ(policy.planSleep(), 5);
+
+  policy.setSleepLimits(0, 250);
+  policy.beginCycle(1000);
+  CHECK_EQ(policy.planSleep(), 250);
+}
+
+static void testPastDeadline() {
+  FanIdlePolicy policy;
+  policy.setSleepLimits(5, 1000);
+  policy.beginCycle(1000);
+  policy.wakeAt(900);
+  CHECK_EQ(policy.planSleep(), 0);
+
+  policy.beginCycle(1000);
+  policy.wakeAt(1000);
+  CHECK_EQ(policy.planSleep(), 0);
+
+  // A past deadline also beats a later one
+  policy.beginCycle(1000);
+  policy.wakeAt(1500);
+  policy.wakeAt(999);
+  CHECK_EQ(policy.planSleep(), 0);
+}
+
+static void testWraparound() {
+  FanIdlePolicy policy;
+  policy.setSleepLimits(5, 1000);
+
+  // Deadline after the wrap
+  policy.beginCycle(0xFFFFFF00);
+  policy.wakeAt(0x00000010);
+  CHECK_EQ(policy.planSleep(), 0x110);
+
+  // A deadline before the wrap is earlier than one after it
+  policy.beginCycle(0xFFFFFF00);
+  policy.wakeAt(0x00000010);
+  policy.wakeAt(0xFFFFFFF0);
+  CHECK_EQ(policy.planSleep(), 0xF0);
+
+  // A deadline before the wrap is in the past once millis() has wrapped
+  policy.beginCycle(0x00000010);
+  policy.wakeAt(0xFFFFFFF0);
+  CHECK_EQ(policy.planSleep(), 0);
+
+  // Statistics across the wrap
+  policy.resetStats(0xFFFFFF00);
+  policy.recordSleep(0xFFFFFFF0, 0x00000010, FAN_WAKE_TIMER);
+  CHECK_EQ(policy.getAsleepMs(), 0x20);
+  CHECK_EQ(policy.getAwakeMs(0x00000100), 0x200 - 0x20);
+  CHECK_EQ(policy.getSleepCount(), 1);
+  CHECK_EQ(policy.getWakeCount(FAN_WAKE_TIMER), 1);
+  CHECK_EQ(policy.getWakeCount(FAN_WAKE_GPIO), 0);
+}
+
+int main() {
+  hostSetLogLevel(HOST_LOG_ERROR);
+  testKeepAwake();
+  testEarliestDeadline();
+  testClamping();
+  testPastDeadline();
+  testWraparound();
+  return hostCheckResult("fan-idle-test");
+}
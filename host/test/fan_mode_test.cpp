@@ -0,0 +1,78 @@
+/*
+  FanMode round trip of MatterMultiSpeedFan.
+
+  For every speedMax from 1 to 10, a controller write of each FanMode in the
+  advertised FanModeSequence must read back as the same FanMode, with the speed
+  that speedForFanMode() resolves it to. On and Smart (without Auto) store High.
+  Every speed level maps back to a mode whose speed band contains it.
+*/
+
+#include <Matter.h>
+#include <MatterMultiSpeedFan.h>
+
+#include <memory>
+
+#include "host_check.h"
+
+using namespace chip::app::Clusters;
+
+// A controller write arrives through the data model exactly like attribute::update()
+static void controllerWrite(MatterMultiSpeedFan &fan, uint32_t attributeId, uint8_t value) {
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_UINT8;
+  val.val.u8 = value;
+  esp_matter::attribute::update(fan.getEndPointId(), FanControl::Id, attributeId, &val);
+}
+
+static uint8_t readAttribute(MatterMultiSpeedFan &fan, uint32_t attributeId) {
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  fan.getAttributeVal(FanControl::Id, attributeId, &val);
+  return val.val.u8;
+}
+
+static void checkRoundTrip(uint8_t speedMax) {
+  esp_matter::host::reset();
+  std::unique_ptr<MatterMultiSpeedFan> fan(new MatterMultiSpeedFan());
+  CHECK(fan->begin(speedMax, ROCK_LEFT_RIGHT));
+  fan->onChangeSpeed([](uint8_t) { return true; });
+  fan->onChangeRock([](uint8_t) { return true; });
+
+  FanControl::FanModeEnum advertised[] = {FanControl::FanModeEnum::kOff, FanControl::FanModeEnum::kLow,
+                                          FanControl::FanModeEnum::kMedium, FanControl::FanModeEnum::kHigh};
+  bool hasLow = speedMax >= 2;
+  bool hasMedium = speedMax >= 3;
+  for (FanControl::FanModeEnum mode : advertised) {
+    if ((mode == FanControl::FanModeEnum::kLow && !hasLow) || (mode == FanControl::FanModeEnum::kMedium && !hasMedium)) {
+      continue;
+    }
+    uint8_t fanMode = static_cast<uint8_t>(mode);
+    controllerWrite(*fan, FanControl::Attributes::FanMode::Id, fanMode);
+    uint8_t stored = readAttribute(*fan, FanControl::Attributes::FanMode::Id);
+    if (stored != fanMode) {
+      fprintf(stderr, "speedMax %u: FanMode %u stored as %u\n", speedMax, fanMode, stored);
+    }
+    CHECK_EQ(stored, fanMode);
+    CHECK_EQ(readAttribute(*fan, FanControl::Attributes::SpeedSetting::Id), fan->speedForFanMode(fanMode));
+  }
+
+  uint8_t high = static_cast<uint8_t>(FanControl::FanModeEnum::kHigh);
+  for (FanControl::FanModeEnum mode : {FanControl::FanModeEnum::kOn, FanControl::FanModeEnum::kSmart}) {
+    controllerWrite(*fan, FanControl::Attributes::FanMode::Id, static_cast<uint8_t>(mode));
+    CHECK_EQ(readAttribute(*fan, FanControl::Attributes::FanMode::Id), high);
+    CHECK_EQ(readAttribute(*fan, FanControl::Attributes::SpeedSetting::Id), speedMax);
+  }
+
+  // Speed -> mode -> speed never moves a level into a different band
+  for (uint8_t speed = 1; speed <= speedMax; speed++) {
+    uint8_t mode = fan->fanModeForSpeed(speed);
+    CHECK_EQ(fan->fanModeForSpeed(fan->speedForFanMode(mode)), mode);
+  }
+}
+
+int main() {
+  hostSetLogLevel(HOST_LOG_ERROR);
+  for (uint8_t speedMax = 1; speedMax <= 10; speedMax++) {
+    checkRoundTrip(speedMax);
+  }
+  return hostCheckResult("fan-mode-test");
+}
@@ -0,0 +1,42 @@
+#ifndef HOST_TEST_HOST_CHECK_H
+#define HOST_TEST_HOST_CHECK_H
+
+// Minimal assertion helpers for the host tests: a failed check prints where and
+// what, the test keeps running and main() returns hostCheckResult().
+
+#include <cstdio>
+
+inline int &hostCheckFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                     \
+  do {                                                                       \
+    if (!(condition)) {                                                      \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      hostCheckFailures()++;                                                 \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                               \
+  do {                                                                                           \
+    long long actualValue = (long long)(actual), expectedValue = (long long)(expected);          \
+    if (actualValue != expectedValue) {                                                          \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actualValue, \
+              expectedValue);                                                                    \
+      hostCheckFailures()++;                                                                     \
+    }                                                                                            \
+  } while (0)
+
+// Exit code of a test: prints PASS/FAIL with the test name
+inline int hostCheckResult(const char *name) {
+  if (hostCheckFailures() != 0) {
+    printf("%s: FAIL (%d failed checks)\n", name, hostCheckFailures());
+    return 1;
+  }
+  printf("%s: PASS\n", name);
+  return 0;
+}
+
+#endif // HOST_TEST_HOST_CHECK_H
@@ -0,0 +1,325 @@
+#include "FanBusMaster.h"
+
+static_assert(FAN_BUS_MAX_DEVICES * 5 <= FAN_BUS_MAX_PAYLOAD, "One POLL frame must hold every fan");
+
+#ifndef FAN_BUS_REPLY_MARGIN_MS
+#define FAN_BUS_REPLY_MARGIN_MS 10        // Poll transmit time and fan turnaround
+#endif
+
+static const uint8_t kMaxMissedReplies = 3;
+
+static bool timeReached(uint32_t nowMs, uint32_t deadlineMs) {
+  return (int32_t)(nowMs - deadlineMs) >= 0;
+}
+
+FanBusMaster::FanBusMaster() {}
+
+void FanBusMaster::begin(FanBusTransport &transport) {
+  this->transport = &transport;
+  parser.reset();
+  state = MASTER_IDLE;
+}
+
+void FanBusMaster::setPollInterval(uint32_t intervalMs) {
+  pollIntervalMs = intervalMs;
+}
+
+void FanBusMaster::setKeepAliveInterval(uint32_t intervalMs) {
+  keepAliveIntervalMs = intervalMs;
+}
+
+void FanBusMaster::onDeviceFound(DeviceFoundCallback cb) {
+  _onDeviceFoundCB = cb;
+}
+
+void FanBusMaster::onDeviceState(DeviceStateCallback cb) {
+  _onDeviceStateCB = cb;
+}
+
+void FanBusMaster::onDeviceReachable(DeviceReachableCallback cb) {
+  _onDeviceReachableCB = cb;
+}
+
+uint8_t FanBusMaster::getDeviceCount() {
+  uint8_t count = 0;
+  for (const Device &device : devices) {
+    count += device.present ? 1 : 0;
+  }
+  return count;
+}
+
+uint32_t FanBusMaster::getPollCount() {
+  return pollCount;
+}
+
+uint32_t FanBusMaster::getReplyCount() {
+  return replyCount;
+}
+
+uint32_t FanBusMaster::getCrcErrors() {
+  return parser.getCrcErrors();
+}
+
+// ============================================================================
+// Commands
+// ============================================================================
+
+bool FanBusMaster::setSpeed(uint8_t address, uint8_t speed) {
+  return queueCommand(address, FAN_BUS_POLL_SET_SPEED, speed);
+}
+
+bool FanBusMaster::setRockSetting(uint8_t address, uint8_t rockSetting) {
+  return queueCommand(address, FAN_BUS_POLL_SET_ROCK, rockSetting);
+}
+
+// Callers may run on another task than loop(), so they only touch the mailbox
+bool FanBusMaster::queueCommand(uint8_t address, uint8_t flag, uint8_t value) {
+  std::lock_guard<std::mutex> guard(commandLock);
+  if (address > FAN_BUS_MAX_ADDRESS || (knownAddresses & (1UL << address)) == 0) {
+    return false;
+  }
+  Command &command = commands[address];
+  if (flag == FAN_BUS_POLL_SET_SPEED) {
+    command.speed = value;
+  } else {
+    command.rockSetting = value;
+  }
+  command.flags |= flag;
+  return true;
+}
+
+// Move the mailbox into the device table; runs on the loop() task only
+void FanBusMaster::applyCommands() {
+  Command taken[FAN_BUS_MAX_DEVICES];
+  {
+    std::lock_guard<std::mutex> guard(commandLock);
+    for (uint8_t i = 0; i < FAN_BUS_MAX_DEVICES; i++) {
+      if (devices[i].present) {
+        taken[i] = commands[devices[i].address];
+        commands[devices[i].address].flags = 0;
+      }
+    }
+  }
+  for (uint8_t i = 0; i < FAN_BUS_MAX_DEVICES; i++) {
+    Device &device = devices[i];
+    if (!device.present || taken[i].flags == 0) {
+      continue;
+    }
+    if (taken[i].flags & FAN_BUS_POLL_SET_SPEED) {
+      device.speed = taken[i].speed;
+    }
+    if (taken[i].flags & FAN_BUS_POLL_SET_ROCK) {
+      device.rockSetting = taken[i].rockSetting;
+    }
+    device.pendingFlags |= taken[i].flags;
+    device.commandGeneration++;
+  }
+}
+
+// ============================================================================
+// Device table
+// ============================================================================
+
+FanBusMaster::Device *FanBusMaster::findDevice(uint8_t address) {
+  for (Device &device : devices) {
+    if (device.present && device.address == address) {
+      return &device;
+    }
+  }
+  return nullptr;
+}
+
+FanBusMaster::Device *FanBusMaster::addDevice(uint8_t address) {
+  for (Device &device : devices) {
+    if (!device.present) {
+      device = Device();
+      device.present = true;
+      device.address = address;
+      std::lock_guard<std::mutex> guard(commandLock);
+      commands[address] = Command();
+      knownAddresses |= 1UL << address;
+      return &device;
+    }
+  }
+  return nullptr;
+}
+
+void FanBusMaster::setReachable(Device &device, bool reachable) {
+  if (device.reachable == reachable) {
+    return;
+  }
+  device.reachable = reachable;
+  if (_onDeviceReachableCB != nullptr) {
+    _onDeviceReachableCB(device.address, reachable);
+  }
+}
+
+// ============================================================================
+// Bus cycle
+// ============================================================================
+
+void FanBusMaster::loop(uint32_t nowMs) {
+  if (transport == nullptr) {
+    return;
+  }
+  applyCommands();
+
+  int b;
+  while ((b = transport->read()) >= 0) {
+    if (parser.feed((uint8_t)b) && state != MASTER_IDLE) {
+      handleFrame(parser.frame(), nowMs);
+    }
+  }
+
+  if (state != MASTER_IDLE) {
+    if (timeReached(nowMs, replyDeadlineMs)) {
+      finishCycle();
+    }
+    return;
+  }
+
+  uint8_t deviceCount = getDeviceCount();
+  bool commandPending = false;
+  for (const Device &device : devices) {
+    commandPending |= device.present && device.pendingFlags != 0;
+  }
+
+  // The first sweep of the address range runs fast, later probes only look for new fans
+  uint32_t probeDelayMs = sweepDone ? probeIntervalMs : probeIntervalMs / FAN_BUS_MAX_ADDRESS;
+  bool probeDue = deviceCount < FAN_BUS_MAX_DEVICES && timeReached(nowMs, lastProbeMs + probeDelayMs);
+
+  // Commands go out on the next cycle; otherwise polls and probes share the bus
+  if (deviceCount > 0 && (commandPending || timeReached(nowMs, lastPollMs + pollIntervalMs))) {
+    if (probeDue && !commandPending) {
+      startProbe(nowMs);
+    } else {
+      startPoll(nowMs);
+    }
+  } else if (deviceCount == 0 && probeDue) {
+    startProbe(nowMs);
+  }
+}
+
+void FanBusMaster::startProbe(uint32_t nowMs) {
+  // Next address not already in the table
+  for (uint8_t tries = 0; tries < FAN_BUS_MAX_ADDRESS; tries++) {
+    uint8_t address = nextProbeAddress;
+    if (nextProbeAddress >= FAN_BUS_MAX_ADDRESS) {
+      nextProbeAddress = 1;
+      sweepDone = true;
+    } else {
+      nextProbeAddress++;
+    }
+    if (findDevice(address) != nullptr) {
+      continue;
+    }
+    uint8_t frame[FAN_BUS_FRAME_OVERHEAD];
+    size_t length = fanBusEncode(address, FAN_BUS_CMD_DISCOVER, nullptr, 0, frame, sizeof(frame));
+    transport->write(frame, length);
+    probeAddress = address;
+    state = MASTER_WAIT_INFO;
+    replyDeadlineMs = nowMs + (FAN_BUS_SLOT_US + 999) / 1000 + FAN_BUS_REPLY_MARGIN_MS;
+    lastProbeMs = nowMs;
+    return;
+  }
+  lastProbeMs = nowMs;
+}
+
+void FanBusMaster::startPoll(uint32_t nowMs) {
+  FanBusPollEntry entries[FAN_BUS_MAX_DEVICES];
+  uint8_t count = 0;
+  bool keepAlive = timeReached(nowMs, lastKeepAliveMs + keepAliveIntervalMs);
+
+  for (Device &device : devices) {
+    if (!device.present) {
+      continue;
+    }
+    FanBusPollEntry &entry = entries[count++];
+    entry.address = device.address;
+    entry.ackSequence = device.ackSequence;
+    entry.flags = device.pendingFlags;
+    entry.speed = device.speed;
+    entry.rockSetting = device.rockSetting;
+    // Unreachable fans are asked every cycle so they come back as soon as they answer
+    if (keepAlive || !device.reachable) {
+      entry.flags |= FAN_BUS_POLL_FORCE_REPLY;
+    }
+    device.sentGeneration = device.commandGeneration;
+    device.awaitingReply = (entry.flags & (FAN_BUS_POLL_FORCE_REPLY | FAN_BUS_POLL_SET_SPEED | FAN_BUS_POLL_SET_ROCK)) != 0;
+  }
+
+  uint8_t frame[FAN_BUS_MAX_FRAME];
+  size_t length = fanBusEncodePoll(entries, count, frame, sizeof(frame));
+  transport->write(frame, length);
+
+  state = MASTER_WAIT_STATES;
+  replyDeadlineMs = nowMs + (count * FAN_BUS_SLOT_US + 999) / 1000 + FAN_BUS_REPLY_MARGIN_MS;
+  lastPollMs = nowMs;
+  if (keepAlive) {
+    lastKeepAliveMs = nowMs;
+  }
+  pollCount++;
+}
+
+void FanBusMaster::handleFrame(const FanBusFrame &frame, uint32_t nowMs) {
+  if (state == MASTER_WAIT_INFO) {
+    FanBusInfo info;
+    if (frame.address != probeAddress || !fanBusDecodeInfo(frame, info)) {
+      return;
+    }
+    Device *device = addDevice(frame.address);
+    if (device == nullptr) {
+      return;
+    }
+    device->ackSequence = info.state.sequence;
+    device->speed = info.state.speed;
+    device->rockSetting = info.state.rockSetting;
+    device->lastReplyMs = nowMs;
+    replyCount++;
+    if (_onDeviceFoundCB != nullptr) {
+      _onDeviceFoundCB(frame.address, info);
+    }
+    setReachable(*device, true);
+    state = MASTER_IDLE;
+    return;
+  }
+
+  FanBusState reply;
+  Device *device = findDevice(frame.address);
+  if (device == nullptr || !fanBusDecodeState(frame, reply)) {
+    return;
+  }
+  replyCount++;
+  device->awaitingReply = false;
+  device->missedReplies = 0;
+  device->lastReplyMs = nowMs;
+  device->ackSequence = reply.sequence;
+  setReachable(*device, true);
+
+  // The fan applied what it was sent; anything queued since then goes out next cycle
+  if (device->pendingFlags != 0 && device->sentGeneration == device->commandGeneration) {
+    device->pendingFlags = 0;
+  }
+  if (device->pendingFlags == 0) {
+    device->speed = reply.speed;
+    device->rockSetting = reply.rockSetting;
+    if (_onDeviceStateCB != nullptr) {
+      _onDeviceStateCB(frame.address, reply);
+    }
+  }
+}
+
+void FanBusMaster::finishCycle() {
+  if (state == MASTER_WAIT_STATES) {
+    for (Device &device : devices) {
+      if (!device.present || !device.awaitingReply) {
+        continue;
+      }
+      device.awaitingReply = false;
+      if (++device.missedReplies >= kMaxMissedReplies) {
+        setReachable(device, false);
+      }
+    }
+  }
+  state = MASTER_IDLE;
+}
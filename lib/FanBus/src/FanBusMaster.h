@@ -0,0 +1,117 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include "FanBusProtocol.h"
+
+// Byte transport of the bus (UART, RS-485 transceiver, pty on Linux)
+class FanBusTransport {
+public:
+  virtual ~FanBusTransport() {}
+  virtual size_t write(const uint8_t *data, size_t length) = 0;
+  // Next received byte, or -1 when none is waiting; must not block
+  virtual int read() = 0;
+};
+
+// Bridge side of the fan bus
+//
+// loop() is a non-blocking state machine: every cycle it either probes one
+// unknown address (DISCOVER) or broadcasts one POLL for all known fans and
+// collects the replies until the last slot has passed.
+// Commands are absolute (speed, rock) and repeated in every poll until the fan
+// acknowledges them, so a lost frame only delays a change by one cycle.
+// setSpeed() and setRockSetting() may be called from any task: they only leave
+// the command in a per-address mailbox, which loop() picks up at its next call.
+class FanBusMaster {
+public:
+  typedef std::function<void(uint8_t address, const FanBusInfo &info)> DeviceFoundCallback;
+  typedef std::function<void(uint8_t address, const FanBusState &state)> DeviceStateCallback;
+  typedef std::function<void(uint8_t address, bool reachable)> DeviceReachableCallback;
+
+  FanBusMaster();
+
+  void begin(FanBusTransport &transport);
+
+  // Drive the bus; call often (every few ms) with a millisecond clock
+  void loop(uint32_t nowMs);
+
+  // Queue a command for the next poll; returns false for an unknown address
+  // Thread safe; a second command before the next loop() replaces the first
+  bool setSpeed(uint8_t address, uint8_t speed);
+  bool setRockSetting(uint8_t address, uint8_t rockSetting);
+
+  void setPollInterval(uint32_t intervalMs);
+  void setKeepAliveInterval(uint32_t intervalMs);
+
+  void onDeviceFound(DeviceFoundCallback cb);
+  void onDeviceState(DeviceStateCallback cb);
+  void onDeviceReachable(DeviceReachableCallback cb);
+
+  uint8_t getDeviceCount();
+  uint32_t getPollCount();
+  uint32_t getReplyCount();
+  uint32_t getCrcErrors();
+
+protected:
+  enum MasterState : uint8_t {
+    MASTER_IDLE,
+    MASTER_WAIT_INFO,
+    MASTER_WAIT_STATES
+  };
+
+  struct Device {
+    bool present = false;
+    bool reachable = false;
+    uint8_t address = 0;
+    uint8_t ackSequence = 0;
+    uint8_t pendingFlags = 0;       // FAN_BUS_POLL_SET_* not yet acknowledged
+    uint8_t speed = 0;              // Commanded, or last reported when nothing is pending
+    uint8_t rockSetting = 0;
+    uint8_t missedReplies = 0;      // Forced replies in a row without an answer
+    uint8_t commandGeneration = 0;  // Bumped by every command taken from the mailbox
+    uint8_t sentGeneration = 0;     // commandGeneration carried by the last poll
+    uint32_t lastReplyMs = 0;
+    bool awaitingReply = false;     // A reply is required in the current cycle
+  };
+
+  // Latest command per address, written by any task and taken by loop()
+  struct Command {
+    uint8_t flags = 0;              // FAN_BUS_POLL_SET_* waiting to be applied
+    uint8_t speed = 0;
+    uint8_t rockSetting = 0;
+  };
+
+  FanBusTransport *transport = nullptr;
+  FanBusParser parser;
+  std::mutex commandLock;               // Guards commands and knownAddresses
+  Command commands[FAN_BUS_MAX_ADDRESS + 1];
+  uint32_t knownAddresses = 0;          // Bit per address in the device table
+  MasterState state = MASTER_IDLE;
+  Device devices[FAN_BUS_MAX_DEVICES];
+  uint8_t nextProbeAddress = 1;
+  uint8_t probeAddress = 0;
+  bool sweepDone = false;               // Every address probed at least once
+  uint32_t replyDeadlineMs = 0;
+  uint32_t lastPollMs = 0;
+  uint32_t lastProbeMs = 0;
+  uint32_t lastKeepAliveMs = 0;
+  uint32_t pollIntervalMs = 50;
+  uint32_t keepAliveIntervalMs = 2000;
+  uint32_t probeIntervalMs = 1000;
+  uint32_t pollCount = 0;
+  uint32_t replyCount = 0;
+
+  DeviceFoundCallback _onDeviceFoundCB = nullptr;
+  DeviceStateCallback _onDeviceStateCB = nullptr;
+  DeviceReachableCallback _onDeviceReachableCB = nullptr;
+
+  Device *findDevice(uint8_t address);
+  Device *addDevice(uint8_t address);
+  bool queueCommand(uint8_t address, uint8_t flag, uint8_t value);
+  void applyCommands();
+  void startProbe(uint32_t nowMs);
+  void startPoll(uint32_t nowMs);
+  void handleFrame(const FanBusFrame &frame, uint32_t nowMs);
+  void finishCycle();
+  void setReachable(Device &device, bool reachable);
+};
@@ -0,0 +1,159 @@
+#include "FanBusProtocol.h"
+
+#include <string.h>
+
+static const uint8_t kPollEntrySize = 5;
+static const uint8_t kStateSize = 3;
+static const uint8_t kInfoSize = 2 + kStateSize;
+
+uint16_t fanBusCrc16(const uint8_t *data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t fanBusEncode(uint8_t address, uint8_t command, const uint8_t *payload, uint8_t length, uint8_t *out, size_t outSize) {
+  if (length > FAN_BUS_MAX_PAYLOAD || outSize < (size_t)length + FAN_BUS_FRAME_OVERHEAD) {
+    return 0;
+  }
+  out[0] = FAN_BUS_SOF;
+  out[1] = address;
+  out[2] = command;
+  out[3] = length;
+  if (length > 0) {
+    memcpy(out + 4, payload, length);
+  }
+  uint16_t crc = fanBusCrc16(out + 1, 3 + length);
+  out[4 + length] = crc & 0xFF;
+  out[5 + length] = crc >> 8;
+  return length + FAN_BUS_FRAME_OVERHEAD;
+}
+
+// ============================================================================
+// Payloads
+// ============================================================================
+
+size_t fanBusEncodePoll(const FanBusPollEntry *entries, uint8_t count, uint8_t *out, size_t outSize) {
+  uint8_t payload[FAN_BUS_MAX_PAYLOAD];
+  if ((size_t)count * kPollEntrySize > sizeof(payload)) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t *p = payload + i * kPollEntrySize;
+    p[0] = entries[i].address;
+    p[1] = entries[i].ackSequence;
+    p[2] = entries[i].flags;
+    p[3] = entries[i].speed;
+    p[4] = entries[i].rockSetting;
+  }
+  return fanBusEncode(FAN_BUS_BROADCAST, FAN_BUS_CMD_POLL, payload, count * kPollEntrySize, out, outSize);
+}
+
+uint8_t fanBusDecodePoll(const FanBusFrame &frame, FanBusPollEntry *entries, uint8_t maxEntries) {
+  if (frame.command != FAN_BUS_CMD_POLL || frame.length % kPollEntrySize != 0) {
+    return 0;
+  }
+  uint8_t count = frame.length / kPollEntrySize;
+  if (count > maxEntries) {
+    count = maxEntries;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    const uint8_t *p = frame.payload + i * kPollEntrySize;
+    entries[i] = {p[0], p[1], p[2], p[3], p[4]};
+  }
+  return count;
+}
+
+size_t fanBusEncodeState(uint8_t address, const FanBusState &state, uint8_t *out, size_t outSize) {
+  uint8_t payload[kStateSize] = {state.sequence, state.speed, state.rockSetting};
+  return fanBusEncode(address, FAN_BUS_CMD_STATE, payload, kStateSize, out, outSize);
+}
+
+bool fanBusDecodeState(const FanBusFrame &frame, FanBusState &state) {
+  if (frame.command != FAN_BUS_CMD_STATE || frame.length != kStateSize) {
+    return false;
+  }
+  state = {frame.payload[0], frame.payload[1], frame.payload[2]};
+  return true;
+}
+
+size_t fanBusEncodeInfo(uint8_t address, const FanBusInfo &info, uint8_t *out, size_t outSize) {
+  uint8_t payload[kInfoSize] = {info.speedMax, info.rockSupport, info.state.sequence, info.state.speed, info.state.rockSetting};
+  return fanBusEncode(address, FAN_BUS_CMD_INFO, payload, kInfoSize, out, outSize);
+}
+
+bool fanBusDecodeInfo(const FanBusFrame &frame, FanBusInfo &info) {
+  if (frame.command != FAN_BUS_CMD_INFO || frame.length != kInfoSize) {
+    return false;
+  }
+  info.speedMax = frame.payload[0];
+  info.rockSupport = frame.payload[1];
+  info.state = {frame.payload[2], frame.payload[3], frame.payload[4]};
+  return true;
+}
+
+// ============================================================================
+// FanBusParser
+// ============================================================================
+
+void FanBusParser::reset() {
+  state = WAIT_SOF;
+  received = 0;
+}
+
+bool FanBusParser::feed(uint8_t b) {
+  switch (state) {
+    case WAIT_SOF:
+      if (b == FAN_BUS_SOF) {
+        state = WAIT_ADDRESS;
+      }
+      break;
+    case WAIT_ADDRESS:
+      current.address = b;
+      crc = fanBusCrc16(&b, 1);
+      state = WAIT_COMMAND;
+      break;
+    case WAIT_COMMAND:
+      current.command = b;
+      crc = fanBusCrc16(&b, 1, crc);
+      state = WAIT_LENGTH;
+      break;
+    case WAIT_LENGTH:
+      if (b > FAN_BUS_MAX_PAYLOAD) {
+        reset();
+        break;
+      }
+      current.length = b;
+      crc = fanBusCrc16(&b, 1, crc);
+      received = 0;
+      state = b > 0 ? WAIT_PAYLOAD : WAIT_CRC_LOW;
+      break;
+    case WAIT_PAYLOAD:
+      current.payload[received++] = b;
+      crc = fanBusCrc16(&b, 1, crc);
+      if (received == current.length) {
+        state = WAIT_CRC_LOW;
+      }
+      break;
+    case WAIT_CRC_LOW:
+      if (b != (crc & 0xFF)) {
+        crcErrors++;
+        reset();
+        break;
+      }
+      state = WAIT_CRC_HIGH;
+      break;
+    case WAIT_CRC_HIGH:
+      reset();
+      if (b != (crc >> 8)) {
+        crcErrors++;
+        break;
+      }
+      return true;
+  }
+  return false;
+}
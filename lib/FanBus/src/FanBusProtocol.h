@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Fan Bus - framed binary protocol between a bridge and fan controllers on a
+// shared UART / RS-485 half-duplex bus
+//
+// Frame:  SOF | address | command | length | payload[length] | CRC16 (LE)
+//         CRC-16/CCITT-FALSE over address..payload
+//
+// The bridge is the only master. One POLL frame, broadcast to every known fan,
+// carries the state each fan last acknowledged plus any pending command. Fans
+// answer in their own reply slot (position in the poll, FAN_BUS_SLOT_US apart)
+// and only when their state changed or a reply was requested, so an idle bus
+// costs one frame per cycle regardless of the fan count.
+// ============================================================================
+
+#define FAN_BUS_SOF 0x7E
+#define FAN_BUS_BROADCAST 0x00
+#define FAN_BUS_MAX_PAYLOAD 64
+#define FAN_BUS_FRAME_OVERHEAD 6          // SOF, address, command, length, CRC16
+#define FAN_BUS_MAX_FRAME (FAN_BUS_MAX_PAYLOAD + FAN_BUS_FRAME_OVERHEAD)
+
+#ifndef FAN_BUS_MAX_DEVICES
+#define FAN_BUS_MAX_DEVICES 8             // Fans per bus (and poll entries per frame)
+#endif
+#ifndef FAN_BUS_MAX_ADDRESS
+#define FAN_BUS_MAX_ADDRESS 16            // Discovery scans addresses 1..FAN_BUS_MAX_ADDRESS
+#endif
+#ifndef FAN_BUS_SLOT_US
+#define FAN_BUS_SLOT_US 2000              // Reply slot: a 9-byte STATE frame takes ~0.8ms at 115200
+#endif
+
+enum FanBusCommand : uint8_t {
+  FAN_BUS_CMD_DISCOVER = 0x01,  // Bridge -> one address, no payload
+  FAN_BUS_CMD_POLL = 0x02,      // Bridge -> broadcast, FanBusPollEntry list
+  FAN_BUS_CMD_INFO = 0x81,      // Fan -> bridge, reply to DISCOVER (FanBusInfo)
+  FAN_BUS_CMD_STATE = 0x82      // Fan -> bridge, reply in its POLL slot (FanBusState)
+};
+
+enum FanBusPollFlags : uint8_t {
+  FAN_BUS_POLL_SET_SPEED = 0x01,    // Apply speed
+  FAN_BUS_POLL_SET_ROCK = 0x02,     // Apply rockSetting
+  FAN_BUS_POLL_FORCE_REPLY = 0x04   // Reply even when nothing changed (liveness check)
+};
+
+// One fan in a POLL frame (5 bytes on the wire)
+struct FanBusPollEntry {
+  uint8_t address;
+  uint8_t ackSequence;  // Last state sequence the bridge has seen from this fan
+  uint8_t flags;        // FanBusPollFlags
+  uint8_t speed;
+  uint8_t rockSetting;
+};
+
+// Fan state; sequence increments on every change, including local button presses
+struct FanBusState {
+  uint8_t sequence;
+  uint8_t speed;
+  uint8_t rockSetting;
+};
+
+// Fan capabilities, returned by DISCOVER together with the current state
+struct FanBusInfo {
+  uint8_t speedMax;
+  uint8_t rockSupport;
+  FanBusState state;
+};
+
+struct FanBusFrame {
+  uint8_t address;
+  uint8_t command;
+  uint8_t length;
+  uint8_t payload[FAN_BUS_MAX_PAYLOAD];
+};
+
+uint16_t fanBusCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+// Encode a frame into out; returns the frame size or 0 when it does not fit
+size_t fanBusEncode(uint8_t address, uint8_t command, const uint8_t *payload, uint8_t length, uint8_t *out, size_t outSize);
+
+// Payload helpers; decoders return false on a malformed payload
+size_t fanBusEncodePoll(const FanBusPollEntry *entries, uint8_t count, uint8_t *out, size_t outSize);
+uint8_t fanBusDecodePoll(const FanBusFrame &frame, FanBusPollEntry *entries, uint8_t maxEntries);
+size_t fanBusEncodeState(uint8_t address, const FanBusState &state, uint8_t *out, size_t outSize);
+bool fanBusDecodeState(const FanBusFrame &frame, FanBusState &state);
+size_t fanBusEncodeInfo(uint8_t address, const FanBusInfo &info, uint8_t *out, size_t outSize);
+bool fanBusDecodeInfo(const FanBusFrame &frame, FanBusInfo &info);
+
+// Byte-at-a-time frame parser; resynchronizes on the next SOF after any error
+class FanBusParser {
+public:
+  // Returns true when a complete, valid frame is available in frame()
+  bool feed(uint8_t b);
+  void reset();
+
+  const FanBusFrame &frame() const { return current; }
+  uint32_t getCrcErrors() const { return crcErrors; }
+
+protected:
+  enum ParserState : uint8_t {
+    WAIT_SOF,
+    WAIT_ADDRESS,
+    WAIT_COMMAND,
+    WAIT_LENGTH,
+    WAIT_PAYLOAD,
+    WAIT_CRC_LOW,
+    WAIT_CRC_HIGH
+  };
+
+  ParserState state = WAIT_SOF;
+  FanBusFrame current = {};
+  uint8_t received = 0;
+  uint16_t crc = 0;
+  uint32_t crcErrors = 0;
+};
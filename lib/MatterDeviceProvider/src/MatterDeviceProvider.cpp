@@ -4,6 +4,11 @@
 #include <setup_payload/ManualSetupPayloadGenerator.h>
 #include <setup_payload/QRCodeSetupPayloadGenerator.h>
 #include <setup_payload/SetupPayload.h>
+#if MATTER_DEVICE_FACTORY_PARTITION
+#include <lib/support/Base64.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#endif
 
 // Static instances (must survive for the lifetime of the process)
 static MatterDeviceInstanceInfoProvider sDeviceInstanceInfoProvider;
@@ -13,6 +18,22 @@ static MatterCommissionableDataProvider sCommissionableDataProvider;
 static char sManualPairingCode[22];  // max 21 chars + null
 static char sQRCodeUrl[256];
 
+// Per-device values: build flags, replaced by the factory partition when enabled
+struct MatterDeviceData {
+    char serialNumber[33];
+    uint32_t passcode;
+    uint16_t discriminator;
+    uint32_t iterationCount;
+    uint8_t salt[chip::Crypto::kSpake2p_Max_PBKDF_Salt_Length];
+    size_t saltLen;
+    chip::Crypto::Spake2pVerifierSerialized verifier;
+    size_t verifierLen;
+    uint8_t rotatingIdUniqueId[32];
+    size_t rotatingIdUniqueIdLen;
+    bool fromFactoryPartition;
+};
+static MatterDeviceData sDeviceData;
+
 // ============================================================================
 // Helper
 // ============================================================================
@@ -70,7 +91,7 @@ CHIP_ERROR MatterDeviceInstanceInfoProvider::GetProductLabel(char * buf, size_t
 
 CHIP_ERROR MatterDeviceInstanceInfoProvider::GetSerialNumber(char * buf, size_t bufSize)
 {
-    return CopyString(MATTER_DEVICE_SERIAL_NUMBER, buf, bufSize);
+    return CopyString(sDeviceData.serialNumber, buf, bufSize);
 }
 
 CHIP_ERROR MatterDeviceInstanceInfoProvider::GetManufacturingDate(uint16_t & year, uint8_t & month, uint8_t & day)
@@ -107,16 +128,11 @@ CHIP_ERROR MatterDeviceInstanceInfoProvider::GetHardwareVersionString(char * buf
 
 CHIP_ERROR MatterDeviceInstanceInfoProvider::GetRotatingDeviceIdUniqueId(chip::MutableByteSpan & uniqueIdSpan)
 {
-    // 16-byte unique ID - in production this should be truly unique per device
-    static const uint8_t kUniqueId[16] = {
-        0xFA, 0x1A, 0x10, 0x50, 0xAA, 0x77, 0x08, 0xE0,
-        0xFA, 0x4E, 0xD3, 0xD1, 0xC3, 0x00, 0x00, 0x01
-    };
-    if (uniqueIdSpan.size() < sizeof(kUniqueId)) {
+    if (uniqueIdSpan.size() < sDeviceData.rotatingIdUniqueIdLen) {
         return CHIP_ERROR_BUFFER_TOO_SMALL;
     }
-    memcpy(uniqueIdSpan.data(), kUniqueId, sizeof(kUniqueId));
-    uniqueIdSpan.reduce_size(sizeof(kUniqueId));
+    memcpy(uniqueIdSpan.data(), sDeviceData.rotatingIdUniqueId, sDeviceData.rotatingIdUniqueIdLen);
+    uniqueIdSpan.reduce_size(sDeviceData.rotatingIdUniqueIdLen);
     return CHIP_NO_ERROR;
 }
 
@@ -126,20 +142,31 @@ CHIP_ERROR MatterDeviceInstanceInfoProvider::GetRotatingDeviceIdUniqueId(chip::M
 
 CHIP_ERROR MatterCommissionableDataProvider::Init()
 {
+    // Provisioned units carry their own salt and verifier; nothing to compute
+    if (sDeviceData.fromFactoryPartition) {
+        memcpy(mSalt, sDeviceData.salt, sDeviceData.saltLen);
+        mSaltLen = sDeviceData.saltLen;
+        memcpy(mSerializedVerifier, sDeviceData.verifier, sDeviceData.verifierLen);
+        mVerifierLen = sDeviceData.verifierLen;
+        mInitialized = true;
+        return CHIP_NO_ERROR;
+    }
+
     // Generate a deterministic salt from the serial number
     memset(mSalt, 0, sizeof(mSalt));
-    const char * serial = MATTER_DEVICE_SERIAL_NUMBER;
+    mSaltLen = chip::Crypto::kSpake2p_Min_PBKDF_Salt_Length;
+    const char * serial = sDeviceData.serialNumber;
     size_t serialLen = strlen(serial);
-    for (size_t i = 0; i < sizeof(mSalt); i++) {
+    for (size_t i = 0; i < mSaltLen; i++) {
         mSalt[i] = (i < serialLen) ? serial[i] : (uint8_t)(i + 0x53);
     }
 
     // Compute SPAKE2+ verifier at runtime from passcode
     chip::Crypto::Spake2pVerifier verifier;
     CHIP_ERROR err = verifier.Generate(
-        MATTER_DEVICE_SPAKE2P_ITERATION_COUNT,
-        chip::ByteSpan(mSalt, sizeof(mSalt)),
-        MATTER_DEVICE_SETUP_PASSCODE
+        sDeviceData.iterationCount,
+        chip::ByteSpan(mSalt, mSaltLen),
+        sDeviceData.passcode
     );
     if (err != CHIP_NO_ERROR) {
         Serial.printf("ERROR: Failed to generate SPAKE2+ verifier: %" PRIu32 "\n", err.AsInteger());
@@ -160,7 +187,7 @@ CHIP_ERROR MatterCommissionableDataProvider::Init()
 
 CHIP_ERROR MatterCommissionableDataProvider::GetSetupDiscriminator(uint16_t & setupDiscriminator)
 {
-    setupDiscriminator = MATTER_DEVICE_SETUP_DISCRIMINATOR;
+    setupDiscriminator = sDeviceData.discriminator;
     return CHIP_NO_ERROR;
 }
 
@@ -171,17 +198,17 @@ CHIP_ERROR MatterCommissionableDataProvider::SetSetupDiscriminator(uint16_t setu
 
 CHIP_ERROR MatterCommissionableDataProvider::GetSpake2pIterationCount(uint32_t & iterationCount)
 {
-    iterationCount = MATTER_DEVICE_SPAKE2P_ITERATION_COUNT;
+    iterationCount = sDeviceData.iterationCount;
     return CHIP_NO_ERROR;
 }
 
 CHIP_ERROR MatterCommissionableDataProvider::GetSpake2pSalt(chip::MutableByteSpan & saltBuf)
 {
-    if (saltBuf.size() < sizeof(mSalt)) {
+    if (saltBuf.size() < mSaltLen) {
         return CHIP_ERROR_BUFFER_TOO_SMALL;
     }
-    memcpy(saltBuf.data(), mSalt, sizeof(mSalt));
-    saltBuf.reduce_size(sizeof(mSalt));
+    memcpy(saltBuf.data(), mSalt, mSaltLen);
+    saltBuf.reduce_size(mSaltLen);
     return CHIP_NO_ERROR;
 }
 
@@ -201,7 +228,7 @@ CHIP_ERROR MatterCommissionableDataProvider::GetSpake2pVerifier(chip::MutableByt
 
 CHIP_ERROR MatterCommissionableDataProvider::GetSetupPasscode(uint32_t & setupPasscode)
 {
-    setupPasscode = MATTER_DEVICE_SETUP_PASSCODE;
+    setupPasscode = sDeviceData.passcode;
     return CHIP_NO_ERROR;
 }
 
@@ -224,8 +251,8 @@ static void generatePairingCodes()
     payload.rendezvousInformation.SetValue(
         chip::RendezvousInformationFlags(chip::RendezvousInformationFlag::kBLE,
                                          chip::RendezvousInformationFlag::kOnNetwork));
-    payload.discriminator.SetLongValue(MATTER_DEVICE_SETUP_DISCRIMINATOR);
-    payload.setUpPINCode = MATTER_DEVICE_SETUP_PASSCODE;
+    payload.discriminator.SetLongValue(sDeviceData.discriminator);
+    payload.setUpPINCode = sDeviceData.passcode;
 
     // Generate manual pairing code
     chip::ManualSetupPayloadGenerator manualGen(payload);
@@ -259,12 +286,109 @@ const char * getMatterQRCodeUrl()
     return sQRCodeUrl;
 }
 
+bool isMatterFactoryDataLoaded()
+{
+    return sDeviceData.fromFactoryPartition;
+}
+
+// ============================================================================
+// Device Data
+// ============================================================================
+
+static void loadBuildFlagDeviceData()
+{
+    // 16-byte unique ID - provisioned units get a truly unique one from the factory partition
+    static const uint8_t kUniqueId[16] = {
+        0xFA, 0x1A, 0x10, 0x50, 0xAA, 0x77, 0x08, 0xE0,
+        0xFA, 0x4E, 0xD3, 0xD1, 0xC3, 0x00, 0x00, 0x01
+    };
+    memset(&sDeviceData, 0, sizeof(sDeviceData));
+    CopyString(MATTER_DEVICE_SERIAL_NUMBER, sDeviceData.serialNumber, sizeof(sDeviceData.serialNumber));
+    sDeviceData.passcode = MATTER_DEVICE_SETUP_PASSCODE;
+    sDeviceData.discriminator = MATTER_DEVICE_SETUP_DISCRIMINATOR;
+    sDeviceData.iterationCount = MATTER_DEVICE_SPAKE2P_ITERATION_COUNT;
+    memcpy(sDeviceData.rotatingIdUniqueId, kUniqueId, sizeof(kUniqueId));
+    sDeviceData.rotatingIdUniqueIdLen = sizeof(kUniqueId);
+}
+
+#if MATTER_DEVICE_FACTORY_PARTITION
+// Salt and verifier are stored base64 encoded, like the CHIP factory data tools do
+static bool readBase64(nvs_handle_t handle, const char * key, uint8_t * out, size_t outSize, size_t & outLen)
+{
+    char encoded[BASE64_ENCODED_LEN(sizeof(chip::Crypto::Spake2pVerifierSerialized)) + 1];
+    size_t encodedLen = sizeof(encoded);
+    if (nvs_get_str(handle, key, encoded, &encodedLen) != ESP_OK || encodedLen < 2) {
+        return false;
+    }
+    encodedLen--;  // nvs_get_str counts the terminator
+    uint8_t decoded[BASE64_MAX_DECODED_LEN(sizeof(encoded))];
+    uint16_t decodedLen = chip::Base64Decode(encoded, (uint16_t)encodedLen, decoded);
+    if (decodedLen == UINT16_MAX || decodedLen > outSize) {
+        return false;
+    }
+    memcpy(out, decoded, decodedLen);
+    outLen = decodedLen;
+    return true;
+}
+
+static bool loadFactoryPartitionDeviceData()
+{
+    esp_err_t err = nvs_flash_init_partition(MATTER_DEVICE_FACTORY_PARTITION_NAME);
+    if (err != ESP_OK) {
+        Serial.printf("WARNING: Factory partition '%s' not available (0x%x)\n", MATTER_DEVICE_FACTORY_PARTITION_NAME, err);
+        return false;
+    }
+    nvs_handle_t handle;
+    err = nvs_open_from_partition(MATTER_DEVICE_FACTORY_PARTITION_NAME, MATTER_DEVICE_FACTORY_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        Serial.printf("WARNING: Factory partition is not provisioned (0x%x)\n", err);
+        return false;
+    }
+
+    MatterDeviceData data;
+    memset(&data, 0, sizeof(data));
+    size_t serialLen = sizeof(data.serialNumber);
+    uint32_t discriminator = 0;
+    size_t uniqueIdLen = sizeof(data.rotatingIdUniqueId);
+    bool ok = nvs_get_str(handle, "serial-num", data.serialNumber, &serialLen) == ESP_OK &&
+              nvs_get_u32(handle, "pin-code", &data.passcode) == ESP_OK &&
+              nvs_get_u32(handle, "discriminator", &discriminator) == ESP_OK &&
+              nvs_get_u32(handle, "iteration-count", &data.iterationCount) == ESP_OK &&
+              readBase64(handle, "salt", data.salt, sizeof(data.salt), data.saltLen) &&
+              readBase64(handle, "verifier", data.verifier, sizeof(data.verifier), data.verifierLen) &&
+              nvs_get_blob(handle, "rd-id-uid", data.rotatingIdUniqueId, &uniqueIdLen) == ESP_OK;
+    nvs_close(handle);
+
+    if (!ok || discriminator > 0xFFF ||
+        data.saltLen < chip::Crypto::kSpake2p_Min_PBKDF_Salt_Length ||
+        data.verifierLen != sizeof(chip::Crypto::Spake2pVerifierSerialized) ||
+        data.iterationCount < chip::Crypto::kSpake2p_Min_PBKDF_Iterations ||
+        data.iterationCount > chip::Crypto::kSpake2p_Max_PBKDF_Iterations ||
+        uniqueIdLen < 16) {
+        Serial.println("WARNING: Factory partition data is incomplete or invalid.");
+        return false;
+    }
+    data.discriminator = (uint16_t)discriminator;
+    data.rotatingIdUniqueIdLen = uniqueIdLen;
+    data.fromFactoryPartition = true;
+    sDeviceData = data;
+    return true;
+}
+#endif
+
 // ============================================================================
 // Initialization
 // ============================================================================
 
 void initMatterDeviceProviders()
 {
+    loadBuildFlagDeviceData();
+#if MATTER_DEVICE_FACTORY_PARTITION
+    if (!loadFactoryPartitionDeviceData()) {
+        Serial.println("WARNING: Using build flag commissioning data.");
+    }
+#endif
+
     // Override the DeviceInstanceInfoProvider (vendor name, product name, serial, etc.)
     chip::DeviceLayer::SetDeviceInstanceInfoProvider(&sDeviceInstanceInfoProvider);
 
@@ -284,7 +408,8 @@ void initMatterDeviceProviders()
     Serial.println("Custom providers installed.");
     Serial.printf("  Vendor:  %s (0x%04X)\n", MATTER_DEVICE_VENDOR_NAME, MATTER_DEVICE_VENDOR_ID);
     Serial.printf("  Product: %s (0x%04X)\n", MATTER_DEVICE_PRODUCT_NAME, MATTER_DEVICE_PRODUCT_ID);
-    Serial.printf("  Serial:  %s\n", MATTER_DEVICE_SERIAL_NUMBER);
-    Serial.printf("  Passcode:      %lu\n", (unsigned long)MATTER_DEVICE_SETUP_PASSCODE);
-    Serial.printf("  Discriminator: %u\n", MATTER_DEVICE_SETUP_DISCRIMINATOR);
+    Serial.printf("  Serial:  %s\n", sDeviceData.serialNumber);
+    Serial.printf("  Passcode:      %lu\n", (unsigned long)sDeviceData.passcode);
+    Serial.printf("  Discriminator: %u\n", sDeviceData.discriminator);
+    Serial.printf("  Source:        %s\n", sDeviceData.fromFactoryPartition ? "factory partition" : "build flags");
 }
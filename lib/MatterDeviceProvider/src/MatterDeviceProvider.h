@@ -61,6 +61,24 @@
 #define MATTER_DEVICE_SPAKE2P_ITERATION_COUNT 1000
 #endif
 
+// ============================================================================
+// Factory Partition Mode
+// With -D MATTER_DEVICE_FACTORY_PARTITION=1 the serial number, passcode,
+// discriminator, SPAKE2+ salt/verifier and rotating ID unique ID are read from
+// the factory NVS partition written by host/provision/fan_provision.py, so one
+// firmware image serves every unit. The build flag values above are only used
+// if the partition is missing or incomplete.
+// ============================================================================
+#ifndef MATTER_DEVICE_FACTORY_PARTITION
+#define MATTER_DEVICE_FACTORY_PARTITION   0
+#endif
+#ifndef MATTER_DEVICE_FACTORY_PARTITION_NAME
+#define MATTER_DEVICE_FACTORY_PARTITION_NAME "nvs_factory"
+#endif
+#ifndef MATTER_DEVICE_FACTORY_NAMESPACE
+#define MATTER_DEVICE_FACTORY_NAMESPACE   "chip-factory"
+#endif
+
 // ============================================================================
 // Custom Device Instance Info Provider
 // ============================================================================
@@ -87,7 +105,8 @@ public:
 class MatterCommissionableDataProvider : public chip::DeviceLayer::CommissionableDataProvider
 {
 public:
-    // Call once at startup to compute SPAKE2+ verifier from passcode
+    // Call once at startup: takes the salt/verifier from the factory partition,
+    // or computes the SPAKE2+ verifier from the build flag passcode
     CHIP_ERROR Init();
 
     CHIP_ERROR GetSetupDiscriminator(uint16_t & setupDiscriminator) override;
@@ -99,7 +118,8 @@ public:
     CHIP_ERROR SetSetupPasscode(uint32_t setupPasscode) override;
 
 private:
-    uint8_t mSalt[chip::Crypto::kSpake2p_Min_PBKDF_Salt_Length];
+    uint8_t mSalt[chip::Crypto::kSpake2p_Max_PBKDF_Salt_Length];
+    size_t mSaltLen = 0;
     chip::Crypto::Spake2pVerifierSerialized mSerializedVerifier;
     size_t mVerifierLen = 0;
     bool mInitialized = false;
@@ -111,6 +131,9 @@ private:
 const char * getMatterManualPairingCode();
 const char * getMatterQRCodeUrl();
 
+// True when the commissioning data came from the factory partition
+bool isMatterFactoryDataLoaded();
+
 // ============================================================================
 // Initialization - call AFTER Matter.begin()
 // ============================================================================
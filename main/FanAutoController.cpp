@@ -0,0 +1,167 @@
+#include "FanAutoController.h"
+
+static int16_t clampTemperature(int32_t temperature) {
+  if (temperature < FAN_TEMPERATURE_MIN) {
+    return FAN_TEMPERATURE_MIN;
+  }
+  if (temperature > FAN_TEMPERATURE_MAX) {
+    return FAN_TEMPERATURE_MAX;
+  }
+  return (int16_t)temperature;
+}
+
+FanAutoController::FanAutoController() {}
+
+bool FanAutoController::begin(MatterMultiSpeedFan &fan, FanSensorSource &sensor, const FanAutoConfig &config) {
+  if (config.stepTemperature <= 0 || config.hysteresis < 0 || config.hysteresis >= config.stepTemperature) {
+    log_e("Auto mode: hysteresis must be below the step between levels");
+    return false;
+  }
+  this->fan = &fan;
+  this->sensor = &sensor;
+  this->config = config;
+
+  // Nothing to watch until Auto is selected
+  sensor.setBand(FAN_TEMPERATURE_MIN, FAN_TEMPERATURE_MAX);
+  log_i("Auto mode: speed 1 at %d, +%d per level, hysteresis %d (0.01 C), dwell %lu s", config.startTemperature,
+        config.stepTemperature, config.hysteresis, (unsigned long)(config.minDwellMs / 1000));
+  return true;
+}
+
+// ============================================================================
+// Planner
+// ============================================================================
+
+int16_t FanAutoController::onTemperature(uint8_t speed) {
+  if (speed == 0) {
+    return FAN_TEMPERATURE_MIN;
+  }
+  return clampTemperature((int32_t)config.startTemperature + (int32_t)(speed - 1) * config.stepTemperature);
+}
+
+uint8_t FanAutoController::planSpeed(int16_t temperature, uint8_t currentSpeed) {
+  uint8_t speedMax = fan->getSpeedMax();
+  uint8_t speed = currentSpeed > speedMax ? speedMax : currentSpeed;
+
+  // Up as soon as the next level's threshold is reached, down only below the hysteresis
+  while (speed < speedMax && temperature >= onTemperature(speed + 1)) {
+    speed++;
+  }
+  while (speed > 0 && (int32_t)temperature < (int32_t)onTemperature(speed) - config.hysteresis) {
+    speed--;
+  }
+  return speed;
+}
+
+void FanAutoController::bandForSpeed(uint8_t speed, int16_t &low, int16_t &high) {
+  low = speed == 0 ? FAN_TEMPERATURE_MIN : clampTemperature((int32_t)onTemperature(speed) - config.hysteresis);
+  high = speed >= fan->getSpeedMax() ? FAN_TEMPERATURE_MAX : onTemperature(speed + 1);
+}
+
+// ============================================================================
+// Control loop
+// ============================================================================
+
+void FanAutoController::loop() {
+  if (fan == nullptr) {
+    return;
+  }
+  unsigned long now = millis();
+  sensor->loop(now);
+
+  if (!fan->isAutoMode()) {
+    if (active) {
+      active = false;
+      recheckPending = false;
+      sensor->setBand(FAN_TEMPERATURE_MIN, FAN_TEMPERATURE_MAX);
+      log_i("Auto mode: left");
+    }
+    return;
+  }
+
+  if (!active) {
+    active = true;
+    log_i("Auto mode: entered");
+    evaluate(now, true);
+    return;
+  }
+
+  bool crossed = sensor->takeCrossing();
+  bool recheckDue = recheckPending && (long)(now - recheckTime) >= 0;
+  if (crossed || recheckDue) {
+    evaluate(now, false);
+  }
+}
+
+uint32_t FanAutoController::getNextWakeTime() {
+  uint32_t timeMs = sensor->getNextSampleTime();
+  if (recheckPending && (int32_t)((uint32_t)recheckTime - timeMs) < 0) {
+    timeMs = recheckTime;
+  }
+  return timeMs;
+}
+
+void FanAutoController::evaluate(unsigned long now, bool entering) {
+  if (!sensor->hasReading()) {
+    // Keep the current speed; the first reading will be outside the empty band
+    log_w("Auto mode: no temperature reading yet");
+    sensor->setBand(FAN_TEMPERATURE_MAX, FAN_TEMPERATURE_MAX);
+    return;
+  }
+
+  evaluationCount++;
+  int16_t temperature = sensor->getTemperature();
+  uint8_t speed = fan->getSpeed();
+  uint8_t target = planSpeed(temperature, speed);
+  if (target == speed) {
+    recheckPending = false;
+    followBand(speed);
+    return;
+  }
+
+  // Entering Auto acts at once; afterwards every change waits for the dwell time
+  if (!entering && changedOnce && now - lastChangeTime < config.minDwellMs) {
+    if (!recheckPending) {
+      deferredCount++;
+      log_d("Auto mode: speed %d deferred for %lu ms", target, (unsigned long)(config.minDwellMs - (now - lastChangeTime)));
+    }
+    recheckPending = true;
+    recheckTime = lastChangeTime + config.minDwellMs;
+    return;
+  }
+
+  log_i("Auto mode: temperature %d (0.01 C) -> speed %d (was %d)", temperature, target, speed);
+  recheckPending = false;
+  if (!fan->applyAutoSpeed(target)) {
+    log_w("Auto mode: speed change rejected");
+    followBand(speed);
+    return;
+  }
+  changedOnce = true;
+  lastChangeTime = now;
+  speedChangeCount++;
+  followBand(target);
+}
+
+void FanAutoController::followBand(uint8_t speed) {
+  int16_t low;
+  int16_t high;
+  bandForSpeed(speed, low, high);
+  sensor->setBand(low, high);
+}
+
+bool FanAutoController::isActive() {
+  return active;
+}
+
+uint32_t FanAutoController::getEvaluationCount() {
+  return evaluationCount;
+}
+
+uint32_t FanAutoController::getSpeedChangeCount() {
+  return speedChangeCount;
+}
+
+uint32_t FanAutoController::getDeferredCount() {
+  return deferredCount;
+}
@@ -0,0 +1,70 @@
+#ifndef FAN_AUTO_CONTROLLER_H
+#define FAN_AUTO_CONTROLLER_H
+
+#include <Arduino.h>
+#include "FanSensorSource.h"
+#include "MatterMultiSpeedFan.h"
+
+// Auto mode thresholds, in hundredths of a degree Celsius
+struct FanAutoConfig {
+  int16_t startTemperature = 2600;  // Speed 1 turns on at this temperature
+  int16_t stepTemperature = 200;    // Every further speed level turns on this much warmer
+  int16_t hysteresis = 50;          // A level turns off this much below where it turned on
+  uint32_t minDwellMs = 300000;     // Shortest time between two automatic speed changes
+};
+
+// Auto mode controller: follows the room temperature while FanMode is Auto
+//
+// Speed level n turns on at startTemperature + (n - 1) * stepTemperature and off
+// again hysteresis below that. The current level therefore has a band of
+// temperatures it is happy with; the band is handed to the sensor source, which
+// only raises a crossing when a reading leaves it. Between crossings loop() does
+// nothing but let the source sample at its own low rate.
+//
+// A crossing within minDwellMs of the last automatic change is held back and
+// re-evaluated when the dwell time is over, with the temperature of that moment:
+// a short warm spell then costs no pulses at all. Jumps over several levels are
+// one actuation, never a walk through the levels in between.
+class FanAutoController {
+public:
+  FanAutoController();
+
+  bool begin(MatterMultiSpeedFan &fan, FanSensorSource &sensor, const FanAutoConfig &config = FanAutoConfig());
+
+  // Call from loop()
+  void loop();
+  // When loop() has to run next: the next sensor sample or a deferred re-evaluation
+  uint32_t getNextWakeTime();
+
+  // Planner: the level for a temperature, starting from the current one
+  uint8_t planSpeed(int16_t temperature, uint8_t currentSpeed);
+  // Temperatures [low, high) that keep the fan at speed
+  void bandForSpeed(uint8_t speed, int16_t &low, int16_t &high);
+  // Temperature at which speed level turns on
+  int16_t onTemperature(uint8_t speed);
+
+  bool isActive();
+  uint32_t getEvaluationCount();
+  uint32_t getSpeedChangeCount();
+  uint32_t getDeferredCount();
+
+protected:
+  MatterMultiSpeedFan *fan = nullptr;
+  FanSensorSource *sensor = nullptr;
+  FanAutoConfig config;
+
+  bool active = false;               // FanMode is Auto and the controller owns the speed
+  bool changedOnce = false;
+  unsigned long lastChangeTime = 0;
+  bool recheckPending = false;       // A crossing waits for the dwell time to end
+  unsigned long recheckTime = 0;
+
+  uint32_t evaluationCount = 0;
+  uint32_t speedChangeCount = 0;
+  uint32_t deferredCount = 0;
+
+  void evaluate(unsigned long now, bool entering);
+  void followBand(uint8_t speed);
+};
+
+#endif // FAN_AUTO_CONTROLLER_H
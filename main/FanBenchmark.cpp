@@ -0,0 +1,267 @@
+#include "FanBenchmark.h"
+
+#include <esp_app_desc.h>
+#include <platform/CHIPDeviceLayer.h>
+
+using namespace esp_matter;
+using namespace chip::app::Clusters;
+
+FanBenchmark::FanBenchmark() {}
+
+bool FanBenchmark::begin(MatterMultiSpeedFan &fan, FanPulseCapture *capture, uint8_t speedChannel, uint8_t oscillationChannel) {
+  this->fan = &fan;
+  this->capture = (capture != nullptr && capture->isStarted()) ? capture : nullptr;
+  this->speedChannel = speedChannel;
+  this->oscillationChannel = oscillationChannel;
+  started = true;
+  return true;
+}
+
+void FanBenchmark::onSpeedChange(SpeedCallback cb) {
+  _onSpeedChangeCB = cb;
+}
+
+void FanBenchmark::onOscillationChange(OscillationCallback cb) {
+  _onOscillationChangeCB = cb;
+}
+
+void FanBenchmark::setNominalWidths(uint32_t speedHighMs, uint32_t speedLowMs, uint32_t oscillationHighMs) {
+  nominalSpeedHighMs = speedHighMs;
+  nominalSpeedLowMs = speedLowMs;
+  nominalOscillationHighMs = oscillationHighMs;
+}
+
+bool FanBenchmark::start(uint32_t nowMs, uint8_t speed, bool oscillation) {
+  if (!started || fan->getEndPointId() == 0) {
+    log_e("Benchmark: fan endpoint not initialized");
+    return false;
+  }
+  if (isRunning()) {
+    log_w("Benchmark already running");
+    return false;
+  }
+
+  originalSpeed = speed;
+  originalOscillation = oscillation;
+  updateTiming.reset();
+  setTiming.reset();
+  reportTiming.reset();
+  callbackPathTiming.reset();
+  callbackAppTiming.reset();
+  speedHigh.reset();
+  speedLow.reset();
+  oscillationHigh.reset();
+  finished = false;
+
+  enterPhase(PHASE_ATTRIBUTES, nowMs);
+  return true;
+}
+
+bool FanBenchmark::isRunning() {
+  return phase != PHASE_IDLE && phase != PHASE_DONE;
+}
+
+bool FanBenchmark::takeFinished() {
+  bool ret = finished;
+  finished = false;
+  return ret;
+}
+
+bool FanBenchmark::onButtonPress(uint32_t nowMs) {
+  if (gesturePresses == 0 || nowMs - gestureStartMs > FAN_BENCH_GESTURE_WINDOW_MS) {
+    gesturePresses = 0;
+    gestureStartMs = nowMs;
+  }
+  gesturePresses++;
+  if (gesturePresses < FAN_BENCH_GESTURE_PRESSES) {
+    return false;
+  }
+  gesturePresses = 0;
+  return true;
+}
+
+// ============================================================================
+// Phases
+// ============================================================================
+
+void FanBenchmark::loop(uint32_t nowMs, bool settled) {
+  switch (phase) {
+    case PHASE_ATTRIBUTES:
+      measureAttributes();
+      enterPhase(PHASE_CALLBACKS, nowMs);
+      break;
+
+    case PHASE_CALLBACKS:
+      if (callbackPending) {
+        if (nowMs - phaseStartMs >= FAN_BENCH_CALLBACK_TIMEOUT_MS) {
+          log_w("Benchmark: CHIP task round trip timed out after %lu of %d", callbacksRun, FAN_BENCH_ITERATIONS);
+          callbackAppTiming = fan->getCallbackTiming();
+          enterPhase(capture != nullptr ? PHASE_SPEED_OUT : PHASE_DONE, nowMs);
+        }
+        break;
+      }
+      if (callbacksRun >= FAN_BENCH_ITERATIONS) {
+        callbackAppTiming = fan->getCallbackTiming();
+        enterPhase(capture != nullptr ? PHASE_SPEED_OUT : PHASE_DONE, nowMs);
+        break;
+      }
+      scheduleCallback();
+      phaseStartMs = nowMs;
+      break;
+
+    case PHASE_SPEED_OUT:
+    case PHASE_SPEED_BACK:
+      if (settled) {
+        capture->measure(speedChannel, speedHigh, speedLow);
+        enterPhase(phase == PHASE_SPEED_OUT ? PHASE_SPEED_BACK : PHASE_OSCILLATION_OUT, nowMs);
+      }
+      break;
+
+    case PHASE_OSCILLATION_OUT:
+    case PHASE_OSCILLATION_BACK:
+      if (settled) {
+        FanTimingStats oscillationLow;  // One pulse per toggle: no LOW width
+        capture->measure(oscillationChannel, oscillationHigh, oscillationLow);
+        enterPhase(phase == PHASE_OSCILLATION_OUT ? PHASE_OSCILLATION_BACK : PHASE_DONE, nowMs);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void FanBenchmark::enterPhase(Phase next, uint32_t nowMs) {
+  phase = next;
+  phaseStartMs = nowMs;
+
+  switch (phase) {
+    case PHASE_CALLBACKS:
+      callbacksRun = 0;
+      callbackPending = false;  // A round trip left over from a timed out run is not waited for
+      callbackRockSetting = fan->getRockSetting();
+      fan->resetCallbackTiming();
+      break;
+
+    case PHASE_SPEED_OUT:
+      // One step below the current speed: speedMax pulses out, one back
+      capture->clear(speedChannel);
+      if (_onSpeedChangeCB != nullptr) {
+        _onSpeedChangeCB((originalSpeed + fan->getSpeedMax()) % (fan->getSpeedMax() + 1));
+      }
+      break;
+
+    case PHASE_SPEED_BACK:
+      capture->clear(speedChannel);
+      if (_onSpeedChangeCB != nullptr) {
+        _onSpeedChangeCB(originalSpeed);
+      }
+      break;
+
+    case PHASE_OSCILLATION_OUT:
+    case PHASE_OSCILLATION_BACK:
+      capture->clear(oscillationChannel);
+      if (_onOscillationChangeCB != nullptr) {
+        _onOscillationChangeCB(phase == PHASE_OSCILLATION_OUT ? !originalOscillation : originalOscillation);
+      }
+      break;
+
+    case PHASE_DONE:
+      finished = true;
+      log_i("Benchmark finished");
+      break;
+
+    default:
+      break;
+  }
+}
+
+// ============================================================================
+// Measurements
+// ============================================================================
+
+void FanBenchmark::measureAttributes() {
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  if (!fan->getAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &val)) {
+    log_w("Benchmark: SpeedCurrent not readable");
+    return;
+  }
+  uint16_t endpointId = fan->getEndPointId();
+
+  // attribute::update() takes the stack lock itself: timed as loop() pays for it
+  for (uint32_t i = 0; i < FAN_BENCH_ITERATIONS; i++) {
+    unsigned long startUs = micros();
+    fan->updateAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &val);
+    updateTiming.add(micros() - startUs);
+  }
+
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  for (uint32_t i = 0; i < FAN_BENCH_ITERATIONS; i++) {
+    unsigned long startUs = micros();
+    fan->setAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &val);
+    setTiming.add(micros() - startUs);
+
+    startUs = micros();
+    attribute::report(endpointId, FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &val);
+    reportTiming.add(micros() - startUs);
+  }
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+}
+
+void FanBenchmark::scheduleCallback() {
+  callbackPending = true;
+  callbackScheduledUs = micros();
+  if (chip::DeviceLayer::PlatformMgr().ScheduleWork(runCallback, (intptr_t)this) != CHIP_NO_ERROR) {
+    log_w("Benchmark: could not schedule work on the CHIP task");
+    callbackPending = false;
+    callbacksRun = FAN_BENCH_ITERATIONS;
+  }
+}
+
+// Runs on the CHIP task, which holds the stack lock
+void FanBenchmark::runCallback(intptr_t arg) {
+  FanBenchmark *bench = (FanBenchmark *)arg;
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_UINT8;
+  val.val.u8 = bench->callbackRockSetting;
+  attribute::update(bench->fan->getEndPointId(), FanControl::Id, FanControl::Attributes::RockSetting::Id, &val);
+  bench->callbackPathTiming.add(micros() - bench->callbackScheduledUs);
+  bench->callbacksRun++;
+  bench->callbackPending = false;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+void FanBenchmark::printStats(Print &out, const char *name, const FanTimingStats &stats) {
+  out.printf("FANBEN v1 %s min=%lu mean=%lu max=%lu n=%lu\r\n", name, stats.minUs, stats.meanUs(), stats.maxUs, stats.count);
+}
+
+void FanBenchmark::printReport(Print &out) {
+  const esp_app_desc_t *app = esp_app_get_description();
+  out.printf("FANBEN v1 meta fw=%s idf=%s chip=%s cpu_mhz=%lu iterations=%d\r\n", app->version, esp_get_idf_version(),
+             CONFIG_IDF_TARGET, (unsigned long)getCpuFrequencyMhz(), FAN_BENCH_ITERATIONS);
+  printStats(out, "update_us", updateTiming);
+  printStats(out, "set_us", setTiming);
+  printStats(out, "report_us", reportTiming);
+  // update_us includes taking the stack lock; set_us and report_us run with it held
+  out.printf("FANBEN v1 locking update_us=taken set_us=held report_us=held\r\n");
+  printStats(out, "cb_path_us", callbackPathTiming);
+  printStats(out, "cb_app_us", callbackAppTiming);
+
+  if (capture == nullptr) {
+    out.printf("FANBEN v1 loopback none\r\n");
+  } else {
+    out.printf("FANBEN v1 loopback resolution_hz=%lu\r\n", capture->getResolutionHz());
+    printStats(out, "speed_high_us", speedHigh);
+    out.printf("FANBEN v1 speed_high_us nominal=%lu\r\n", nominalSpeedHighMs * 1000);
+    printStats(out, "speed_low_us", speedLow);
+    out.printf("FANBEN v1 speed_low_us nominal=%lu\r\n", nominalSpeedLowMs * 1000);
+    printStats(out, "osc_high_us", oscillationHigh);
+    out.printf("FANBEN v1 osc_high_us nominal=%lu\r\n", nominalOscillationHighMs * 1000);
+  }
+  out.printf("FANBEN v1 end\r\n");
+}
@@ -0,0 +1,124 @@
+#ifndef FAN_BENCHMARK_H
+#define FAN_BENCHMARK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include "FanPulseCapture.h"
+#include "FanTimingStats.h"
+#include "MatterMultiSpeedFan.h"
+
+// Calls per attribute operation and CHIP task round trips per run
+#define FAN_BENCH_ITERATIONS 100
+// A CHIP task round trip that takes longer ends the callback phase
+#define FAN_BENCH_CALLBACK_TIMEOUT_MS 2000
+// BOOT button gesture: this many presses within the window start a run
+#define FAN_BENCH_GESTURE_PRESSES 3
+#define FAN_BENCH_GESTURE_WINDOW_MS 2000
+
+// On-device microbenchmark with a GPIO loopback self-test
+//
+// A run measures, in this order:
+//   - updateAttributeVal(), setAttributeVal() and attribute::report() on
+//     SpeedCurrent, writing the value it already has. Each update takes the CHIP
+//     stack lock itself, as from loop(); set and report run with it held
+//   - the CHIP task callback path: an attribute::update() of RockSetting with its
+//     current value, scheduled on the CHIP task, from scheduling until it returns
+//     (cb_path), and the time spent in attributeChangeCB() alone (cb_app)
+//   - the HIGH and LOW widths of the speed and oscillation control pins, captured
+//     in hardware on looped-back input pins (see FanPulseCapture). The speed is
+//     pulsed away and back to where it was, the oscillation toggled and restored,
+//     so the fan ends the run in the state it started in.
+//
+// Same-value updates and sets leave the attributes unchanged and report nothing,
+// but attribute::report() always marks SpeedCurrent for reporting: subscribers
+// receive its unchanged value (coalesced to their minimum interval). The report
+// is a block of "FANBEN v1 key=value" lines that host/bench/fanben_compare.py
+// compares between firmware versions.
+class FanBenchmark {
+public:
+  using SpeedCallback = std::function<void(uint8_t)>;
+  using OscillationCallback = std::function<void(bool)>;
+
+  FanBenchmark();
+
+  // capture: loopback capture, or nullptr to skip the pulse measurements
+  bool begin(MatterMultiSpeedFan &fan, FanPulseCapture *capture, uint8_t speedChannel, uint8_t oscillationChannel);
+
+  // Start the pulse trains, as a controller write would
+  void onSpeedChange(SpeedCallback cb);
+  void onOscillationChange(OscillationCallback cb);
+  // Widths the pulse state machines aim for, printed next to the measured ones
+  void setNominalWidths(uint32_t speedHighMs, uint32_t speedLowMs, uint32_t oscillationHighMs);
+
+  // Begin a run from the physical state the fan is in now
+  bool start(uint32_t nowMs, uint8_t speed, bool oscillation);
+  // settled: no pulse train running
+  void loop(uint32_t nowMs, bool settled);
+  bool isRunning();
+  // True once after a run has finished
+  bool takeFinished();
+
+  // A BOOT button press; true when it completes the start gesture
+  bool onButtonPress(uint32_t nowMs);
+
+  void printReport(Print &out);
+
+protected:
+  enum Phase {
+    PHASE_IDLE,
+    PHASE_ATTRIBUTES,
+    PHASE_CALLBACKS,
+    PHASE_SPEED_OUT,
+    PHASE_SPEED_BACK,
+    PHASE_OSCILLATION_OUT,
+    PHASE_OSCILLATION_BACK,
+    PHASE_DONE
+  };
+
+  bool started = false;
+  MatterMultiSpeedFan *fan = nullptr;
+  FanPulseCapture *capture = nullptr;
+  uint8_t speedChannel = 0;
+  uint8_t oscillationChannel = 0;
+  SpeedCallback _onSpeedChangeCB = nullptr;
+  OscillationCallback _onOscillationChangeCB = nullptr;
+
+  uint32_t nominalSpeedHighMs = 0;
+  uint32_t nominalSpeedLowMs = 0;
+  uint32_t nominalOscillationHighMs = 0;
+
+  Phase phase = PHASE_IDLE;
+  uint32_t phaseStartMs = 0;
+  bool finished = false;
+  uint8_t originalSpeed = 0;
+  bool originalOscillation = false;
+
+  // Callback phase, shared with the CHIP task: runCallback() fills callbackPathTiming and
+  // callbacksRun before it clears callbackPending, loop() only reads them once it sees it cleared
+  std::atomic<bool> callbackPending{false};
+  uint32_t callbackScheduledUs = 0;
+  uint32_t callbacksRun = 0;
+  uint8_t callbackRockSetting = 0;
+
+  uint8_t gesturePresses = 0;
+  uint32_t gestureStartMs = 0;
+
+  FanTimingStats updateTiming;
+  FanTimingStats setTiming;
+  FanTimingStats reportTiming;
+  FanTimingStats callbackPathTiming;
+  FanTimingStats callbackAppTiming;
+  FanTimingStats speedHigh;
+  FanTimingStats speedLow;
+  FanTimingStats oscillationHigh;
+
+  void enterPhase(Phase next, uint32_t nowMs);
+  void measureAttributes();
+  void scheduleCallback();
+  static void runCallback(intptr_t arg);
+
+  static void printStats(Print &out, const char *name, const FanTimingStats &stats);
+};
+
+#endif // FAN_BENCHMARK_H
@@ -0,0 +1,179 @@
+#include "FanBridge.h"
+
+using namespace esp_matter;
+using namespace esp_matter::endpoint;
+
+FanBridge::FanBridge() {}
+
+bool FanBridge::begin(FanBusTransport &transport) {
+  if (started) {
+    log_e("Fan Bridge already initialized");
+    return false;
+  }
+
+  ArduinoMatter::_init();
+  node_t *matter_node = node::get();
+  if (matter_node == nullptr) {
+    log_e("Failed to get Matter node");
+    return false;
+  }
+
+  aggregator::config_t aggregator_config;
+  endpoint_t *aggregator = aggregator::create(matter_node, &aggregator_config, ENDPOINT_FLAG_NONE, nullptr);
+  if (aggregator == nullptr) {
+    log_e("Failed to create Aggregator endpoint");
+    return false;
+  }
+  aggregatorEndpointId = endpoint::get_id(aggregator);
+
+  bus.onDeviceFound([this](uint8_t address, const FanBusInfo &info) {
+    addFan(address, info);
+  });
+  bus.onDeviceState([this](uint8_t address, const FanBusState &state) {
+    updateFan(address, state);
+  });
+  bus.onDeviceReachable([this](uint8_t address, bool reachable) {
+    setFanReachable(address, reachable);
+  });
+  bus.begin(transport);
+
+  log_i("Fan Bridge initialized: Aggregator on endpoint %d, up to %d fans", aggregatorEndpointId, FAN_BUS_MAX_DEVICES);
+
+  started = true;
+  return true;
+}
+
+void FanBridge::loop() {
+  if (!started) {
+    return;
+  }
+  bus.loop(millis());
+  // Bus fans report their final state, so every bridged fan is always settled
+  for (BridgedFan &bridgedFan : fans) {
+    if (bridgedFan.active) {
+      bridgedFan.fan.loop();
+    }
+  }
+}
+
+void FanBridge::onFanAdded(FanAddedCallback cb) {
+  _onFanAddedCB = cb;
+}
+
+void FanBridge::setReportWindow(uint32_t windowMs) {
+  reportWindowMs = windowMs;
+  for (BridgedFan &bridgedFan : fans) {
+    if (bridgedFan.active) {
+      bridgedFan.fan.setReportWindow(windowMs);
+    }
+  }
+}
+
+void FanBridge::setArena(FanEndpointArena *arena) {
+  this->arena = arena;
+}
+
+uint16_t FanBridge::getAggregatorEndpointId() {
+  return aggregatorEndpointId;
+}
+
+uint8_t FanBridge::getFanCount() {
+  uint8_t count = 0;
+  for (const BridgedFan &bridgedFan : fans) {
+    count += bridgedFan.active ? 1 : 0;
+  }
+  return count;
+}
+
+MatterMultiSpeedFan *FanBridge::getFan(uint8_t address) {
+  BridgedFan *bridgedFan = findFan(address);
+  return bridgedFan == nullptr ? nullptr : &bridgedFan->fan;
+}
+
+FanBusMaster &FanBridge::getBus() {
+  return bus;
+}
+
+FanBridge::BridgedFan *FanBridge::findFan(uint8_t address) {
+  for (BridgedFan &bridgedFan : fans) {
+    if (bridgedFan.active && bridgedFan.address == address) {
+      return &bridgedFan;
+    }
+  }
+  return nullptr;
+}
+
+// ============================================================================
+// Bus events
+// ============================================================================
+
+void FanBridge::addFan(uint8_t address, const FanBusInfo &info) {
+  if (findFan(address) != nullptr) {
+    return;
+  }
+  BridgedFan *bridgedFan = nullptr;
+  for (BridgedFan &slot : fans) {
+    if (!slot.active) {
+      bridgedFan = &slot;
+      break;
+    }
+  }
+  if (bridgedFan == nullptr) {
+    log_e("No room for bus fan %d", address);
+    return;
+  }
+
+  // Callbacks and the report window are in place before the endpoint is enabled:
+  // a controller write can reach it as soon as begin() has added it to the stack
+  bridgedFan->fan.setReportWindow(reportWindowMs);
+  bridgedFan->fan.onChangeSpeed([this, address](uint8_t speed) {
+    return bus.setSpeed(address, speed);
+  });
+  bridgedFan->fan.onChangeRock([this, address](uint8_t rockSetting) {
+    return bus.setRockSetting(address, rockSetting);
+  });
+
+  // The endpoint is created while the stack is running
+  bridgedFan->fan.useArena(arena);
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  bool created = bridgedFan->fan.begin(info.speedMax, info.rockSupport, aggregatorEndpointId);
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+  if (!created) {
+    log_e("Failed to create bridged fan for bus address %d", address);
+    return;
+  }
+
+  bridgedFan->active = true;
+  bridgedFan->address = address;
+
+  log_i("Bus fan %d bridged on endpoint %d (SpeedMax=%d, RockSupport=0x%02X)", address, bridgedFan->fan.getEndPointId(),
+        info.speedMax, info.rockSupport);
+
+  if (_onFanAddedCB != nullptr) {
+    _onFanAddedCB(bridgedFan->fan);
+  }
+  updateFan(address, info.state);
+}
+
+void FanBridge::updateFan(uint8_t address, const FanBusState &state) {
+  BridgedFan *bridgedFan = findFan(address);
+  if (bridgedFan == nullptr) {
+    return;
+  }
+  MatterMultiSpeedFan &fan = bridgedFan->fan;
+  if (fan.getSpeed() != state.speed) {
+    fan.setSpeed(state.speed, false);
+  }
+  if (fan.getRockSetting() != state.rockSetting) {
+    fan.setRockSetting(state.rockSetting, false);
+  }
+}
+
+void FanBridge::setFanReachable(uint8_t address, bool reachable) {
+  BridgedFan *bridgedFan = findFan(address);
+  if (bridgedFan != nullptr) {
+    bridgedFan->fan.setReachable(reachable);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef FAN_BRIDGE_H
+#define FAN_BRIDGE_H
+
+#include <Matter.h>
+#include <FanBusMaster.h>
+#include "MatterMultiSpeedFan.h"
+
+// Matter bridge for fans on a local serial bus
+//
+// One node exposes an Aggregator endpoint; every fan controller found on the bus
+// becomes a bridged MatterMultiSpeedFan endpoint under it. Controller writes are
+// queued as bus commands and state changes reported by the fans (including their
+// own buttons) are applied with setSpeed()/setRockSetting(false). A fan that stops
+// answering is kept, with Reachable = false, until it answers again.
+class FanBridge {
+public:
+  typedef std::function<void(MatterMultiSpeedFan &fan)> FanAddedCallback;
+
+  FanBridge();
+
+  // Create the Aggregator endpoint and start talking on the bus - call before Matter.begin()
+  bool begin(FanBusTransport &transport);
+
+  // Drive the bus; call from loop()
+  void loop();
+
+  // Called after a bridged fan endpoint was created (the host build publishes it here)
+  void onFanAdded(FanAddedCallback cb);
+
+  // Report window of every bridged fan (see MatterMultiSpeedFan::setReportWindow())
+  void setReportWindow(uint32_t windowMs);
+  // Bridged fan endpoints are built in this arena (see MatterMultiSpeedFan::useArena())
+  void setArena(FanEndpointArena *arena);
+
+  uint16_t getAggregatorEndpointId();
+  uint8_t getFanCount();
+  MatterMultiSpeedFan *getFan(uint8_t address);
+  FanBusMaster &getBus();
+
+protected:
+  struct BridgedFan {
+    bool active = false;
+    uint8_t address = 0;
+    MatterMultiSpeedFan fan;
+  };
+
+  bool started = false;
+  uint16_t aggregatorEndpointId = 0;
+  uint32_t reportWindowMs = 0;
+  FanEndpointArena *arena = nullptr;
+  FanBusMaster bus;
+  BridgedFan fans[FAN_BUS_MAX_DEVICES];
+
+  FanAddedCallback _onFanAddedCB = nullptr;
+
+  BridgedFan *findFan(uint8_t address);
+  void addFan(uint8_t address, const FanBusInfo &info);
+  void updateFan(uint8_t address, const FanBusState &state);
+  void setFanReachable(uint8_t address, bool reachable);
+};
+
+#endif // FAN_BRIDGE_H
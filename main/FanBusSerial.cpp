@@ -0,0 +1,24 @@
+#include "FanBusSerial.h"
+
+FanBusSerial::FanBusSerial(HardwareSerial &serial) : serial(serial) {}
+
+bool FanBusSerial::begin(uint32_t baud, int8_t rxPin, int8_t txPin, int8_t dePin) {
+  serial.begin(baud, SERIAL_8N1, rxPin, txPin);
+  if (dePin >= 0) {
+    // RTS doubles as the RS-485 driver enable in half-duplex mode
+    if (!serial.setPins(rxPin, txPin, -1, dePin) || !serial.setMode(UART_MODE_RS485_HALF_DUPLEX)) {
+      log_e("Failed to switch the fan bus UART to RS-485 half duplex");
+      return false;
+    }
+  }
+  log_i("Fan bus on RX=%d TX=%d DE=%d at %lu baud", rxPin, txPin, dePin, (unsigned long)baud);
+  return true;
+}
+
+size_t FanBusSerial::write(const uint8_t *data, size_t length) {
+  return serial.write(data, length);
+}
+
+int FanBusSerial::read() {
+  return serial.available() > 0 ? serial.read() : -1;
+}
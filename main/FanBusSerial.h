@@ -0,0 +1,25 @@
+#ifndef FAN_BUS_SERIAL_H
+#define FAN_BUS_SERIAL_H
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include <FanBusMaster.h>
+
+// Fan bus over a hardware UART
+// With an RS-485 transceiver, its DE/RE pin is driven by the UART itself
+// (UART_MODE_RS485_HALF_DUPLEX), so the driver switch-over needs no CPU timing.
+class FanBusSerial : public FanBusTransport {
+public:
+  explicit FanBusSerial(HardwareSerial &serial);
+
+  // dePin: transceiver driver enable, or -1 for a plain UART link
+  bool begin(uint32_t baud, int8_t rxPin, int8_t txPin, int8_t dePin = -1);
+
+  size_t write(const uint8_t *data, size_t length) override;
+  int read() override;
+
+protected:
+  HardwareSerial &serial;
+};
+
+#endif // FAN_BUS_SERIAL_H
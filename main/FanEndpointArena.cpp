@@ -0,0 +1,162 @@
+#include "FanEndpointArena.h"
+
+#include <esp_heap_caps.h>
+
+using namespace esp_matter;
+
+FanEndpointArena::FanEndpointArena() {}
+
+FanEndpointArena::~FanEndpointArena() {
+  end();
+}
+
+bool FanEndpointArena::begin(uint8_t endpointCount, size_t bytesPerEndpoint) {
+  if (started) {
+    return true;
+  }
+  capacity = endpointCount;
+  this->endpointCount = 0;
+  this->bytesPerEndpoint = bytesPerEndpoint;
+  estimatedBytes = bytesPerEndpoint;
+  usedBytes = 0;
+  started = true;
+
+  reclaim();
+  if (reserve == nullptr) {
+    log_w("Endpoint arena: %u bytes for %d endpoints not available, endpoints use the heap as it comes",
+          (unsigned)(capacity * bytesPerEndpoint), capacity);
+    return false;
+  }
+  log_i("Endpoint arena: %u bytes for %d endpoints", (unsigned)reservedBytes, capacity);
+  return true;
+}
+
+void FanEndpointArena::end() {
+  release();
+  started = false;
+}
+
+// ============================================================================
+// Construction and teardown
+// ============================================================================
+
+void FanEndpointArena::beginConstruction() {
+  release();
+  freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+int32_t FanEndpointArena::endConstruction(bool built) {
+  int32_t heapBytes = (int32_t)(freeBefore - heap_caps_get_free_size(MALLOC_CAP_8BIT));
+  if (built) {
+    endpointCount++;
+    if (heapBytes > 0) {
+      usedBytes += heapBytes;
+      // Later endpoints get what the largest one really took, within bounds of the estimate
+      size_t limit = estimatedBytes * FAN_ARENA_MAX_GROWTH;
+      if ((size_t)heapBytes > limit) {
+        log_w("Endpoint arena: construction took %ld bytes, reserving at most %u per endpoint", (long)heapBytes,
+              (unsigned)limit);
+      }
+      size_t grown = (size_t)heapBytes < limit ? (size_t)heapBytes : limit;
+      if (grown > bytesPerEndpoint) {
+        bytesPerEndpoint = grown;
+      }
+    }
+  }
+  reclaim();
+  return heapBytes;
+}
+
+void FanEndpointArena::beginTeardown() {
+  release();
+  freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+void FanEndpointArena::endTeardown(bool destroyed) {
+  int32_t freedBytes = (int32_t)(heap_caps_get_free_size(MALLOC_CAP_8BIT) - freeBefore);
+  if (destroyed && endpointCount > 0) {
+    endpointCount--;
+  }
+  if (freedBytes > 0) {
+    usedBytes = usedBytes > (size_t)freedBytes ? usedBytes - freedBytes : 0;
+  }
+  reclaim();
+}
+
+void FanEndpointArena::release() {
+  if (reserve != nullptr) {
+    heap_caps_free(reserve);
+    reserve = nullptr;
+    reservedBytes = 0;
+  }
+}
+
+void FanEndpointArena::reclaim() {
+  release();
+  if (!started || endpointCount >= capacity) {
+    return;
+  }
+  // One block for every endpoint still to come
+  size_t bytes = (capacity - endpointCount) * bytesPerEndpoint;
+  reserve = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+  if (reserve != nullptr) {
+    reservedBytes = bytes;
+  } else {
+    log_w("Endpoint arena: could not claim %u bytes again", (unsigned)bytes);
+  }
+}
+
+// ============================================================================
+// Accounting
+// ============================================================================
+
+size_t FanEndpointArena::estimateBytes(uint8_t clusters, uint16_t attributes, uint16_t commands) {
+  return FAN_ARENA_ENDPOINT_BYTES + clusters * FAN_ARENA_CLUSTER_BYTES + attributes * FAN_ARENA_ATTRIBUTE_BYTES +
+         commands * FAN_ARENA_COMMAND_BYTES;
+}
+
+bool FanEndpointArena::measure(uint16_t endpointId, FanEndpointFootprint &footprint) {
+  endpoint_t *endpoint = endpoint::get(node::get(), endpointId);
+  if (endpoint == nullptr) {
+    return false;
+  }
+
+  footprint.endpointId = endpointId;
+  footprint.clusterCount = 0;
+  footprint.attributeCount = 0;
+  footprint.commandCount = 0;
+  for (cluster_t *cluster = cluster::get_first(endpoint); cluster != nullptr; cluster = cluster::get_next(cluster)) {
+    footprint.clusterCount++;
+    for (attribute_t *attribute = attribute::get_first(cluster); attribute != nullptr; attribute = attribute::get_next(attribute)) {
+      footprint.attributeCount++;
+    }
+    for (command_t *command = command::get_first(cluster); command != nullptr; command = command::get_next(command)) {
+      footprint.commandCount++;
+    }
+  }
+
+  footprint.clusterBytes = FAN_ARENA_ENDPOINT_BYTES + footprint.clusterCount * FAN_ARENA_CLUSTER_BYTES;
+  footprint.attributeBytes = footprint.attributeCount * FAN_ARENA_ATTRIBUTE_BYTES;
+  footprint.callbackBytes = footprint.commandCount * FAN_ARENA_COMMAND_BYTES;
+  return true;
+}
+
+uint8_t FanEndpointArena::getCapacity() {
+  return capacity;
+}
+
+uint8_t FanEndpointArena::getEndpointCount() {
+  return endpointCount;
+}
+
+size_t FanEndpointArena::getBytesPerEndpoint() {
+  return bytesPerEndpoint;
+}
+
+size_t FanEndpointArena::getReservedBytes() {
+  return reservedBytes;
+}
+
+size_t FanEndpointArena::getUsedBytes() {
+  return usedBytes;
+}
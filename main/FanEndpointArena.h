@@ -0,0 +1,87 @@
+#ifndef FAN_ENDPOINT_ARENA_H
+#define FAN_ENDPOINT_ARENA_H
+
+#include <Arduino.h>
+#include <esp_matter.h>
+
+// Approximate heap cost of one esp_matter object, including the allocator header
+#define FAN_ARENA_ENDPOINT_BYTES 96
+#define FAN_ARENA_CLUSTER_BYTES 64
+#define FAN_ARENA_ATTRIBUTE_BYTES 40
+#define FAN_ARENA_COMMAND_BYTES 24
+// The size per endpoint grows with measured constructions up to this multiple of the estimate
+#define FAN_ARENA_MAX_GROWTH 2
+
+// RAM used by one endpoint
+struct FanEndpointFootprint {
+  uint16_t endpointId = 0;
+  uint8_t clusterCount = 0;
+  uint16_t attributeCount = 0;
+  uint16_t commandCount = 0;     // Command callbacks of the endpoint's clusters
+  uint8_t callbackCount = 0;     // Application callbacks registered on the endpoint object
+  uint32_t clusterBytes = 0;     // Estimated from the counts above
+  uint32_t attributeBytes = 0;
+  uint32_t callbackBytes = 0;    // Command callbacks
+  int32_t heapBytes = 0;         // Measured: free heap before minus after construction
+  uint32_t objectBytes = 0;      // Endpoint object (static or global storage)
+};
+
+// Heap reserved up front for the Matter endpoints of the enabled features
+//
+// esp_matter allocates every endpoint, cluster and attribute separately from the
+// general heap and has no allocator hook. A bridged fan discovered an hour after
+// boot then gets its small blocks wherever the heap has room by then, between the
+// buffers of the radio and the subscriptions - or does not get them at all. The
+// arena claims the memory for all endpoints as one block at boot, while the heap
+// is still in one piece. A construction releases the block, lets esp_matter
+// allocate into the hole, measures what it took and claims the rest again; a
+// teardown gives the endpoint's share back the same way.
+//
+// The size per endpoint starts from an estimate (estimateBytes()) and follows the
+// largest measured construction, up to FAN_ARENA_MAX_GROWTH times the estimate: a
+// construction that overlapped with another task's allocations measures their
+// heap too and must not inflate the reservation for every later endpoint.
+class FanEndpointArena {
+public:
+  FanEndpointArena();
+  ~FanEndpointArena();
+
+  // Claim the heap for endpointCount endpoints of bytesPerEndpoint each
+  bool begin(uint8_t endpointCount, size_t bytesPerEndpoint);
+  void end();
+
+  // Bracket the construction or teardown of one endpoint
+  void beginConstruction();
+  // Heap the construction took; built is false when it failed
+  int32_t endConstruction(bool built);
+  void beginTeardown();
+  void endTeardown(bool destroyed);
+
+  // Heap estimate for an endpoint with these objects
+  static size_t estimateBytes(uint8_t clusters, uint16_t attributes, uint16_t commands);
+  // Count the clusters, attributes and commands of an endpoint and estimate their RAM
+  static bool measure(uint16_t endpointId, FanEndpointFootprint &footprint);
+
+  uint8_t getCapacity();
+  uint8_t getEndpointCount();
+  size_t getBytesPerEndpoint();
+  size_t getReservedBytes();
+  size_t getUsedBytes();
+
+protected:
+  bool started = false;
+  uint8_t capacity = 0;
+  uint8_t endpointCount = 0;
+  size_t bytesPerEndpoint = 0;
+  size_t estimatedBytes = 0;     // bytesPerEndpoint passed to begin()
+  size_t usedBytes = 0;
+
+  void *reserve = nullptr;
+  size_t reservedBytes = 0;
+  size_t freeBefore = 0;
+
+  void release();
+  void reclaim();
+};
+
+#endif // FAN_ENDPOINT_ARENA_H
@@ -0,0 +1,278 @@
+#include "FanEnergyMeter.h"
+
+using namespace esp_matter;
+using namespace esp_matter::cluster;
+using namespace chip::app::Clusters;
+
+// NVS namespace and key for the energy checkpoint
+static const char *kEnergyNamespace = "fan-energy";
+static const char *kEnergyKey = "imported-mwh";
+
+// The power model is an estimate: declare +/-20% (in 1/100 %) over 0..100W
+static const int64_t kMaxMeasuredPower = 100000;  // mW
+static const ElectricalPowerMeasurement::Structs::MeasurementAccuracyRangeStruct::Type kPowerAccuracyRanges[] = {
+  {
+    .rangeMin = 0,
+    .rangeMax = kMaxMeasuredPower,
+    .percentMax = chip::MakeOptional(static_cast<chip::Percent100ths>(2000)),
+    .percentMin = chip::MakeOptional(static_cast<chip::Percent100ths>(2000)),
+    .percentTypical = chip::MakeOptional(static_cast<chip::Percent100ths>(1000)),
+  },
+};
+
+static const ElectricalEnergyMeasurement::Structs::MeasurementAccuracyRangeStruct::Type kEnergyAccuracyRanges[] = {
+  {
+    .rangeMin = 0,
+    .rangeMax = INT64_MAX,
+    .percentMax = chip::MakeOptional(static_cast<chip::Percent100ths>(2000)),
+    .percentMin = chip::MakeOptional(static_cast<chip::Percent100ths>(2000)),
+    .percentTypical = chip::MakeOptional(static_cast<chip::Percent100ths>(1000)),
+  },
+};
+
+// ============================================================================
+// ElectricalPowerMeasurement delegate
+// ============================================================================
+
+ElectricalPowerMeasurement::PowerModeEnum FanPowerMeasurementDelegate::GetPowerMode() {
+  return ElectricalPowerMeasurement::PowerModeEnum::kAc;
+}
+
+CHIP_ERROR FanPowerMeasurementDelegate::GetAccuracyByIndex(
+  uint8_t index, ElectricalPowerMeasurement::Structs::MeasurementAccuracyStruct::Type &accuracy
+) {
+  if (index != 0) {
+    return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+  }
+  accuracy.measurementType = ElectricalPowerMeasurement::MeasurementTypeEnum::kActivePower;
+  accuracy.measured = false;  // Estimated from the speed level
+  accuracy.minMeasuredValue = 0;
+  accuracy.maxMeasuredValue = kMaxMeasuredPower;
+  accuracy.accuracyRanges = chip::app::DataModel::List<const ElectricalPowerMeasurement::Structs::MeasurementAccuracyRangeStruct::Type>(kPowerAccuracyRanges);
+  return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR FanPowerMeasurementDelegate::GetRangeByIndex(
+  uint8_t index, ElectricalPowerMeasurement::Structs::MeasurementRangeStruct::Type &range
+) {
+  // Ranges are optional and not tracked
+  return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+}
+
+CHIP_ERROR FanPowerMeasurementDelegate::GetHarmonicCurrentsByIndex(
+  uint8_t index, ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &harmonic
+) {
+  return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+}
+
+CHIP_ERROR FanPowerMeasurementDelegate::GetHarmonicPhasesByIndex(
+  uint8_t index, ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &harmonic
+) {
+  return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+}
+
+// ============================================================================
+// FanEnergyMeter
+// ============================================================================
+
+FanEnergyMeter::FanEnergyMeter() {}
+
+bool FanEnergyMeter::begin(MatterEndPoint &fan, FanPowerSource *powerSource, uint8_t initialSpeed) {
+  if (started) {
+    log_e("Fan Energy Meter already initialized");
+    return false;
+  }
+  if (powerSource == nullptr) {
+    log_e("Fan Energy Meter needs a power source");
+    return false;
+  }
+
+  endpoint_t *endpoint = endpoint::get(node::get(), fan.getEndPointId());
+  if (endpoint == nullptr) {
+    log_e("Fan endpoint %d not found, call begin() on the fan first", fan.getEndPointId());
+    return false;
+  }
+
+  // Electrical Sensor device type requires Power Topology on the same endpoint
+  power_topology::config_t powerTopologyConfig;
+  cluster_t *powerTopology = power_topology::create(endpoint, &powerTopologyConfig, CLUSTER_FLAG_SERVER);
+  if (powerTopology == nullptr) {
+    log_e("Failed to create Power Topology cluster");
+    return false;
+  }
+  power_topology::feature::node_topology::add(powerTopology);
+
+  electrical_power_measurement::config_t powerConfig;
+  powerConfig.delegate = &powerDelegate;
+  cluster_t *powerCluster = electrical_power_measurement::create(endpoint, &powerConfig, CLUSTER_FLAG_SERVER);
+  if (powerCluster == nullptr) {
+    log_e("Failed to create Electrical Power Measurement cluster");
+    return false;
+  }
+  electrical_power_measurement::feature::alternating_current::add(powerCluster);
+
+  electrical_energy_measurement::config_t energyConfig;
+  cluster_t *energyCluster = electrical_energy_measurement::create(endpoint, &energyConfig, CLUSTER_FLAG_SERVER);
+  if (energyCluster == nullptr) {
+    log_e("Failed to create Electrical Energy Measurement cluster");
+    return false;
+  }
+  electrical_energy_measurement::feature::imported_energy::add(energyCluster);
+  electrical_energy_measurement::feature::cumulative_energy::add(energyCluster);
+
+  endpoint::add_device_type(endpoint, endpoint::electrical_sensor::get_device_type_id(),
+                            endpoint::electrical_sensor::get_device_type_version());
+
+  this->endpointId = fan.getEndPointId();
+  this->powerSource = powerSource;
+  powerDelegate.SetEndpointId(endpointId);
+
+  currentSpeed = initialSpeed;
+  activePower = powerSource->getActivePowerMilliWatts(currentSpeed);
+  powerDelegate.setActivePower(activePower);
+  reportedActivePower = activePower;
+  loadCheckpoint();
+  lastIntegrationTime = millis();
+  energyStartTime = lastIntegrationTime;
+
+  log_i("Fan Energy Meter initialized on endpoint %d (%s power)", endpointId, powerSource->isMeasured() ? "measured" : "estimated");
+
+  started = true;
+  return true;
+}
+
+void FanEnergyMeter::setReportThresholds(int64_t powerDeltaMilliWatts, int64_t energyDeltaMilliWattHours) {
+  powerDeltaThreshold = powerDeltaMilliWatts;
+  energyDeltaThreshold = energyDeltaMilliWattHours;
+}
+
+void FanEnergyMeter::integrate() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastIntegrationTime;
+  lastIntegrationTime = now;
+
+  // Accumulate in mW*ms and only carry whole mWh into the total, so no energy is lost to rounding
+  energyRemainder += (uint64_t)activePower * elapsed;
+  energy += (int64_t)(energyRemainder / 3600000ULL);
+  energyRemainder %= 3600000ULL;
+}
+
+void FanEnergyMeter::setSpeed(uint8_t speed) {
+  if (!started || speed == currentSpeed) {
+    return;
+  }
+
+  // Close the interval at the old power level, then switch
+  integrate();
+  currentSpeed = speed;
+  activePower = powerSource->getActivePowerMilliWatts(speed);
+  powerDelegate.setActivePower(activePower);
+
+  int64_t powerDelta = activePower - reportedActivePower;
+  if (powerDelta >= powerDeltaThreshold || -powerDelta >= powerDeltaThreshold) {
+    reportActivePower();
+  }
+  if (energy - reportedEnergy >= energyDeltaThreshold) {
+    reportEnergy();
+  }
+}
+
+void FanEnergyMeter::sync() {
+  if (!started) {
+    return;
+  }
+
+  integrate();
+
+  // A measured source may drift at a constant speed level
+  if (powerSource->isMeasured()) {
+    activePower = powerSource->getActivePowerMilliWatts(currentSpeed);
+    powerDelegate.setActivePower(activePower);
+    int64_t powerDelta = activePower - reportedActivePower;
+    if (powerDelta >= powerDeltaThreshold || -powerDelta >= powerDeltaThreshold) {
+      reportActivePower();
+    }
+  }
+  if (energy - reportedEnergy >= energyDeltaThreshold) {
+    reportEnergy();
+  }
+}
+
+void FanEnergyMeter::reportActivePower() {
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  MatterReportingAttributeChangeCallback(endpointId, ElectricalPowerMeasurement::Id,
+                                         ElectricalPowerMeasurement::Attributes::ActivePower::Id);
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+  reportedActivePower = activePower;
+  log_d("ActivePower reported: %lldmW", activePower);
+}
+
+void FanEnergyMeter::reportEnergy() {
+  ElectricalEnergyMeasurement::Structs::EnergyMeasurementStruct::Type energyImported;
+  energyImported.energy = energy;
+  // A total restored from NVS began before this boot: there is no start time to claim
+  if (!energyRestored) {
+    energyImported.startSystime.SetValue((uint64_t)energyStartTime);
+  }
+  energyImported.endSystime.SetValue((uint64_t)lastIntegrationTime);
+
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  // The accuracy attribute must be set before the first measurement is accepted
+  if (!accuracySet) {
+    ElectricalEnergyMeasurement::Structs::MeasurementAccuracyStruct::Type accuracy;
+    accuracy.measurementType = ElectricalEnergyMeasurement::MeasurementTypeEnum::kElectricalEnergy;
+    accuracy.measured = powerSource->isMeasured();
+    accuracy.minMeasuredValue = 0;
+    accuracy.maxMeasuredValue = INT64_MAX;
+    accuracy.accuracyRanges = chip::app::DataModel::List<const ElectricalEnergyMeasurement::Structs::MeasurementAccuracyRangeStruct::Type>(kEnergyAccuracyRanges);
+    accuracySet = ElectricalEnergyMeasurement::SetMeasurementAccuracy(endpointId, accuracy) == CHIP_NO_ERROR;
+  }
+  ElectricalEnergyMeasurement::NotifyCumulativeEnergyMeasured(endpointId, chip::MakeOptional(energyImported), chip::NullOptional);
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+
+  reportedEnergy = energy;
+  log_d("CumulativeEnergyImported reported: %lldmWh", energy);
+  saveCheckpoint();
+}
+
+// ============================================================================
+// Checkpoint
+// ============================================================================
+
+void FanEnergyMeter::loadCheckpoint() {
+  Preferences prefs;
+  if (!prefs.begin(kEnergyNamespace, true)) {
+    // Namespace does not exist until the first checkpoint
+    return;
+  }
+  energyRestored = prefs.isKey(kEnergyKey);
+  energy = prefs.getLongLong(kEnergyKey, 0);
+  prefs.end();
+  reportedEnergy = energy;
+  log_i("Fan Energy Meter: CumulativeEnergyImported restored at %lldmWh", energy);
+}
+
+void FanEnergyMeter::saveCheckpoint() {
+  // Once per report threshold (10 Wh by default), so the flash sees few writes
+  Preferences prefs;
+  if (!prefs.begin(kEnergyNamespace, false)) {
+    log_e("Failed to open NVS namespace %s", kEnergyNamespace);
+    return;
+  }
+  if (prefs.putLongLong(kEnergyKey, energy) != sizeof(int64_t)) {
+    log_w("Failed to checkpoint the energy total");
+  }
+  prefs.end();
+}
+
+int64_t FanEnergyMeter::getActivePowerMilliWatts() {
+  return activePower;
+}
+
+int64_t FanEnergyMeter::getEnergyMilliWattHours() {
+  return energy;
+}
@@ -0,0 +1,105 @@
+#ifndef FAN_ENERGY_METER_H
+#define FAN_ENERGY_METER_H
+
+#include <Matter.h>
+#include <MatterEndPoint.h>
+#include <Preferences.h>
+#include <app/clusters/electrical-energy-measurement-server/electrical-energy-measurement-server.h>
+#include <app/clusters/electrical-power-measurement-server/electrical-power-measurement-server.h>
+#include "FanPowerModel.h"
+
+// ElectricalPowerMeasurement delegate serving ActivePower from a FanPowerSource
+class FanPowerMeasurementDelegate : public chip::app::Clusters::ElectricalPowerMeasurement::Delegate {
+public:
+  void setActivePower(int64_t milliWatts) { activePower = milliWatts; }
+
+  chip::app::Clusters::ElectricalPowerMeasurement::PowerModeEnum GetPowerMode() override;
+  uint8_t GetNumberOfMeasurementTypes() override { return 1; }
+
+  CHIP_ERROR StartAccuracyRead() override { return CHIP_NO_ERROR; }
+  CHIP_ERROR GetAccuracyByIndex(uint8_t index, chip::app::Clusters::ElectricalPowerMeasurement::Structs::MeasurementAccuracyStruct::Type &accuracy) override;
+  CHIP_ERROR EndAccuracyRead() override { return CHIP_NO_ERROR; }
+
+  CHIP_ERROR StartRangesRead() override { return CHIP_NO_ERROR; }
+  CHIP_ERROR GetRangeByIndex(uint8_t index, chip::app::Clusters::ElectricalPowerMeasurement::Structs::MeasurementRangeStruct::Type &range) override;
+  CHIP_ERROR EndRangesRead() override { return CHIP_NO_ERROR; }
+
+  CHIP_ERROR StartHarmonicCurrentsRead() override { return CHIP_NO_ERROR; }
+  CHIP_ERROR GetHarmonicCurrentsByIndex(uint8_t index, chip::app::Clusters::ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &harmonic) override;
+  CHIP_ERROR EndHarmonicCurrentsRead() override { return CHIP_NO_ERROR; }
+
+  CHIP_ERROR StartHarmonicPhasesRead() override { return CHIP_NO_ERROR; }
+  CHIP_ERROR GetHarmonicPhasesByIndex(uint8_t index, chip::app::Clusters::ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &harmonic) override;
+  CHIP_ERROR EndHarmonicPhasesRead() override { return CHIP_NO_ERROR; }
+
+  chip::app::DataModel::Nullable<int64_t> GetVoltage() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetActiveCurrent() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetReactiveCurrent() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetApparentCurrent() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetActivePower() override { return chip::app::DataModel::MakeNullable(activePower); }
+  chip::app::DataModel::Nullable<int64_t> GetReactivePower() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetApparentPower() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetRMSVoltage() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetRMSCurrent() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetRMSPower() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetFrequency() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetPowerFactor() override { return {}; }
+  chip::app::DataModel::Nullable<int64_t> GetNeutralCurrent() override { return {}; }
+
+protected:
+  int64_t activePower = 0;
+};
+
+// Adds Electrical Power Measurement and Electrical Energy Measurement to the fan
+// endpoint. Energy is integrated on speed changes (no periodic tick) and both
+// ActivePower and CumulativeEnergyImported are only reported past a delta threshold.
+// The energy total is checkpointed to NVS with every report, so it survives a
+// reboot; a power loss costs at most the energy since the last report.
+class FanEnergyMeter {
+public:
+  FanEnergyMeter();
+
+  // Create the clusters on the fan endpoint - call before Matter.begin()
+  bool begin(MatterEndPoint &fan, FanPowerSource *powerSource, uint8_t initialSpeed = 0);
+
+  // Report thresholds
+  void setReportThresholds(int64_t powerDeltaMilliWatts, int64_t energyDeltaMilliWattHours);
+
+  // Call whenever the physical fan speed changes
+  void setSpeed(uint8_t speed);
+
+  // Integrate up to now without a speed change (e.g. from an existing periodic status print)
+  void sync();
+
+  // Measurement results
+  int64_t getActivePowerMilliWatts();
+  int64_t getEnergyMilliWattHours();
+
+protected:
+  bool started = false;
+  uint16_t endpointId = 0;
+  FanPowerSource *powerSource = nullptr;
+  FanPowerMeasurementDelegate powerDelegate;
+
+  uint8_t currentSpeed = 0;
+  int64_t activePower = 0;               // mW at currentSpeed
+  unsigned long lastIntegrationTime = 0;
+  uint64_t energyRemainder = 0;          // mW*ms not yet converted to mWh
+  int64_t energy = 0;                    // Cumulative imported energy in mWh
+  unsigned long energyStartTime = 0;     // millis() when metering started
+  bool energyRestored = false;           // Total carried over from NVS, so it predates energyStartTime
+
+  int64_t reportedActivePower = 0;
+  int64_t reportedEnergy = 0;
+  int64_t powerDeltaThreshold = 500;     // 0.5 W
+  int64_t energyDeltaThreshold = 10000;  // 10 Wh
+  bool accuracySet = false;
+
+  void integrate();
+  void reportActivePower();
+  void reportEnergy();
+  void loadCheckpoint();
+  void saveCheckpoint();
+};
+
+#endif // FAN_ENERGY_METER_H
@@ -0,0 +1,84 @@
+#include "FanIdlePolicy.h"
+
+FanIdlePolicy::FanIdlePolicy() {}
+
+void FanIdlePolicy::setSleepLimits(uint32_t minSleepMs, uint32_t maxSleepMs) {
+  this->minSleepMs = minSleepMs;
+  this->maxSleepMs = maxSleepMs;
+}
+
+void FanIdlePolicy::beginCycle(uint32_t nowMs) {
+  cycleStartMs = nowMs;
+  awake = false;
+  hasDeadline = false;
+}
+
+void FanIdlePolicy::keepAwake() {
+  awake = true;
+}
+
+void FanIdlePolicy::wakeAt(uint32_t timeMs) {
+  // Relative to the start of the pass, so millis() wrapping around is harmless
+  if (!hasDeadline || (int32_t)(timeMs - deadlineMs) < 0) {
+    deadlineMs = timeMs;
+    hasDeadline = true;
+  }
+}
+
+uint32_t FanIdlePolicy::planSleep() {
+  if (awake) {
+    busyCycleCount++;
+    return 0;
+  }
+
+  uint32_t sleepMs = maxSleepMs;
+  if (hasDeadline) {
+    int32_t untilDeadline = (int32_t)(deadlineMs - cycleStartMs);
+    if (untilDeadline <= 0) {
+      return 0;
+    }
+    if ((uint32_t)untilDeadline < sleepMs) {
+      sleepMs = (uint32_t)untilDeadline;
+    }
+  }
+  return sleepMs < minSleepMs ? 0 : sleepMs;
+}
+
+void FanIdlePolicy::recordSleep(uint32_t startMs, uint32_t endMs, FanWakeReason reason) {
+  asleepMs += endMs - startMs;
+  sleepCount++;
+  if (reason < FAN_WAKE_REASONS) {
+    wakeCounts[reason]++;
+  }
+}
+
+uint32_t FanIdlePolicy::getAwakeMs(uint32_t nowMs) {
+  uint64_t totalMs = nowMs - statsStartMs;
+  return totalMs > asleepMs ? (uint32_t)(totalMs - asleepMs) : 0;
+}
+
+uint32_t FanIdlePolicy::getAsleepMs() {
+  return (uint32_t)asleepMs;
+}
+
+uint32_t FanIdlePolicy::getSleepCount() {
+  return sleepCount;
+}
+
+uint32_t FanIdlePolicy::getBusyCycleCount() {
+  return busyCycleCount;
+}
+
+uint32_t FanIdlePolicy::getWakeCount(FanWakeReason reason) {
+  return reason < FAN_WAKE_REASONS ? wakeCounts[reason] : 0;
+}
+
+void FanIdlePolicy::resetStats(uint32_t nowMs) {
+  statsStartMs = nowMs;
+  asleepMs = 0;
+  sleepCount = 0;
+  busyCycleCount = 0;
+  for (uint8_t i = 0; i < FAN_WAKE_REASONS; i++) {
+    wakeCounts[i] = 0;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef FAN_IDLE_POLICY_H
+#define FAN_IDLE_POLICY_H
+
+#include <Arduino.h>
+
+// Why a wait in loop() ended
+enum FanWakeReason : uint8_t {
+  FAN_WAKE_TIMER = 0,   // The next deadline was reached
+  FAN_WAKE_GPIO = 1,    // An input pin (LED input, button) changed
+  FAN_WAKE_OTHER = 2,   // Another task needs loop() (e.g. a Matter callback)
+  FAN_WAKE_REASONS
+};
+
+// Idle policy for loop()
+//
+// Every pass of loop() collects what the firmware is waiting for: work that
+// needs loop() at full rate (keepAwake(): a pulse train, a bus poll) or the next
+// time something is due (wakeAt(): a debounce timeout, a report flush, the next
+// sensor sample, the status print). planSleep() then says how long loop() may
+// block; while it blocks, the idle task can enter automatic light sleep.
+//
+// All times are millis() values passed in by the caller, so the policy runs
+// unchanged on the host with a simulated clock. Waits shorter than minSleepMs
+// are not worth the wake-up cost and are skipped; maxSleepMs bounds the latency
+// of anything that is polled without a wake source (serial input, commissioning).
+class FanIdlePolicy {
+public:
+  FanIdlePolicy();
+
+  void setSleepLimits(uint32_t minSleepMs, uint32_t maxSleepMs);
+
+  // Start collecting for one pass of loop()
+  void beginCycle(uint32_t nowMs);
+  // Something needs loop() to keep running this pass
+  void keepAwake();
+  // loop() has work at timeMs (earlier calls win; a time in the past means now)
+  void wakeAt(uint32_t timeMs);
+
+  // Milliseconds loop() may block now; 0 to stay awake
+  uint32_t planSleep();
+  // Account one wait that lasted from startMs to endMs
+  void recordSleep(uint32_t startMs, uint32_t endMs, FanWakeReason reason);
+
+  // Instrumentation since begin or resetStats()
+  uint32_t getAwakeMs(uint32_t nowMs);
+  uint32_t getAsleepMs();
+  uint32_t getSleepCount();
+  uint32_t getBusyCycleCount();   // Passes kept awake by keepAwake()
+  uint32_t getWakeCount(FanWakeReason reason);
+  void resetStats(uint32_t nowMs);
+
+protected:
+  uint32_t minSleepMs = 5;
+  uint32_t maxSleepMs = 1000;
+
+  uint32_t cycleStartMs = 0;
+  bool awake = false;
+  bool hasDeadline = false;
+  uint32_t deadlineMs = 0;
+
+  uint32_t statsStartMs = 0;
+  uint64_t asleepMs = 0;
+  uint32_t sleepCount = 0;
+  uint32_t busyCycleCount = 0;
+  uint32_t wakeCounts[FAN_WAKE_REASONS] = {0};
+};
+
+#endif // FAN_IDLE_POLICY_H
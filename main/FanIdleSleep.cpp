@@ -0,0 +1,138 @@
+#include "FanIdleSleep.h"
+
+#include <driver/gpio.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+
+TaskHandle_t FanIdleSleep::waitingTask = nullptr;
+volatile bool FanIdleSleep::wokenByPin = false;
+
+FanIdleSleep::FanIdleSleep() {}
+
+bool FanIdleSleep::begin(const uint8_t *pins, uint8_t pinCount) {
+  if (started) {
+    return true;
+  }
+  if (pinCount > FAN_IDLE_MAX_WAKE_PINS) {
+    log_w("Idle sleep: only %d wake pins are watched", FAN_IDLE_MAX_WAKE_PINS);
+    pinCount = FAN_IDLE_MAX_WAKE_PINS;
+  }
+
+#if CONFIG_PM_ENABLE
+  esp_pm_config_t pmConfig = {};
+  pmConfig.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+  pmConfig.min_freq_mhz = CONFIG_XTAL_FREQ;
+  pmConfig.light_sleep_enable = true;
+  esp_err_t err = esp_pm_configure(&pmConfig);
+  if (err == ESP_OK) {
+    lightSleep = true;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "fan-console", &awakeLock) != ESP_OK) {
+      log_w("Idle sleep: no power management lock, serial input may be lost in light sleep");
+      awakeLock = nullptr;
+    }
+  } else {
+    log_w("Idle sleep: esp_pm_configure failed (%s), waits without light sleep", esp_err_to_name(err));
+  }
+#else
+  log_w("Idle sleep: CONFIG_PM_ENABLE is off, waits without light sleep");
+#endif
+
+  esp_err_t isrErr = gpio_install_isr_service(0);
+  if (isrErr != ESP_OK && isrErr != ESP_ERR_INVALID_STATE) {
+    log_e("Idle sleep: GPIO ISR service not available");
+    return false;
+  }
+  for (uint8_t i = 0; i < pinCount; i++) {
+    gpio_num_t pin = (gpio_num_t)pins[i];
+    this->pins[i] = pins[i];
+    // Keep the pull-ups of the normal configuration while asleep
+    gpio_sleep_sel_dis(pin);
+    gpio_intr_disable(pin);
+    gpio_isr_handler_add(pin, onWakePin, (void *)(uintptr_t)pin);
+  }
+  this->pinCount = pinCount;
+  esp_sleep_enable_gpio_wakeup();
+
+  waitingTask = xTaskGetCurrentTaskHandle();
+  started = true;
+  log_i("Idle sleep: %s, %d wake pins", lightSleep ? "automatic light sleep" : "task wait only", pinCount);
+  return true;
+}
+
+bool FanIdleSleep::isLightSleepEnabled() {
+  return lightSleep;
+}
+
+void FanIdleSleep::holdAwake(bool hold) {
+  if (hold == heldAwake || awakeLock == nullptr) {
+    return;
+  }
+  if (hold) {
+    esp_pm_lock_acquire(awakeLock);
+  } else {
+    esp_pm_lock_release(awakeLock);
+  }
+  heldAwake = hold;
+  log_d("Idle sleep: light sleep %s", hold ? "held off (console in use)" : "allowed");
+}
+
+bool FanIdleSleep::isHeldAwake() {
+  return heldAwake;
+}
+
+FanWakeReason FanIdleSleep::sleep(uint32_t sleepMs) {
+  if (!started || sleepMs == 0) {
+    return FAN_WAKE_OTHER;
+  }
+
+  // A notification left over from an earlier edge must not end this wait
+  ulTaskNotifyTake(pdTRUE, 0);
+  wokenByPin = false;
+  armPins();
+  // The tickless idle task turns the blocked time into light sleep; the timer
+  // wake is derived from the next FreeRTOS tick that has work
+  bool woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs)) > 0;
+  disarmPins();
+
+  if (!woken) {
+    return FAN_WAKE_TIMER;
+  }
+  return wokenByPin ? FAN_WAKE_GPIO : FAN_WAKE_OTHER;
+}
+
+void FanIdleSleep::wake() {
+  if (started && waitingTask != nullptr) {
+    xTaskNotifyGive(waitingTask);
+  }
+}
+
+void FanIdleSleep::armPins() {
+  for (uint8_t i = 0; i < pinCount; i++) {
+    gpio_num_t pin = (gpio_num_t)pins[i];
+    gpio_int_type_t wakeLevel = gpio_get_level(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    gpio_wakeup_enable(pin, wakeLevel);
+    gpio_intr_enable(pin);
+  }
+}
+
+void FanIdleSleep::disarmPins() {
+  for (uint8_t i = 0; i < pinCount; i++) {
+    gpio_num_t pin = (gpio_num_t)pins[i];
+    gpio_intr_disable(pin);
+    gpio_wakeup_disable(pin);
+  }
+}
+
+void IRAM_ATTR FanIdleSleep::onWakePin(void *arg) {
+  // Level interrupts repeat while the level holds: one is enough to end the wait
+  gpio_num_t pin = (gpio_num_t)(uintptr_t)arg;
+  gpio_intr_disable(pin);
+  wokenByPin = true;
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  if (waitingTask != nullptr) {
+    vTaskNotifyGiveFromISR(waitingTask, &higherPriorityTaskWoken);
+  }
+  if (higherPriorityTaskWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef FAN_IDLE_SLEEP_H
+#define FAN_IDLE_SLEEP_H
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include "FanIdlePolicy.h"
+
+// Maximum number of wake pins
+#define FAN_IDLE_MAX_WAKE_PINS 8
+
+// Blocks loop() for the time FanIdlePolicy allows, with automatic light sleep
+//
+// begin() enables esp_pm automatic light sleep (CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE in sdkconfig) with a timer wake for the
+// deadline and GPIO wakes on the input pins. Light sleep GPIO wakes are level
+// triggered, so every pin is armed for the level it does not have right now:
+// an LED input that stays LOW for hours does not keep the chip awake, and any
+// edge ends the wait at once. The radio drivers hold their own power
+// management locks, so Matter traffic is unaffected.
+//
+// The serial console has no wake source: the USB Serial/JTAG port stops and
+// UART input is lost while the chip sleeps. holdAwake() takes a power
+// management lock that keeps waits out of light sleep while a console is in use.
+class FanIdleSleep {
+public:
+  FanIdleSleep();
+
+  // pins: inputs whose change must end a wait (LED inputs, buttons)
+  bool begin(const uint8_t *pins, uint8_t pinCount);
+
+  // Block the calling task (loop()) for up to sleepMs
+  FanWakeReason sleep(uint32_t sleepMs);
+  // End a wait from another task, e.g. a Matter callback that starts a pulse train
+  void wake();
+
+  // Keep waits out of light sleep (a console in use); waits still block the task
+  void holdAwake(bool hold);
+  bool isHeldAwake();
+
+  bool isLightSleepEnabled();
+
+protected:
+  bool started = false;
+  bool lightSleep = false;
+  esp_pm_lock_handle_t awakeLock = nullptr;
+  bool heldAwake = false;
+  uint8_t pins[FAN_IDLE_MAX_WAKE_PINS];
+  uint8_t pinCount = 0;
+
+  static TaskHandle_t waitingTask;
+  static volatile bool wokenByPin;
+  static void onWakePin(void *arg);
+  void armPins();
+  void disarmPins();
+};
+
+#endif // FAN_IDLE_SLEEP_H
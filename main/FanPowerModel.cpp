@@ -0,0 +1,102 @@
+#include "FanPowerModel.h"
+
+// NVS namespace and key for the calibration table and its calibrated-level mask
+static const char *kPowerModelNamespace = "fan-power";
+static const char *kPowerModelKey = "level-cal";
+
+bool FanPowerModel::begin(uint8_t speedMax) {
+  if (speedMax >= FAN_POWER_MODEL_MAX_LEVELS) {
+    log_e("Power model supports at most %d speed levels", FAN_POWER_MODEL_MAX_LEVELS - 1);
+    return false;
+  }
+  this->speedMax = speedMax;
+  loadDefaults();
+
+  Preferences prefs;
+  if (!prefs.begin(kPowerModelNamespace, true)) {
+    // Namespace does not exist until the first calibration
+    log_i("Fan power model: no calibration stored, using defaults");
+    return true;
+  }
+  Calibration stored = {};
+  size_t len = prefs.getBytes(kPowerModelKey, &stored, sizeof(stored));
+  prefs.end();
+
+  if (len == sizeof(stored)) {
+    for (uint8_t level = 0; level <= speedMax; level++) {
+      if (stored.calibratedLevels & (1 << level)) {
+        levelMilliWatts[level] = stored.levelMilliWatts[level];
+        calibratedLevels |= 1 << level;
+      }
+    }
+  }
+  log_i("Fan power model (calibrated mask 0x%02X): Off=%lumW, Low=%lumW, Medium=%lumW, High=%lumW", calibratedLevels,
+        levelMilliWatts[0], levelMilliWatts[1], levelMilliWatts[2], levelMilliWatts[3]);
+  return true;
+}
+
+void FanPowerModel::loadDefaults() {
+  levelMilliWatts[0] = FAN_POWER_MW_OFF;
+  levelMilliWatts[1] = FAN_POWER_MW_LOW;
+  levelMilliWatts[2] = FAN_POWER_MW_MEDIUM;
+  levelMilliWatts[3] = FAN_POWER_MW_HIGH;
+  // Interpolate any levels beyond High from the highest default
+  for (uint8_t level = 4; level <= speedMax; level++) {
+    levelMilliWatts[level] = FAN_POWER_MW_HIGH;
+  }
+  calibratedLevels = 0;
+}
+
+int64_t FanPowerModel::getActivePowerMilliWatts(uint8_t speed) {
+  if (speed > speedMax) {
+    speed = speedMax;
+  }
+  return levelMilliWatts[speed];
+}
+
+bool FanPowerModel::calibrate(uint8_t speed, uint32_t milliWatts) {
+  if (speed > speedMax) {
+    log_e("Cannot calibrate speed %d, speedMax is %d", speed, speedMax);
+    return false;
+  }
+
+  Calibration record = {};
+  memcpy(record.levelMilliWatts, levelMilliWatts, sizeof(levelMilliWatts));
+  record.levelMilliWatts[speed] = milliWatts;
+  record.calibratedLevels = calibratedLevels | (1 << speed);
+
+  Preferences prefs;
+  if (!prefs.begin(kPowerModelNamespace, false)) {
+    log_e("Failed to open NVS namespace %s", kPowerModelNamespace);
+    return false;
+  }
+  bool ret = prefs.putBytes(kPowerModelKey, &record, sizeof(record)) == sizeof(record);
+  prefs.end();
+
+  if (ret) {
+    levelMilliWatts[speed] = milliWatts;
+    calibratedLevels = record.calibratedLevels;
+    log_i("Fan power model: speed %d calibrated to %lumW", speed, milliWatts);
+  } else {
+    log_e("Failed to store fan power calibration");
+  }
+  return ret;
+}
+
+bool FanPowerModel::isCalibrated() {
+  uint8_t allLevels = (uint8_t)((1 << (speedMax + 1)) - 1);
+  return (calibratedLevels & allLevels) == allLevels;
+}
+
+bool FanPowerModel::isCalibrated(uint8_t speed) {
+  return speed <= speedMax && (calibratedLevels & (1 << speed)) != 0;
+}
+
+void FanPowerModel::resetCalibration() {
+  Preferences prefs;
+  if (prefs.begin(kPowerModelNamespace, false)) {
+    prefs.clear();
+    prefs.end();
+  }
+  loadDefaults();
+}
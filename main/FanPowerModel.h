@@ -0,0 +1,68 @@
+#ifndef FAN_POWER_MODEL_H
+#define FAN_POWER_MODEL_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Default power draw per speed level in milliwatts (override via build flags)
+#ifndef FAN_POWER_MW_OFF
+#define FAN_POWER_MW_OFF 300         // Standby: controller + radio
+#endif
+#ifndef FAN_POWER_MW_LOW
+#define FAN_POWER_MW_LOW 25000
+#endif
+#ifndef FAN_POWER_MW_MEDIUM
+#define FAN_POWER_MW_MEDIUM 35000
+#endif
+#ifndef FAN_POWER_MW_HIGH
+#define FAN_POWER_MW_HIGH 45000
+#endif
+
+#define FAN_POWER_MODEL_MAX_LEVELS 8
+
+// Source of the fan's active power.
+// FanPowerModel estimates it from the speed level; a current-sense ADC can
+// implement the same interface and report a real measurement instead.
+class FanPowerSource {
+public:
+  virtual ~FanPowerSource() {}
+
+  // Active power in milliwatts while running at the given speed level
+  virtual int64_t getActivePowerMilliWatts(uint8_t speed) = 0;
+
+  // True when the value is measured rather than estimated
+  virtual bool isMeasured() { return false; }
+};
+
+// Per-speed-level power model, calibrated once and persisted in NVS
+class FanPowerModel : public FanPowerSource {
+public:
+  // Load the calibration from NVS, falling back to the FAN_POWER_MW_* defaults
+  bool begin(uint8_t speedMax = 3);
+
+  int64_t getActivePowerMilliWatts(uint8_t speed) override;
+
+  // Store the measured power for one speed level (e.g. from a plug-in power meter)
+  bool calibrate(uint8_t speed, uint32_t milliWatts);
+  // True once every level from Off to speedMax has been calibrated
+  bool isCalibrated();
+  bool isCalibrated(uint8_t speed);
+
+  // Drop the stored calibration and go back to the defaults
+  void resetCalibration();
+
+protected:
+  uint8_t speedMax = 3;
+  uint32_t levelMilliWatts[FAN_POWER_MODEL_MAX_LEVELS] = {0};
+  uint8_t calibratedLevels = 0;      // Bit n set: level n was measured, not a default
+
+  // NVS record: levels outside the mask are not stored values and keep their default
+  struct Calibration {
+    uint32_t levelMilliWatts[FAN_POWER_MODEL_MAX_LEVELS];
+    uint8_t calibratedLevels;
+  };
+
+  void loadDefaults();
+};
+
+#endif // FAN_POWER_MODEL_H
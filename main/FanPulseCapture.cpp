@@ -0,0 +1,133 @@
+#include "FanPulseCapture.h"
+
+FanPulseCapture::FanPulseCapture() {}
+
+FanPulseCapture::~FanPulseCapture() {
+  end();
+}
+
+bool FanPulseCapture::begin(const uint8_t *pins, uint8_t pinCount) {
+  if (started) {
+    log_e("Pulse capture already initialized");
+    return false;
+  }
+  if (pinCount == 0 || pinCount > FAN_PULSE_CAPTURE_CHANNELS) {
+    log_e("Pulse capture: %d loopback pins, 1 to %d supported", pinCount, FAN_PULSE_CAPTURE_CHANNELS);
+    return false;
+  }
+
+  // One capture timer per MCPWM group, shared by all channels
+  mcpwm_capture_timer_config_t timerConfig = {};
+  timerConfig.group_id = 0;
+  timerConfig.clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT;
+  if (mcpwm_new_capture_timer(&timerConfig, &timer) != ESP_OK) {
+    log_e("Failed to create MCPWM capture timer");
+    return false;
+  }
+  mcpwm_capture_timer_get_resolution(timer, &resolutionHz);
+
+  for (uint8_t i = 0; i < pinCount; i++) {
+    mcpwm_capture_channel_config_t channelConfig = {};
+    channelConfig.gpio_num = pins[i];
+    channelConfig.prescale = 1;
+    channelConfig.flags.pos_edge = true;
+    channelConfig.flags.neg_edge = true;
+    if (mcpwm_new_capture_channel(timer, &channelConfig, &channels[i].handle) != ESP_OK) {
+      log_e("Failed to create MCPWM capture channel on pin %d", pins[i]);
+      end();
+      return false;
+    }
+    mcpwm_capture_event_callbacks_t callbacks = {};
+    callbacks.on_cap = onCapture;
+    mcpwm_capture_channel_register_event_callbacks(channels[i].handle, &callbacks, &channels[i]);
+    mcpwm_capture_channel_enable(channels[i].handle);
+    channels[i].edgeCount = 0;
+    channelCount++;
+  }
+
+  mcpwm_capture_timer_enable(timer);
+  mcpwm_capture_timer_start(timer);
+
+  log_i("Pulse capture initialized: %d loopback pins, %lu Hz timestamps", channelCount, resolutionHz);
+  started = true;
+  return true;
+}
+
+void FanPulseCapture::end() {
+  if (timer != nullptr && started) {
+    mcpwm_capture_timer_stop(timer);
+    mcpwm_capture_timer_disable(timer);
+  }
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].handle != nullptr) {
+      mcpwm_capture_channel_disable(channels[i].handle);
+      mcpwm_del_capture_channel(channels[i].handle);
+      channels[i].handle = nullptr;
+    }
+  }
+  channelCount = 0;
+  if (timer != nullptr) {
+    mcpwm_del_capture_timer(timer);
+    timer = nullptr;
+  }
+  started = false;
+}
+
+// ============================================================================
+// Edges
+// ============================================================================
+
+bool IRAM_ATTR FanPulseCapture::onCapture(mcpwm_cap_channel_handle_t handle, const mcpwm_capture_event_data_t *event, void *arg) {
+  Channel *channel = (Channel *)arg;
+  uint8_t count = channel->edgeCount;
+  if (count < FAN_PULSE_CAPTURE_EDGES) {
+    channel->edges[count].ticks = event->cap_value;
+    channel->edges[count].rising = event->cap_edge == MCPWM_CAP_EDGE_POS;
+    channel->edgeCount = count + 1;
+  }
+  return false;
+}
+
+void FanPulseCapture::clear(uint8_t channel) {
+  if (channel < channelCount) {
+    channels[channel].edgeCount = 0;
+  }
+}
+
+uint8_t FanPulseCapture::getEdgeCount(uint8_t channel) {
+  return channel < channelCount ? channels[channel].edgeCount : 0;
+}
+
+void FanPulseCapture::measure(uint8_t channel, FanTimingStats &high, FanTimingStats &low) {
+  if (channel >= channelCount || resolutionHz == 0) {
+    return;
+  }
+  const Channel &captured = channels[channel];
+  uint8_t count = captured.edgeCount;
+  for (uint8_t i = 1; i < count; i++) {
+    const Edge &from = captured.edges[i - 1];
+    const Edge &to = captured.edges[i];
+    if (from.rising == to.rising) {
+      continue;  // A missed edge; the width is unknown
+    }
+    // The capture timer wraps; unsigned difference stays correct over one wrap
+    uint32_t widthUs = (uint32_t)((uint64_t)(to.ticks - from.ticks) * 1000000 / resolutionHz);
+    if (from.rising) {
+      high.add(widthUs);
+    } else {
+      low.add(widthUs);
+    }
+  }
+}
+
+bool FanPulseCapture::isStarted() {
+  return started;
+}
+
+uint8_t FanPulseCapture::getChannelCount() {
+  return channelCount;
+}
+
+uint32_t FanPulseCapture::getResolutionHz() {
+  return resolutionHz;
+}
@@ -0,0 +1,58 @@
+#ifndef FAN_PULSE_CAPTURE_H
+#define FAN_PULSE_CAPTURE_H
+
+#include <Arduino.h>
+#include <driver/mcpwm_cap.h>
+#include "FanTimingStats.h"
+
+// Loopback inputs watched at the same time (one MCPWM capture channel each)
+#define FAN_PULSE_CAPTURE_CHANNELS 2
+// Edges kept per channel between two clear() calls
+#define FAN_PULSE_CAPTURE_EDGES 32
+
+// Pulse width capture on looped-back input pins
+//
+// Each control output is wired to an input pin; the MCPWM capture unit latches
+// its free-running timer on both edges of that input in hardware, so the widths
+// do not depend on interrupt or task latency. The ISR only copies the latched
+// value and the edge into a small buffer; measure() turns the edges into HIGH
+// and LOW widths afterwards.
+class FanPulseCapture {
+public:
+  FanPulseCapture();
+  ~FanPulseCapture();
+
+  bool begin(const uint8_t *pins, uint8_t pinCount);
+  void end();
+
+  // Forget the edges seen so far on a channel
+  void clear(uint8_t channel);
+  uint8_t getEdgeCount(uint8_t channel);
+  // Add the HIGH and LOW widths between the captured edges to the statistics
+  void measure(uint8_t channel, FanTimingStats &high, FanTimingStats &low);
+
+  bool isStarted();
+  uint8_t getChannelCount();
+  uint32_t getResolutionHz();
+
+protected:
+  struct Edge {
+    uint32_t ticks;
+    bool rising;
+  };
+  struct Channel {
+    mcpwm_cap_channel_handle_t handle = nullptr;
+    Edge edges[FAN_PULSE_CAPTURE_EDGES];
+    volatile uint8_t edgeCount = 0;
+  };
+
+  bool started = false;
+  mcpwm_cap_timer_handle_t timer = nullptr;
+  Channel channels[FAN_PULSE_CAPTURE_CHANNELS];
+  uint8_t channelCount = 0;
+  uint32_t resolutionHz = 0;
+
+  static bool onCapture(mcpwm_cap_channel_handle_t handle, const mcpwm_capture_event_data_t *event, void *arg);
+};
+
+#endif // FAN_PULSE_CAPTURE_H
@@ -0,0 +1,191 @@
+#include "FanReportScheduler.h"
+
+#if __has_include(<app/InteractionModelEngine.h>)
+#include <app/InteractionModelEngine.h>
+#define FAN_REPORT_SUBSCRIBER_INTERVALS 1
+#endif
+
+using namespace esp_matter;
+
+static bool timeReached(uint32_t nowMs, uint32_t deadlineMs) {
+  return (int32_t)(nowMs - deadlineMs) >= 0;
+}
+
+FanReportScheduler::FanReportScheduler() {}
+
+void FanReportScheduler::begin(uint16_t endpointId, uint32_t clusterId) {
+  this->endpointId = endpointId;
+  this->clusterId = clusterId;
+}
+
+void FanReportScheduler::setWindow(uint32_t windowMs) {
+  this->windowMs = windowMs;
+}
+
+uint32_t FanReportScheduler::getWindow() {
+  return windowMs;
+}
+
+void FanReportScheduler::markDirty(uint32_t attributeId) {
+  if (attributeId >= 32) {
+    log_e("Attribute 0x%04" PRIX32 " cannot be scheduled", attributeId);
+    return;
+  }
+  if (windowMs.load() == 0) {
+    reportMask(1UL << attributeId);
+    reportedCount++;
+    return;
+  }
+  dirtyMask.fetch_or(1UL << attributeId);
+  markCount++;
+}
+
+bool FanReportScheduler::isPending() {
+  return dirtyMask.load() != 0;
+}
+
+void FanReportScheduler::setSettled(bool settled) {
+  this->settled = settled;
+}
+
+uint32_t FanReportScheduler::getFlushCount() {
+  return flushCount;
+}
+
+uint32_t FanReportScheduler::getReportedCount() {
+  return reportedCount;
+}
+
+uint32_t FanReportScheduler::getCoalescedCount() {
+  return coalescedCount;
+}
+
+// ============================================================================
+// Scheduling
+// ============================================================================
+
+void FanReportScheduler::loop(uint32_t nowMs) {
+  if (dirtyMask.load() == 0) {
+    pending = false;
+    return;
+  }
+  if (!pending) {
+    pending = true;
+    pendingSinceMs = nowMs;
+    intervals = readSubscriberIntervals();
+  }
+
+  // Latest: the window, or the first subscriber that would otherwise send a stale keep-alive
+  uint32_t holdMs = windowMs.load();
+  if (intervals.maxIntervalMs != 0 && intervals.maxIntervalMs < holdMs) {
+    holdMs = intervals.maxIntervalMs;
+  }
+  bool windowExpired = timeReached(nowMs, pendingSinceMs + holdMs);
+
+  // Earliest: no subscription can take a new report before its min interval anyway
+  bool minIntervalElapsed = !flushedOnce || timeReached(nowMs, lastFlushMs + intervals.minIntervalMs);
+
+  if (windowExpired || (settled && minIntervalElapsed)) {
+    flush(nowMs);
+  }
+}
+
+bool FanReportScheduler::getNextFlushTime(uint32_t nowMs, uint32_t &timeMs) {
+  if (dirtyMask.load() == 0) {
+    return false;
+  }
+  if (!pending) {
+    timeMs = nowMs;  // loop() has not seen these changes yet
+    return true;
+  }
+
+  uint32_t holdMs = windowMs.load();
+  if (intervals.maxIntervalMs != 0 && intervals.maxIntervalMs < holdMs) {
+    holdMs = intervals.maxIntervalMs;
+  }
+  timeMs = pendingSinceMs + holdMs;
+  if (settled) {
+    uint32_t earliestMs = flushedOnce ? lastFlushMs + intervals.minIntervalMs : nowMs;
+    if ((int32_t)(earliestMs - timeMs) < 0) {
+      timeMs = earliestMs;
+    }
+  }
+  return true;
+}
+
+void FanReportScheduler::flush(uint32_t nowMs) {
+  uint32_t mask = dirtyMask.exchange(0);
+  uint32_t marks = markCount.exchange(0);
+  pending = false;
+  if (mask == 0) {
+    return;
+  }
+
+  reportMask(mask);
+
+  uint32_t reported = __builtin_popcount(mask);
+  reportedCount += reported;
+  coalescedCount += marks > reported ? marks - reported : 0;
+  flushCount++;
+  lastFlushMs = nowMs;
+  flushedOnce = true;
+  log_d("Endpoint %d: reported %" PRIu32 " attributes (%" PRIu32 " changes) after %" PRIu32 " ms", endpointId, reported,
+        marks, nowMs - pendingSinceMs);
+}
+
+void FanReportScheduler::reportMask(uint32_t mask) {
+  // The stored values are reported, so later changes in the batch win
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  for (uint32_t attributeId = 0; mask != 0; attributeId++, mask >>= 1) {
+    if ((mask & 1) == 0) {
+      continue;
+    }
+    attribute_t *attribute = attribute::get(endpointId, clusterId, attributeId);
+    esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+    if (attribute == nullptr || attribute::get_val(attribute, &val) != ESP_OK ||
+        attribute::report(endpointId, clusterId, attributeId, &val) != ESP_OK) {
+      log_w("Failed to report attribute 0x%04" PRIX32, attributeId);
+    }
+  }
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+}
+
+FanSubscriberIntervals FanReportScheduler::readSubscriberIntervals() {
+  FanSubscriberIntervals result;
+#ifdef FAN_REPORT_SUBSCRIBER_INTERVALS
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  chip::app::InteractionModelEngine *engine = chip::app::InteractionModelEngine::GetInstance();
+  for (uint32_t i = 0; i < engine->GetNumActiveReadHandlers(); i++) {
+    chip::app::ReadHandler *handler = engine->ActiveHandlerAt(i);
+    if (handler == nullptr || !handler->IsType(chip::app::ReadHandler::InteractionType::Subscribe)) {
+      continue;
+    }
+    bool covered = false;
+    for (auto *path = handler->GetAttributePathList(); path != nullptr && !covered; path = path->mpNext) {
+      covered = (path->mValue.HasWildcardEndpointId() || path->mValue.mEndpointId == endpointId) &&
+                (path->mValue.HasWildcardClusterId() || path->mValue.mClusterId == clusterId);
+    }
+    if (!covered) {
+      continue;
+    }
+    uint16_t minIntervalS = 0;
+    uint16_t maxIntervalS = 0;
+    handler->GetReportingIntervals(minIntervalS, maxIntervalS);
+    uint32_t minIntervalMs = (uint32_t)minIntervalS * 1000;
+    uint32_t maxIntervalMs = (uint32_t)maxIntervalS * 1000;
+    if (result.subscriptions == 0 || minIntervalMs < result.minIntervalMs) {
+      result.minIntervalMs = minIntervalMs;
+    }
+    if (result.subscriptions == 0 || maxIntervalMs < result.maxIntervalMs) {
+      result.maxIntervalMs = maxIntervalMs;
+    }
+    result.subscriptions++;
+  }
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+#endif
+  return result;
+}
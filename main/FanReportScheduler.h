@@ -0,0 +1,80 @@
+#ifndef FAN_REPORT_SCHEDULER_H
+#define FAN_REPORT_SCHEDULER_H
+
+#include <Arduino.h>
+#include <esp_matter.h>
+#include <atomic>
+
+// Subscriber reporting intervals that cover one cluster of an endpoint
+struct FanSubscriberIntervals {
+  uint8_t subscriptions = 0;      // Active subscriptions that include the cluster
+  uint32_t minIntervalMs = 0;     // Smallest MinIntervalFloor among them
+  uint32_t maxIntervalMs = 0;     // Smallest MaxInterval among them (0: no subscription)
+};
+
+// Per-endpoint report scheduler
+//
+// Attribute changes are stored right away but only marked dirty here. Dirty
+// attributes are reported together, in one batch, when the hardware has settled
+// on its actuation plan, or at the latest when the report window has expired
+// since the first pending change. A flush never happens before the smallest
+// subscriber min interval has elapsed since the previous one (those reports would
+// be held back by the subscriptions anyway), and never later than the smallest
+// subscriber max interval. Intermediate values - SpeedCurrent while a pulse train
+// runs, FanMode/Percent overwritten a moment later - never reach the radio.
+//
+// A window of 0 reports every change immediately (the default).
+class FanReportScheduler {
+public:
+  FanReportScheduler();
+
+  void begin(uint16_t endpointId, uint32_t clusterId);
+
+  // Longest time a change may wait for its report; 0 reports immediately
+  void setWindow(uint32_t windowMs);
+  uint32_t getWindow();
+
+  // Attribute ids 0..31 of the cluster; may be called from the Matter task
+  void markDirty(uint32_t attributeId);
+  bool isPending();
+
+  // False while the hardware is still moving towards its target
+  void setSettled(bool settled);
+
+  // Flushes when due; call from loop()
+  void loop(uint32_t nowMs);
+  // Report everything pending now
+  void flush(uint32_t nowMs);
+  // When loop() has to run next for the pending reports; false when nothing is pending
+  bool getNextFlushTime(uint32_t nowMs, uint32_t &timeMs);
+
+  uint32_t getFlushCount();
+  uint32_t getReportedCount();
+  uint32_t getCoalescedCount();
+
+protected:
+  uint16_t endpointId = 0;
+  uint32_t clusterId = 0;
+  // Set from loop(), read by markDirty() on the Matter task
+  std::atomic<uint32_t> windowMs{0};
+
+  std::atomic<uint32_t> dirtyMask{0};
+  std::atomic<uint32_t> markCount{0};
+  std::atomic<bool> settled{true};
+
+  bool pending = false;               // Dirty attributes seen by loop()
+  uint32_t pendingSinceMs = 0;
+  uint32_t lastFlushMs = 0;
+  bool flushedOnce = false;
+  FanSubscriberIntervals intervals;
+
+  // Statistics; reportedCount also grows in markDirty() when the window is 0
+  std::atomic<uint32_t> flushCount{0};
+  std::atomic<uint32_t> reportedCount{0};
+  std::atomic<uint32_t> coalescedCount{0};
+
+  void reportMask(uint32_t mask);
+  FanSubscriberIntervals readSubscriberIntervals();
+};
+
+#endif // FAN_REPORT_SCHEDULER_H
@@ -0,0 +1,158 @@
+#include "FanScenes.h"
+#include <app/clusters/scenes-server/scenes-server.h>
+
+using namespace esp_matter;
+using namespace esp_matter::cluster;
+using namespace chip::app::Clusters;
+
+using AttributeValuePair = ScenesManagement::Structs::AttributeValuePairStruct::Type;
+using AttributeValuePairDecodable = ScenesManagement::Structs::AttributeValuePairStruct::DecodableType;
+
+// PercentSetting, SpeedSetting, RockSetting
+static const uint8_t kFanSceneAttributeCount = 3;
+
+// ============================================================================
+// FanControl scene handler
+// ============================================================================
+
+void FanSceneHandler::GetSupportedClusters(chip::EndpointId endpoint, chip::Span<chip::ClusterId> &clusterBuffer) {
+  if (fan != nullptr && endpoint == fan->getEndPointId() && clusterBuffer.size() >= 1) {
+    clusterBuffer[0] = FanControl::Id;
+    clusterBuffer.reduce_size(1);
+  } else {
+    clusterBuffer.reduce_size(0);
+  }
+}
+
+bool FanSceneHandler::SupportsCluster(chip::EndpointId endpoint, chip::ClusterId cluster) {
+  return fan != nullptr && endpoint == fan->getEndPointId() && cluster == FanControl::Id;
+}
+
+CHIP_ERROR FanSceneHandler::SerializeSave(chip::EndpointId endpoint, chip::ClusterId cluster, chip::MutableByteSpan &serializedBytes) {
+  if (!SupportsCluster(endpoint, cluster)) {
+    return CHIP_ERROR_INVALID_ARGUMENT;
+  }
+
+  AttributeValuePair pairs[kFanSceneAttributeCount];
+  pairs[0].attributeID = FanControl::Attributes::PercentSetting::Id;
+  pairs[0].valueUnsigned8.SetValue(fan->speedToPercent(fan->getSpeed()));
+  pairs[1].attributeID = FanControl::Attributes::SpeedSetting::Id;
+  pairs[1].valueUnsigned8.SetValue(fan->getSpeed());
+  pairs[2].attributeID = FanControl::Attributes::RockSetting::Id;
+  pairs[2].valueUnsigned8.SetValue(fan->getRockSetting());
+
+  chip::app::DataModel::List<AttributeValuePair> attributeValueList(pairs);
+  return EncodeAttributeValueList(attributeValueList, serializedBytes);
+}
+
+CHIP_ERROR FanSceneHandler::ApplyScene(chip::EndpointId endpoint, chip::ClusterId cluster, const chip::ByteSpan &serializedBytes,
+                                       chip::scenes::TransitionTimeMs timeMs) {
+  if (!SupportsCluster(endpoint, cluster)) {
+    return CHIP_ERROR_INVALID_ARGUMENT;
+  }
+
+  chip::app::DataModel::DecodableList<AttributeValuePairDecodable> attributeValueList;
+  ReturnErrorOnFailure(DecodeAttributeValueList(serializedBytes, attributeValueList));
+
+  // Collect the whole scene first so speed and oscillation are actuated together
+  FanActuationPlan plan;
+  bool hasPercent = false;
+  uint8_t percent = 0;
+  auto pair = attributeValueList.begin();
+  while (pair.Next()) {
+    const AttributeValuePairDecodable &value = pair.GetValue();
+    if (!value.valueUnsigned8.HasValue()) {
+      continue;
+    }
+    switch (value.attributeID) {
+      case FanControl::Attributes::PercentSetting::Id:
+        hasPercent = true;
+        percent = value.valueUnsigned8.Value();
+        break;
+      case FanControl::Attributes::SpeedSetting::Id:
+        plan.hasSpeed = true;
+        plan.speed = value.valueUnsigned8.Value();
+        break;
+      case FanControl::Attributes::RockSetting::Id:
+        plan.hasRock = true;
+        plan.rockSetting = value.valueUnsigned8.Value();
+        break;
+      default:
+        break;
+    }
+  }
+  ReturnErrorOnFailure(pair.GetStatus());
+
+  // SpeedSetting wins; PercentSetting only matters for scenes written by a percent-only controller
+  if (!plan.hasSpeed && hasPercent) {
+    plan.hasSpeed = true;
+    plan.speed = fan->percentToSpeed(percent);
+  }
+
+  // The fan steps through its levels at a fixed pulse rate, so the transition time cannot be honored
+  log_i("Scene recall on endpoint %d: Speed=%d, Rock=0x%02X (transition %lums ignored)", endpoint,
+        plan.hasSpeed ? plan.speed : fan->getSpeed(), plan.hasRock ? plan.rockSetting : fan->getRockSetting(), (unsigned long)timeMs);
+
+  return fan->applyActuationPlan(plan) ? CHIP_NO_ERROR : CHIP_ERROR_INTERNAL;
+}
+
+// ============================================================================
+// FanScenes
+// ============================================================================
+
+FanScenes::FanScenes() {}
+
+bool FanScenes::begin(MatterMultiSpeedFan &fan, uint16_t sceneTableSize) {
+  if (started) {
+    log_e("Fan Scenes already initialized");
+    return false;
+  }
+
+  endpoint_t *endpoint = endpoint::get(node::get(), fan.getEndPointId());
+  if (endpoint == nullptr) {
+    log_e("Fan endpoint %d not found, call begin() on the fan first", fan.getEndPointId());
+    return false;
+  }
+
+  // Scenes Management requires Groups on the same endpoint
+  if (cluster::get(endpoint, Groups::Id) == nullptr) {
+    groups::config_t groupsConfig;
+    if (groups::create(endpoint, &groupsConfig, CLUSTER_FLAG_SERVER) == nullptr) {
+      log_e("Failed to create Groups cluster");
+      return false;
+    }
+  }
+
+  scenes_management::config_t scenesConfig;
+  scenesConfig.scene_table_size = sceneTableSize;
+  if (scenes_management::create(endpoint, &scenesConfig, CLUSTER_FLAG_SERVER) == nullptr) {
+    log_e("Failed to create Scenes Management cluster");
+    return false;
+  }
+
+  endpointId = fan.getEndPointId();
+  sceneHandler.setFan(&fan);
+
+  log_i("Fan Scenes initialized on endpoint %d (%d scenes)", endpointId, sceneTableSize);
+
+  started = true;
+  return true;
+}
+
+bool FanScenes::registerHandler() {
+  if (!started) {
+    log_w("Fan Scenes has not begun.");
+    return false;
+  }
+  if (registered) {
+    return true;
+  }
+
+  lock::chip_stack_lock(portMAX_DELAY);
+  ScenesManagement::ScenesServer::Instance().RegisterSceneHandler(endpointId, &sceneHandler);
+  lock::chip_stack_unlock();
+
+  registered = true;
+  log_i("FanControl scene handler registered on endpoint %d", endpointId);
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef FAN_SCENES_H
+#define FAN_SCENES_H
+
+#include <Matter.h>
+#include <app/clusters/scenes-server/SceneHandlerImpl.h>
+#include "MatterMultiSpeedFan.h"
+
+// Scene handler for the FanControl cluster
+// A scene stores PercentSetting, SpeedSetting and RockSetting; a recall is applied as one
+// FanActuationPlan instead of one attribute write per value
+class FanSceneHandler : public chip::scenes::DefaultSceneHandlerImpl {
+public:
+  void setFan(MatterMultiSpeedFan *fan) { this->fan = fan; }
+
+  void GetSupportedClusters(chip::EndpointId endpoint, chip::Span<chip::ClusterId> &clusterBuffer) override;
+  bool SupportsCluster(chip::EndpointId endpoint, chip::ClusterId cluster) override;
+  CHIP_ERROR SerializeSave(chip::EndpointId endpoint, chip::ClusterId cluster, chip::MutableByteSpan &serializedBytes) override;
+  CHIP_ERROR ApplyScene(chip::EndpointId endpoint, chip::ClusterId cluster, const chip::ByteSpan &serializedBytes,
+                        chip::scenes::TransitionTimeMs timeMs) override;
+
+protected:
+  MatterMultiSpeedFan *fan = nullptr;
+};
+
+// Adds Scenes Management (and the Groups cluster it depends on) to the fan endpoint
+class FanScenes {
+public:
+  FanScenes();
+
+  // Create the clusters on the fan endpoint - call before Matter.begin()
+  bool begin(MatterMultiSpeedFan &fan, uint16_t sceneTableSize = 16);
+
+  // Register the FanControl scene handler - call after Matter.begin(), once the scene table exists
+  bool registerHandler();
+
+protected:
+  bool started = false;
+  bool registered = false;
+  uint16_t endpointId = 0;
+  FanSceneHandler sceneHandler;
+};
+
+#endif // FAN_SCENES_H
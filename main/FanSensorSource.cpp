@@ -0,0 +1,111 @@
+#include "FanSensorSource.h"
+
+void FanSensorSource::setSampleInterval(uint32_t intervalMs) {
+  sampleIntervalMs = intervalMs;
+}
+
+bool FanSensorSource::loop(uint32_t nowMs) {
+  if (!converting) {
+    if (sampled && nowMs - lastSampleTime < sampleIntervalMs) {
+      return false;
+    }
+    sampled = true;
+    lastSampleTime = nowMs;
+    if (!startConversion()) {
+      errorCount++;
+      log_w("Temperature sensor: conversion not started");
+      return false;
+    }
+    converting = true;
+    conversionStartTime = nowMs;
+  }
+
+  if (nowMs - conversionStartTime < conversionTimeMs()) {
+    return false;
+  }
+  converting = false;
+
+  int16_t reading = 0;
+  if (!read(reading)) {
+    errorCount++;
+    log_w("Temperature sensor: no reading");
+    return false;
+  }
+  publish(reading);
+  return true;
+}
+
+uint32_t FanSensorSource::getNextSampleTime() {
+  if (converting) {
+    return conversionStartTime + conversionTimeMs();
+  }
+  return sampled ? lastSampleTime + sampleIntervalMs : 0;
+}
+
+void FanSensorSource::setBand(int16_t low, int16_t high) {
+  bandLow = low;
+  bandHigh = high;
+  // The last reading counts against the new band, so a band that already excludes it fires at once
+  outside = false;
+  crossing = false;
+  if (valid) {
+    compareWithBand();
+  }
+}
+
+bool FanSensorSource::takeCrossing() {
+  bool ret = crossing;
+  crossing = false;
+  return ret;
+}
+
+int16_t FanSensorSource::getTemperature() {
+  return temperature;
+}
+
+bool FanSensorSource::hasReading() {
+  return valid;
+}
+
+uint32_t FanSensorSource::getSampleCount() {
+  return sampleCount;
+}
+
+uint32_t FanSensorSource::getErrorCount() {
+  return errorCount;
+}
+
+void FanSensorSource::publish(int16_t temperature) {
+  this->temperature = temperature;
+  valid = true;
+  sampleCount++;
+  compareWithBand();
+}
+
+void FanSensorSource::compareWithBand() {
+  bool nowOutside = temperature < bandLow || temperature >= bandHigh;
+  if (nowOutside && !outside) {
+    crossing = true;
+    log_d("Temperature %d left the band [%d, %d) (0.01 C)", temperature, bandLow, bandHigh);
+  }
+  outside = nowOutside;
+}
+
+// ============================================================================
+// Simulated source
+// ============================================================================
+
+bool FanSimulatedSensor::begin() {
+  publish(simulatedTemperature);
+  return true;
+}
+
+void FanSimulatedSensor::setTemperature(int16_t temperature) {
+  simulatedTemperature = temperature;
+  publish(temperature);
+}
+
+bool FanSimulatedSensor::read(int16_t &temperature) {
+  temperature = simulatedTemperature;
+  return true;
+}
@@ -0,0 +1,83 @@
+#ifndef FAN_SENSOR_SOURCE_H
+#define FAN_SENSOR_SOURCE_H
+
+#include <Arduino.h>
+
+// Temperatures are fixed point in hundredths of a degree Celsius (2650 = 26.50 C)
+#define FAN_TEMPERATURE_MIN ((int16_t)-32768)
+#define FAN_TEMPERATURE_MAX ((int16_t)32767)
+
+// Room temperature source for Auto mode
+//
+// The source samples its sensor at a low rate and compares every reading with
+// the band set by the consumer. Only a reading that leaves the band raises a
+// crossing, so the Auto mode controller stays idle while the temperature is
+// where it expects it. Implementations only provide the sensor access:
+// startConversion() (optional, for sensors with a conversion time) and read().
+class FanSensorSource {
+public:
+  virtual ~FanSensorSource() {}
+
+  virtual bool begin() = 0;
+
+  // Time between two readings (default 10 s)
+  void setSampleInterval(uint32_t intervalMs);
+
+  // Take a reading when one is due; call from loop(). Returns true when a new reading arrived.
+  bool loop(uint32_t nowMs);
+  // When loop() has to run next (the next sample, or the end of a running conversion)
+  uint32_t getNextSampleTime();
+
+  // Temperatures in [low, high) are inside the band; FAN_TEMPERATURE_MIN/MAX leave a side open
+  void setBand(int16_t low, int16_t high);
+  // True once after a reading left the band
+  bool takeCrossing();
+
+  int16_t getTemperature();
+  bool hasReading();
+  uint32_t getSampleCount();
+  uint32_t getErrorCount();
+
+protected:
+  uint32_t sampleIntervalMs = 10000;
+  unsigned long lastSampleTime = 0;
+  bool sampled = false;
+  bool converting = false;
+  unsigned long conversionStartTime = 0;
+
+  int16_t temperature = 0;
+  bool valid = false;
+  int16_t bandLow = FAN_TEMPERATURE_MIN;
+  int16_t bandHigh = FAN_TEMPERATURE_MAX;
+  bool outside = false;
+  bool crossing = false;
+
+  uint32_t sampleCount = 0;
+  uint32_t errorCount = 0;
+
+  // Start one conversion; the reading is taken conversionTimeMs() later
+  virtual bool startConversion() { return true; }
+  virtual uint32_t conversionTimeMs() { return 0; }
+  // Latest converted temperature
+  virtual bool read(int16_t &temperature) = 0;
+
+  // Store a reading and compare it with the band
+  void publish(int16_t temperature);
+  void compareWithBand();
+};
+
+// Temperature set by software: host builds, tests, or a value pushed from elsewhere
+class FanSimulatedSensor : public FanSensorSource {
+public:
+  bool begin() override;
+
+  // Takes effect immediately, without waiting for the next sample
+  void setTemperature(int16_t temperature);
+
+protected:
+  int16_t simulatedTemperature = 2200;
+
+  bool read(int16_t &temperature) override;
+};
+
+#endif // FAN_SENSOR_SOURCE_H
@@ -0,0 +1,198 @@
+#include "FanTachometer.h"
+
+// PCNT counts up to this value and then wraps back to 0
+#define FAN_TACHOMETER_PCNT_HIGH_LIMIT 32767
+
+FanTachometer::FanTachometer() {}
+
+FanTachometer::~FanTachometer() {
+  end();
+}
+
+bool FanTachometer::begin(uint8_t pin, uint8_t pulsesPerRev, uint32_t windowMs) {
+  if (started) {
+    log_e("Fan Tachometer already initialized");
+    return false;
+  }
+  if (pulsesPerRev == 0 || windowMs == 0) {
+    log_e("Invalid tachometer configuration: pulsesPerRev=%d, windowMs=%lu", pulsesPerRev, windowMs);
+    return false;
+  }
+
+  this->pulsesPerRev = pulsesPerRev;
+  this->windowMs = windowMs;
+
+  // Tachometer outputs are open collector
+  pinMode(pin, INPUT_PULLUP);
+
+  pcnt_unit_config_t unitConfig = {};
+  unitConfig.low_limit = -1;
+  unitConfig.high_limit = FAN_TACHOMETER_PCNT_HIGH_LIMIT;
+  if (pcnt_new_unit(&unitConfig, &pcntUnit) != ESP_OK) {
+    log_e("Failed to create pulse counter unit");
+    return false;
+  }
+
+  // Reject ringing on the tachometer edge (a fan produces < 1 pulse per ms)
+  pcnt_glitch_filter_config_t filterConfig = {};
+  filterConfig.max_glitch_ns = 1000;
+  pcnt_unit_set_glitch_filter(pcntUnit, &filterConfig);
+
+  pcnt_chan_config_t channelConfig = {};
+  channelConfig.edge_gpio_num = pin;
+  channelConfig.level_gpio_num = -1;
+  if (pcnt_new_channel(pcntUnit, &channelConfig, &pcntChannel) != ESP_OK) {
+    log_e("Failed to create pulse counter channel");
+    pcnt_del_unit(pcntUnit);
+    pcntUnit = nullptr;
+    return false;
+  }
+
+  // Count falling edges only
+  pcnt_channel_set_edge_action(pcntChannel, PCNT_CHANNEL_EDGE_ACTION_HOLD, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+
+  pcnt_unit_enable(pcntUnit);
+  pcnt_unit_clear_count(pcntUnit);
+  pcnt_unit_start(pcntUnit);
+
+  lastCount = 0;
+  windowStartTime = millis();
+  log_i("Fan Tachometer initialized: pin=%d, pulsesPerRev=%d, window=%lums", pin, pulsesPerRev, windowMs);
+
+  started = true;
+  return true;
+}
+
+void FanTachometer::end() {
+  if (pcntUnit != nullptr) {
+    pcnt_unit_stop(pcntUnit);
+    pcnt_unit_disable(pcntUnit);
+    if (pcntChannel != nullptr) {
+      pcnt_del_channel(pcntChannel);
+      pcntChannel = nullptr;
+    }
+    pcnt_del_unit(pcntUnit);
+    pcntUnit = nullptr;
+  }
+  started = false;
+}
+
+void FanTachometer::setSpeedProfile(const uint16_t *levelRpm, uint8_t speedMax) {
+  if (speedMax >= sizeof(this->levelRpm) / sizeof(this->levelRpm[0])) {
+    log_w("Speed profile with %d levels is too long, truncating", speedMax);
+    speedMax = sizeof(this->levelRpm) / sizeof(this->levelRpm[0]) - 1;
+  }
+  this->speedMax = speedMax;
+  this->levelRpm[0] = 0;
+  for (uint8_t level = 1; level <= speedMax; level++) {
+    this->levelRpm[level] = levelRpm[level];
+  }
+}
+
+void FanTachometer::setStallDetection(uint16_t stallRpm, uint32_t stallTimeoutMs) {
+  this->stallRpm = stallRpm;
+  this->stallTimeoutMs = stallTimeoutMs;
+}
+
+void FanTachometer::setCommandedSpeed(uint8_t speed) {
+  if (commandedSpeed != speed) {
+    commandedSpeed = speed;
+    // Restart the stall timer so that spin-up is not reported as a stall
+    belowStall = false;
+  }
+}
+
+bool FanTachometer::update() {
+  if (!started) {
+    return false;
+  }
+
+  unsigned long now = millis();
+  if (now - windowStartTime < windowMs) {
+    return false;
+  }
+  windowStartTime = now;
+
+  int count = 0;
+  if (pcnt_unit_get_count(pcntUnit, &count) != ESP_OK) {
+    return false;
+  }
+  int delta = count - lastCount;
+  if (delta < 0) {
+    delta += FAN_TACHOMETER_PCNT_HIGH_LIMIT;
+  }
+  lastCount = count;
+
+  // Moving sum over the last FAN_TACHOMETER_WINDOWS windows
+  windowSum -= windowCounts[windowIndex];
+  windowCounts[windowIndex] = (uint16_t)delta;
+  windowSum += (uint16_t)delta;
+  windowIndex = (windowIndex + 1) % FAN_TACHOMETER_WINDOWS;
+  if (windowsFilled < FAN_TACHOMETER_WINDOWS) {
+    windowsFilled++;
+  }
+
+  rpm = (windowSum * 60000UL) / ((uint32_t)pulsesPerRev * windowMs * windowsFilled);
+
+  checkStall(now);
+  return true;
+}
+
+void FanTachometer::checkStall(unsigned long now) {
+  if (stallTimeoutMs == 0) {
+    return;
+  }
+
+  bool stalledNow = false;
+  if (commandedSpeed != 0 && rpm < stallRpm) {
+    if (!belowStall) {
+      belowStall = true;
+      belowStallSince = now;
+    }
+    stalledNow = (now - belowStallSince) >= stallTimeoutMs;
+  } else {
+    belowStall = false;
+  }
+
+  if (stalledNow != stalled) {
+    stalled = stalledNow;
+    log_w("Fan %s (commanded speed %d, %lu RPM)", stalled ? "stalled" : "recovered from stall", commandedSpeed, rpm);
+    if (_onStallChangeCB != nullptr) {
+      _onStallChangeCB(stalled, rpm);
+    }
+  }
+}
+
+uint32_t FanTachometer::getRpm() {
+  return rpm;
+}
+
+uint8_t FanTachometer::getMeasuredSpeed() {
+  if (speedMax == 0) {
+    return 0;
+  }
+  // Nearest nominal level, split at the midpoint between adjacent levels
+  for (uint8_t level = 0; level < speedMax; level++) {
+    uint32_t midpoint = ((uint32_t)levelRpm[level] + levelRpm[level + 1]) / 2;
+    if (rpm < midpoint) {
+      return level;
+    }
+  }
+  return speedMax;
+}
+
+uint8_t FanTachometer::getMeasuredPercent() {
+  if (speedMax == 0 || levelRpm[speedMax] == 0) {
+    return 0;
+  }
+  uint32_t percent = (rpm * 100UL) / levelRpm[speedMax];
+  return percent > 100 ? 100 : (uint8_t)percent;
+}
+
+bool FanTachometer::isStalled() {
+  return stalled;
+}
+
+void FanTachometer::onStallChange(StallChangeCallback cb) {
+  _onStallChangeCB = cb;
+}
@@ -0,0 +1,84 @@
+#ifndef FAN_TACHOMETER_H
+#define FAN_TACHOMETER_H
+
+#include <Arduino.h>
+#include <driver/pulse_cnt.h>
+
+// Number of sampling windows averaged by the RPM estimator
+#define FAN_TACHOMETER_WINDOWS 4
+
+// Callback types
+typedef std::function<void(bool stalled, uint32_t rpm)> StallChangeCallback;
+
+// Fan tachometer using the hardware pulse counter (PCNT).
+// The counter runs freely in hardware; update() only reads it once per sampling
+// window, so the CPU cost is a register read every windowMs regardless of RPM.
+class FanTachometer {
+public:
+  FanTachometer();
+  ~FanTachometer();
+
+  // Initialize the pulse counter on the tachometer pin
+  // pin: GPIO connected to the (open collector) tachometer output
+  // pulsesPerRev: tachometer pulses per motor revolution (2 for most fans)
+  // windowMs: length of one sampling window
+  bool begin(uint8_t pin, uint8_t pulsesPerRev = 2, uint32_t windowMs = 250);
+
+  // Cleanup
+  void end();
+
+  // Nominal RPM for each speed level (index 1..speedMax), used to map the
+  // measured RPM back to SpeedCurrent / PercentCurrent
+  void setSpeedProfile(const uint16_t *levelRpm, uint8_t speedMax);
+
+  // Stall detection: the fan is stalled when a nonzero speed is commanded but the
+  // RPM stays below stallRpm for longer than stallTimeoutMs (spin-up included)
+  void setStallDetection(uint16_t stallRpm, uint32_t stallTimeoutMs);
+  void setCommandedSpeed(uint8_t speed);
+
+  // Samples the counter when a window has elapsed.
+  // Returns true when a new RPM estimate is available.
+  bool update();
+
+  // Measurement results
+  uint32_t getRpm();
+  uint8_t getMeasuredSpeed();
+  uint8_t getMeasuredPercent();
+  bool isStalled();
+
+  // Callbacks
+  void onStallChange(StallChangeCallback cb);
+
+protected:
+  bool started = false;
+  pcnt_unit_handle_t pcntUnit = nullptr;
+  pcnt_channel_handle_t pcntChannel = nullptr;
+
+  uint8_t pulsesPerRev = 2;
+  uint32_t windowMs = 250;
+  unsigned long windowStartTime = 0;
+  int lastCount = 0;
+
+  // Ring buffer of pulse counts for the last FAN_TACHOMETER_WINDOWS windows
+  uint16_t windowCounts[FAN_TACHOMETER_WINDOWS] = {0};
+  uint32_t windowSum = 0;
+  uint8_t windowIndex = 0;
+  uint8_t windowsFilled = 0;
+  uint32_t rpm = 0;
+
+  uint16_t levelRpm[8] = {0};
+  uint8_t speedMax = 0;
+
+  uint16_t stallRpm = 0;
+  uint32_t stallTimeoutMs = 0;
+  uint8_t commandedSpeed = 0;
+  unsigned long belowStallSince = 0;
+  bool belowStall = false;
+  bool stalled = false;
+
+  StallChangeCallback _onStallChangeCB = nullptr;
+
+  void checkStall(unsigned long now);
+};
+
+#endif // FAN_TACHOMETER_H
@@ -0,0 +1,91 @@
+#include "FanTemperatureSensors.h"
+
+// ADC readings averaged per sample
+static const uint8_t kAdcOversampling = 8;
+
+// TMP102 registers and configuration bits (datasheet SBOS397)
+static const uint8_t kTmp102TemperatureRegister = 0x00;
+static const uint8_t kTmp102ConfigRegister = 0x01;
+static const uint8_t kTmp102ConfigShutdown = 0x61;     // R1|R0 (12 bit, read-only) | SD
+static const uint8_t kTmp102ConfigOneShot = 0x80;      // OS: start one conversion while shut down
+static const uint8_t kTmp102ConfigDefaultLsb = 0xA0;   // CR = 4 Hz, AL
+static const uint32_t kTmp102ConversionMs = 30;        // 26 ms typical
+
+// ============================================================================
+// ADC sensor
+// ============================================================================
+
+FanAdcSensor::FanAdcSensor(uint8_t pin, int16_t zeroMilliVolts, uint16_t microVoltsPerCentiDegree)
+  : pin(pin), zeroMilliVolts(zeroMilliVolts), microVoltsPerCentiDegree(microVoltsPerCentiDegree) {}
+
+bool FanAdcSensor::begin() {
+  if (microVoltsPerCentiDegree == 0) {
+    log_e("ADC temperature sensor: invalid scale");
+    return false;
+  }
+  pinMode(pin, INPUT);
+  analogSetPinAttenuation(pin, ADC_11db);
+  log_i("ADC temperature sensor on GPIO %d", pin);
+  return true;
+}
+
+bool FanAdcSensor::read(int16_t &temperature) {
+  uint32_t milliVolts = 0;
+  for (uint8_t i = 0; i < kAdcOversampling; i++) {
+    milliVolts += analogReadMilliVolts(pin);
+  }
+  milliVolts /= kAdcOversampling;
+
+  int32_t centiDegrees = ((int32_t)milliVolts - zeroMilliVolts) * 1000 / microVoltsPerCentiDegree;
+  if (centiDegrees < FAN_TEMPERATURE_MIN || centiDegrees > FAN_TEMPERATURE_MAX) {
+    return false;
+  }
+  temperature = (int16_t)centiDegrees;
+  return true;
+}
+
+// ============================================================================
+// TMP102 sensor
+// ============================================================================
+
+FanTmp102Sensor::FanTmp102Sensor(TwoWire &wire, uint8_t address) : wire(wire), address(address) {}
+
+bool FanTmp102Sensor::begin() {
+  if (!writeConfig(kTmp102ConfigShutdown, kTmp102ConfigDefaultLsb)) {
+    log_e("TMP102 not found at 0x%02X", address);
+    return false;
+  }
+  log_i("TMP102 temperature sensor at 0x%02X (one-shot)", address);
+  return true;
+}
+
+bool FanTmp102Sensor::writeConfig(uint8_t msb, uint8_t lsb) {
+  wire.beginTransmission(address);
+  wire.write(kTmp102ConfigRegister);
+  wire.write(msb);
+  wire.write(lsb);
+  return wire.endTransmission() == 0;
+}
+
+bool FanTmp102Sensor::startConversion() {
+  return writeConfig(kTmp102ConfigShutdown | kTmp102ConfigOneShot, kTmp102ConfigDefaultLsb);
+}
+
+uint32_t FanTmp102Sensor::conversionTimeMs() {
+  return kTmp102ConversionMs;
+}
+
+bool FanTmp102Sensor::read(int16_t &temperature) {
+  wire.beginTransmission(address);
+  wire.write(kTmp102TemperatureRegister);
+  if (wire.endTransmission(false) != 0 || wire.requestFrom(address, (uint8_t)2) != 2) {
+    return false;
+  }
+  uint8_t msb = wire.read();
+  uint8_t lsb = wire.read();
+
+  // 12-bit two's complement, left aligned, 0.0625 C per LSB
+  int16_t raw = (int16_t)((msb << 8) | lsb) >> 4;
+  temperature = (int16_t)((int32_t)raw * 625 / 100);
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef FAN_TEMPERATURE_SENSORS_H
+#define FAN_TEMPERATURE_SENSORS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "FanSensorSource.h"
+
+// Analog temperature sensor (TMP36, LM35, ...) on an ADC pin
+// temperature (0.01 C) = (millivolts - zeroMilliVolts) * 1000 / microVoltsPerCentiDegree
+// Defaults are for a TMP36: 500 mV at 0 C, 10 mV per degree.
+class FanAdcSensor : public FanSensorSource {
+public:
+  FanAdcSensor(uint8_t pin, int16_t zeroMilliVolts = 500, uint16_t microVoltsPerCentiDegree = 100);
+
+  bool begin() override;
+
+protected:
+  uint8_t pin;
+  int16_t zeroMilliVolts;
+  uint16_t microVoltsPerCentiDegree;
+
+  bool read(int16_t &temperature) override;
+};
+
+// TMP102 on I2C, kept in shutdown mode between one-shot conversions
+// (about 1 uA instead of 10 uA; one conversion takes 26 ms)
+class FanTmp102Sensor : public FanSensorSource {
+public:
+  explicit FanTmp102Sensor(TwoWire &wire = Wire, uint8_t address = 0x48);
+
+  // The bus must already be started (Wire.begin(sda, scl))
+  bool begin() override;
+
+protected:
+  TwoWire &wire;
+  uint8_t address;
+
+  bool writeConfig(uint8_t msb, uint8_t lsb);
+  bool startConversion() override;
+  uint32_t conversionTimeMs() override;
+  bool read(int16_t &temperature) override;
+};
+
+#endif // FAN_TEMPERATURE_SENSORS_H
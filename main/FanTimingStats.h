@@ -0,0 +1,33 @@
+#ifndef FAN_TIMING_STATS_H
+#define FAN_TIMING_STATS_H
+
+#include <Arduino.h>
+
+// Minimum, mean and maximum of repeated duration measurements, in microseconds
+struct FanTimingStats {
+  uint32_t count = 0;
+  uint32_t minUs = 0;
+  uint32_t maxUs = 0;
+  uint64_t totalUs = 0;
+
+  void add(uint32_t us) {
+    if (count == 0 || us < minUs) {
+      minUs = us;
+    }
+    if (us > maxUs) {
+      maxUs = us;
+    }
+    totalUs += us;
+    count++;
+  }
+
+  uint32_t meanUs() const {
+    return count > 0 ? (uint32_t)(totalUs / count) : 0;
+  }
+
+  void reset() {
+    *this = FanTimingStats();
+  }
+};
+
+#endif // FAN_TIMING_STATS_H
@@ -0,0 +1,746 @@
+#include "FanUsageHistory.h"
+#include <SPIFFS.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <app/AttributeAccessInterfaceRegistry.h>
+#include <app/reporting/reporting.h>
+
+using namespace esp_matter;
+using namespace esp_matter::cluster;
+
+static const uint32_t kStateMagic = 0x46555331;  // "FUS1"
+static const uint8_t kLogMagic[4] = {'F', 'U', 'L', '1'};
+static const uint8_t kHourlyMagic[4] = {'F', 'U', 'H', '1'};
+static const uint8_t kDailyMagic[4] = {'F', 'U', 'D', '1'};
+
+static const char *kStatePath = "/usage/state.bin";
+static const char *kLogPath = "/usage/log.bin";
+static const char *kLogOldPath = "/usage/log.old";
+static const char *kHourlyPath = "/usage/hourly.bin";
+static const char *kHourlyOldPath = "/usage/hourly.old";
+static const char *kDailyPath = "/usage/daily.bin";
+static const char *kDailyOldPath = "/usage/daily.old";
+
+static const uint64_t kHourMs = 3600000ULL;
+static const uint8_t kHoursPerDay = 24;
+static const uint8_t kStateRockingBit = 0x08;
+static const size_t kMaxRecordBytes = 16;
+
+// ============================================================================
+// Varint encoding (LEB128, 7 bits per byte)
+// ============================================================================
+
+static size_t putVarint(uint8_t *buffer, uint64_t value) {
+  size_t length = 0;
+  do {
+    uint8_t b = value & 0x7F;
+    value >>= 7;
+    buffer[length++] = value != 0 ? (b | 0x80) : b;
+  } while (value != 0);
+  return length;
+}
+
+// Reads bytes from a file followed by an optional memory buffer
+class UsageByteSource {
+public:
+  UsageByteSource(File *file, const uint8_t *memory = nullptr, size_t memoryLength = 0)
+    : file(file), memory(memory), memoryLength(memoryLength) {}
+
+  bool next(uint8_t &b) {
+    if (file != nullptr) {
+      if (pos == length) {
+        length = file->read(buffer, sizeof(buffer));
+        pos = 0;
+      }
+      if (pos < length) {
+        b = buffer[pos++];
+        return true;
+      }
+      file = nullptr;
+    }
+    if (memoryPos < memoryLength) {
+      b = memory[memoryPos++];
+      return true;
+    }
+    return false;
+  }
+
+  bool varint(uint64_t &value) {
+    value = 0;
+    uint8_t b = 0;
+    for (uint8_t shift = 0; shift < 64; shift += 7) {
+      if (!next(b)) {
+        return false;
+      }
+      value |= (uint64_t)(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool magic(const uint8_t *expected) {
+    uint8_t b = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+      if (!next(b) || b != expected[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+protected:
+  File *file;
+  uint8_t buffer[64];
+  size_t length = 0;
+  size_t pos = 0;
+  const uint8_t *memory;
+  size_t memoryLength;
+  size_t memoryPos = 0;
+};
+
+// Transition log: header {magic, varint(first sequence), varint(base ms)}, then per transition
+// varint(ms since the previous one) and varint(speed | rocking bit)
+static size_t putTransition(uint8_t *buffer, uint64_t deltaMs, uint8_t speed, bool rocking) {
+  size_t length = putVarint(buffer, deltaMs);
+  length += putVarint(buffer + length, speed | (rocking ? kStateRockingBit : 0));
+  return length;
+}
+
+// Collect transitions from one segment; sequence and time continue from the segment header
+static void scanTransitions(UsageByteSource &source, uint32_t sequence, uint64_t timeMs, uint32_t from,
+                            FanUsageTransition *out, size_t max, size_t &count) {
+  uint64_t delta = 0;
+  uint64_t stateValue = 0;
+  while (count < max && source.varint(delta) && source.varint(stateValue)) {
+    timeMs += delta;
+    if (sequence >= from) {
+      out[count].sequence = sequence;
+      out[count].operatingMs = timeMs;
+      out[count].speed = stateValue & (kStateRockingBit - 1);
+      out[count].rocking = (stateValue & kStateRockingBit) != 0;
+      count++;
+    }
+    sequence++;
+  }
+}
+
+// Bucket files: header {magic, levels, varint(first index)}, then per bucket varint seconds for
+// each level, varint(rocking seconds) and varint(transitions). Indexes are consecutive.
+static size_t putBucket(uint8_t *buffer, const FanUsageBucket &bucket, uint8_t levels) {
+  size_t length = 0;
+  for (uint8_t i = 0; i < levels; i++) {
+    length += putVarint(buffer + length, bucket.secondsAtSpeed[i]);
+  }
+  length += putVarint(buffer + length, bucket.rockingSeconds);
+  length += putVarint(buffer + length, bucket.transitions);
+  return length;
+}
+
+static void scanBuckets(UsageByteSource &source, const uint8_t *magic, uint32_t from,
+                        FanUsageBucket *out, size_t max, size_t &count) {
+  uint8_t levels = 0;
+  uint64_t index = 0;
+  if (!source.magic(magic) || !source.next(levels) || levels > FAN_USAGE_MAX_LEVELS || !source.varint(index)) {
+    return;
+  }
+  while (count < max) {
+    FanUsageBucket bucket = {};
+    uint64_t value = 0;
+    bool ok = true;
+    for (uint8_t i = 0; i < levels && ok; i++) {
+      ok = source.varint(value);
+      bucket.secondsAtSpeed[i] = (uint32_t)value;
+    }
+    ok = ok && source.varint(value);
+    bucket.rockingSeconds = (uint32_t)value;
+    ok = ok && source.varint(value);
+    bucket.transitions = (uint32_t)value;
+    if (!ok) {
+      return;
+    }
+    bucket.index = (uint32_t)index++;
+    if (bucket.index >= from) {
+      out[count++] = bucket;
+    }
+  }
+}
+
+// Append to a segment, rotating it into the ".old" generation when it would outgrow maxBytes
+static bool appendSegment(const char *path, const char *oldPath, size_t maxBytes,
+                          const uint8_t *header, size_t headerLength, const uint8_t *data, size_t length) {
+  if (SPIFFS.exists(path)) {
+    File current = SPIFFS.open(path, FILE_READ);
+    size_t size = current ? current.size() : 0;
+    current.close();
+    if (size + length > maxBytes) {
+      SPIFFS.remove(oldPath);
+      SPIFFS.rename(path, oldPath);
+    }
+  }
+  bool newSegment = !SPIFFS.exists(path);
+  File file = SPIFFS.open(path, FILE_APPEND);
+  if (!file) {
+    log_e("Failed to open %s", path);
+    return false;
+  }
+  bool ok = true;
+  if (newSegment) {
+    ok = file.write(header, headerLength) == headerLength;
+  }
+  ok = ok && file.write(data, length) == length;
+  file.close();
+  return ok;
+}
+
+// ============================================================================
+// Usage cluster attribute access
+// ============================================================================
+
+CHIP_ERROR FanUsageAttributeAccess::Read(const chip::app::ConcreteReadAttributePath &aPath, chip::app::AttributeValueEncoder &aEncoder) {
+  switch (aPath.mAttributeId) {
+    case FAN_USAGE_ATTR_OPERATING_SECONDS:
+      return aEncoder.Encode(history.getOperatingSeconds());
+    case FAN_USAGE_ATTR_SECONDS_AT_SPEED:
+      return aEncoder.EncodeList([this](const auto &encoder) -> CHIP_ERROR {
+        for (uint8_t i = 0; i < history.getLevelCount(); i++) {
+          ReturnErrorOnFailure(encoder.Encode(history.getSecondsAtSpeed(i)));
+        }
+        return CHIP_NO_ERROR;
+      });
+    case FAN_USAGE_ATTR_ROCKING_SECONDS:
+      return aEncoder.Encode(history.getRockingSeconds());
+    case FAN_USAGE_ATTR_TRANSITIONS:
+      return aEncoder.Encode(history.getTransitions());
+    case FAN_USAGE_ATTR_HISTORY_CURSOR:
+      return aEncoder.Encode(cursorFor(aEncoder.AccessingFabricIndex()));
+    case FAN_USAGE_ATTR_HISTORY_CHUNK: {
+      uint32_t cursor = cursorFor(aEncoder.AccessingFabricIndex());
+      uint8_t buffer[FAN_USAGE_CHUNK_MAX_BYTES];
+      size_t length = 0;
+      if (!history.readEncoded((FanUsageKind)(cursor >> 30), cursor & 0x3FFFFFFF, buffer, sizeof(buffer), length,
+                               pdMS_TO_TICKS(FAN_USAGE_CHUNK_WAIT_MS))) {
+        // The writer is on flash: the controller retries instead of the CHIP task blocking
+        return CHIP_IM_GLOBAL_STATUS(Busy);
+      }
+      return aEncoder.Encode(chip::ByteSpan(buffer, length));
+    }
+    default:
+      // Global attributes come from the attribute store
+      return CHIP_NO_ERROR;
+  }
+}
+
+CHIP_ERROR FanUsageAttributeAccess::Write(const chip::app::ConcreteDataAttributePath &aPath, chip::app::AttributeValueDecoder &aDecoder) {
+  if (aPath.mAttributeId != FAN_USAGE_ATTR_HISTORY_CURSOR) {
+    return CHIP_IM_GLOBAL_STATUS(UnsupportedWrite);
+  }
+  uint32_t value = 0;
+  ReturnErrorOnFailure(aDecoder.Decode(value));
+  if ((value >> 30) > FAN_USAGE_DAILY) {
+    return CHIP_IM_GLOBAL_STATUS(ConstraintError);
+  }
+  cursorFor(aDecoder.AccessingFabricIndex()) = value;
+  MatterReportingAttributeChangeCallback(aPath.mEndpointId, aPath.mClusterId, FAN_USAGE_ATTR_HISTORY_CURSOR);
+  MatterReportingAttributeChangeCallback(aPath.mEndpointId, aPath.mClusterId, FAN_USAGE_ATTR_HISTORY_CHUNK);
+  return CHIP_NO_ERROR;
+}
+
+uint32_t &FanUsageAttributeAccess::cursorFor(chip::FabricIndex fabricIndex) {
+  return cursors[fabricIndex <= CHIP_CONFIG_MAX_FABRICS ? fabricIndex : 0];
+}
+
+// ============================================================================
+// FanUsageHistory
+// ============================================================================
+
+FanUsageHistory::FanUsageHistory() {}
+
+bool FanUsageHistory::begin(uint8_t speedMax, const char *partitionLabel) {
+  if (started) {
+    log_e("Fan Usage History already initialized");
+    return false;
+  }
+
+  levels = speedMax + 1 < FAN_USAGE_MAX_LEVELS ? speedMax + 1 : FAN_USAGE_MAX_LEVELS;
+
+  if (!SPIFFS.begin(true, "/spiffs", 4, partitionLabel)) {
+    log_e("Failed to mount the %s partition", partitionLabel);
+    return false;
+  }
+
+  loadState();
+  bootOperatingMs = state.operatingMs;
+  publishTotals();
+  lastRecordedSpeed = state.speed;
+  lastRecordedRocking = state.rocking;
+
+  lock = xSemaphoreCreateMutex();
+  queue = xQueueCreate(32, sizeof(Event));
+  if (lock == NULL || queue == NULL ||
+      xTaskCreate(taskMain, "fan-usage", 4096, this, 1, &task) != pdPASS) {
+    log_e("Failed to start the usage history task");
+    return false;
+  }
+
+  log_i("Fan Usage History initialized: %lu h operating, %lu transitions, %u bytes used",
+        (unsigned long)(state.operatingMs / kHourMs), (unsigned long)state.transitions, SPIFFS.usedBytes());
+
+  started = true;
+  return true;
+}
+
+bool FanUsageHistory::addCluster(MatterEndPoint &fan) {
+  endpoint_t *endpoint = endpoint::get(node::get(), fan.getEndPointId());
+  if (endpoint == nullptr) {
+    log_e("Fan endpoint %d not found, call begin() on the fan first", fan.getEndPointId());
+    return false;
+  }
+
+  cluster_t *cluster = cluster::create(endpoint, FAN_USAGE_CLUSTER_ID, CLUSTER_FLAG_SERVER);
+  if (cluster == nullptr) {
+    log_e("Failed to create the usage cluster");
+    return false;
+  }
+  global::attribute::create_cluster_revision(cluster, 1);
+  global::attribute::create_feature_map(cluster, 0);
+
+  // Values are served by FanUsageAttributeAccess; the store only declares the attributes
+  attribute::create(cluster, FAN_USAGE_ATTR_OPERATING_SECONDS, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+  attribute::create(cluster, FAN_USAGE_ATTR_SECONDS_AT_SPEED, ATTRIBUTE_FLAG_NONE, esp_matter_array(NULL, 0, 0));
+  attribute::create(cluster, FAN_USAGE_ATTR_ROCKING_SECONDS, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+  attribute::create(cluster, FAN_USAGE_ATTR_TRANSITIONS, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+  attribute::create(cluster, FAN_USAGE_ATTR_HISTORY_CURSOR, ATTRIBUTE_FLAG_WRITABLE, esp_matter_uint32(0));
+  attribute::create(cluster, FAN_USAGE_ATTR_HISTORY_CHUNK, ATTRIBUTE_FLAG_NONE, esp_matter_octet_str(NULL, 0));
+
+  attributeAccess = new FanUsageAttributeAccess(fan.getEndPointId(), *this);
+  if (!chip::app::AttributeAccessInterfaceRegistry::Instance().Register(attributeAccess)) {
+    log_e("Failed to register the usage cluster attribute access");
+    return false;
+  }
+
+  log_i("Usage cluster 0x%08X added on endpoint %d", FAN_USAGE_CLUSTER_ID, fan.getEndPointId());
+  return true;
+}
+
+void FanUsageHistory::record(uint8_t speed, bool rocking) {
+  if (!started || (speed == lastRecordedSpeed && rocking == lastRecordedRocking)) {
+    return;
+  }
+  Event event = {(uint64_t)(esp_timer_get_time() / 1000), speed, rocking, false};
+  if (xQueueSend(queue, &event, 0) == pdTRUE) {
+    lastRecordedSpeed = speed;
+    lastRecordedRocking = rocking;
+  } else {
+    droppedEvents++;  // Retried on the next call, the queue is only full if flash stalls
+  }
+}
+
+void FanUsageHistory::flush() {
+  if (!started) {
+    return;
+  }
+  Event event = {(uint64_t)(esp_timer_get_time() / 1000), 0, false, true};
+  xQueueSend(queue, &event, 0);
+}
+
+void FanUsageHistory::setFlushInterval(uint32_t intervalMs) {
+  flushIntervalMs = intervalMs;
+}
+
+uint64_t FanUsageHistory::operatingNow() {
+  return bootOperatingMs + (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t FanUsageHistory::msUntilHourEnd() {
+  uint64_t hourEnd = (uint64_t)(state.hourIndex + 1) * kHourMs;
+  uint64_t now = operatingNow();
+  return hourEnd > now ? (uint32_t)(hourEnd - now) + 1 : 1;
+}
+
+// Totals come from the snapshot the writer task publishes, so the CHIP task never waits for the
+// history lock while the writer is on flash; time since the snapshot is added at the current state
+void FanUsageHistory::publishTotals() {
+  portENTER_CRITICAL(&totalsMux);
+  totals.operatingMs = state.operatingMs;
+  totals.speed = state.speed;
+  totals.rocking = state.rocking;
+  memcpy(totals.msAtSpeed, state.msAtSpeed, sizeof(totals.msAtSpeed));
+  totals.rockingMs = state.rockingMs;
+  totals.transitions = state.transitions;
+  portEXIT_CRITICAL(&totalsMux);
+}
+
+FanUsageHistory::Totals FanUsageHistory::readTotals() {
+  portENTER_CRITICAL(&totalsMux);
+  Totals snapshot = totals;
+  portEXIT_CRITICAL(&totalsMux);
+  return snapshot;
+}
+
+uint32_t FanUsageHistory::getOperatingSeconds() {
+  if (!started) {
+    return 0;
+  }
+  return (uint32_t)(operatingNow() / 1000);
+}
+
+uint32_t FanUsageHistory::getSecondsAtSpeed(uint8_t speed) {
+  if (!started || speed >= levels) {
+    return 0;
+  }
+  Totals snapshot = readTotals();
+  uint64_t ms = snapshot.msAtSpeed[speed];
+  if (speed == snapshot.speed) {
+    ms += operatingNow() - snapshot.operatingMs;
+  }
+  return (uint32_t)(ms / 1000);
+}
+
+uint32_t FanUsageHistory::getRockingSeconds() {
+  if (!started) {
+    return 0;
+  }
+  Totals snapshot = readTotals();
+  uint64_t ms = snapshot.rockingMs;
+  if (snapshot.rocking) {
+    ms += operatingNow() - snapshot.operatingMs;
+  }
+  return (uint32_t)(ms / 1000);
+}
+
+uint32_t FanUsageHistory::getTransitions() {
+  if (!started) {
+    return 0;
+  }
+  return readTotals().transitions;
+}
+
+uint32_t FanUsageHistory::getDroppedEvents() {
+  return droppedEvents;
+}
+
+uint8_t FanUsageHistory::getLevelCount() {
+  return levels;
+}
+
+// ============================================================================
+// Writer task
+// ============================================================================
+
+void FanUsageHistory::taskMain(void *arg) {
+  FanUsageHistory *history = (FanUsageHistory *)arg;
+  Event event;
+  unsigned long lastFlushTime = millis();
+
+  for (;;) {
+    // Sleep until an event, the next flush or the end of the current hour
+    uint32_t waitMs = history->msUntilHourEnd();
+    uint32_t sinceFlush = millis() - lastFlushTime;
+    uint32_t untilFlush = sinceFlush < history->flushIntervalMs ? history->flushIntervalMs - sinceFlush : 0;
+    if (untilFlush < waitMs) {
+      waitMs = untilFlush;
+    }
+
+    bool received = xQueueReceive(history->queue, &event, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+
+    xSemaphoreTake(history->lock, portMAX_DELAY);
+    if (received) {
+      history->process(event);
+    } else {
+      history->accumulate((uint64_t)(esp_timer_get_time() / 1000));
+    }
+    if ((received && event.flush) || millis() - lastFlushTime >= history->flushIntervalMs) {
+      history->flushLocked();
+      lastFlushTime = millis();
+    }
+    history->publishTotals();
+    xSemaphoreGive(history->lock);
+  }
+}
+
+void FanUsageHistory::process(const Event &event) {
+  accumulate(event.timestampMs);
+  if (event.flush) {
+    return;
+  }
+
+  uint8_t speed = event.speed < levels ? event.speed : levels - 1;
+  if (speed == state.speed && event.rocking == state.rocking) {
+    return;
+  }
+
+  if (logBufferLength > sizeof(logBuffer) - kMaxRecordBytes) {
+    flushLocked();
+  }
+  if (logBufferLength == 0) {
+    logBufferFirstSequence = state.sequence;
+    logBufferBaseMs = state.lastLogMs;
+  }
+  logBufferLength += putTransition(logBuffer + logBufferLength, state.operatingMs - state.lastLogMs, speed, event.rocking);
+
+  state.speed = speed;
+  state.rocking = event.rocking;
+  state.lastLogMs = state.operatingMs;
+  state.sequence++;
+  state.transitions++;
+  state.hourTransitions++;
+}
+
+void FanUsageHistory::accumulate(uint64_t uptimeMs) {
+  uint64_t now = bootOperatingMs + uptimeMs;
+  while (state.operatingMs < now) {
+    // Split the interval at hour boundaries so every bucket gets its own share
+    uint64_t hourEnd = (uint64_t)(state.hourIndex + 1) * kHourMs;
+    uint64_t until = now < hourEnd ? now : hourEnd;
+    uint32_t elapsed = (uint32_t)(until - state.operatingMs);
+
+    state.msAtSpeed[state.speed] += elapsed;
+    state.hourMsAtSpeed[state.speed] += elapsed;
+    if (state.rocking) {
+      state.rockingMs += elapsed;
+      state.hourRockingMs += elapsed;
+    }
+    state.operatingMs = until;
+
+    if (until == hourEnd) {
+      closeHour();
+    }
+  }
+}
+
+void FanUsageHistory::closeHour() {
+  FanUsageBucket hour = {};
+  hour.index = state.hourIndex;
+  for (uint8_t i = 0; i < levels; i++) {
+    hour.secondsAtSpeed[i] = state.hourMsAtSpeed[i] / 1000;
+    state.day.secondsAtSpeed[i] += hour.secondsAtSpeed[i];
+  }
+  hour.rockingSeconds = state.hourRockingMs / 1000;
+  hour.transitions = state.hourTransitions;
+  state.day.rockingSeconds += hour.rockingSeconds;
+  state.day.transitions += hour.transitions;
+  writeBucket(FAN_USAGE_HOURLY, hour);
+
+  memset(state.hourMsAtSpeed, 0, sizeof(state.hourMsAtSpeed));
+  state.hourRockingMs = 0;
+  state.hourTransitions = 0;
+  state.hourIndex++;
+
+  if (state.hourIndex % kHoursPerDay == 0) {
+    closeDay();
+  }
+}
+
+void FanUsageHistory::closeDay() {
+  writeBucket(FAN_USAGE_DAILY, state.day);
+  memset(&state.day, 0, sizeof(state.day));
+  state.day.index = state.hourIndex / kHoursPerDay;
+}
+
+void FanUsageHistory::writeBucket(FanUsageKind kind, const FanUsageBucket &bucket) {
+  uint8_t header[4 + 1 + 5];
+  memcpy(header, kind == FAN_USAGE_HOURLY ? kHourlyMagic : kDailyMagic, 4);
+  header[4] = levels;
+  size_t headerLength = 5 + putVarint(header + 5, bucket.index);
+
+  uint8_t record[(FAN_USAGE_MAX_LEVELS + 2) * 5];
+  size_t length = putBucket(record, bucket, levels);
+
+  if (kind == FAN_USAGE_HOURLY) {
+    appendSegment(kHourlyPath, kHourlyOldPath, FAN_USAGE_HOURLY_MAX_BYTES, header, headerLength, record, length);
+  } else {
+    appendSegment(kDailyPath, kDailyOldPath, FAN_USAGE_DAILY_MAX_BYTES, header, headerLength, record, length);
+  }
+}
+
+void FanUsageHistory::flushLocked() {
+  if (logBufferLength > 0) {
+    uint8_t header[4 + 5 + 10];
+    memcpy(header, kLogMagic, 4);
+    size_t headerLength = 4 + putVarint(header + 4, logBufferFirstSequence);
+    headerLength += putVarint(header + headerLength, logBufferBaseMs);
+    if (appendSegment(kLogPath, kLogOldPath, FAN_USAGE_LOG_MAX_BYTES, header, headerLength, logBuffer, logBufferLength)) {
+      log_d("Usage history: %u bytes of transitions written", logBufferLength);
+    }
+    logBufferLength = 0;
+  }
+  saveState();
+}
+
+void FanUsageHistory::loadState() {
+  File file = SPIFFS.open(kStatePath, FILE_READ);
+  uint32_t crc = 0;
+  bool valid = file && file.read((uint8_t *)&state, sizeof(state)) == sizeof(state) &&
+               file.read((uint8_t *)&crc, sizeof(crc)) == sizeof(crc) &&
+               crc == esp_rom_crc32_le(0, (const uint8_t *)&state, sizeof(state)) &&
+               state.magic == kStateMagic && state.levels == levels;
+  file.close();
+
+  if (!valid) {
+    log_w("No usable usage history checkpoint, starting a new history");
+    memset(&state, 0, sizeof(state));
+    state.magic = kStateMagic;
+    state.levels = levels;
+  }
+}
+
+void FanUsageHistory::saveState() {
+  File file = SPIFFS.open(kStatePath, FILE_WRITE);
+  if (!file) {
+    log_e("Failed to open %s", kStatePath);
+    return;
+  }
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&state, sizeof(state));
+  file.write((const uint8_t *)&state, sizeof(state));
+  file.write((const uint8_t *)&crc, sizeof(crc));
+  file.close();
+}
+
+// ============================================================================
+// Incremental reads
+// ============================================================================
+
+size_t FanUsageHistory::readTransitions(uint32_t from, FanUsageTransition *out, size_t max, uint32_t &next) {
+  next = from;
+  if (!started || max == 0) {
+    return 0;
+  }
+  xSemaphoreTake(lock, portMAX_DELAY);
+  size_t count = readTransitionsLocked(from, out, max, next);
+  xSemaphoreGive(lock);
+  return count;
+}
+
+size_t FanUsageHistory::readTransitionsLocked(uint32_t from, FanUsageTransition *out, size_t max, uint32_t &next) {
+  size_t count = 0;
+  next = from;
+  const char *paths[] = {kLogOldPath, kLogPath};
+  for (const char *path : paths) {
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file) {
+      continue;
+    }
+    UsageByteSource source(&file);
+    uint64_t sequence = 0;
+    uint64_t baseMs = 0;
+    if (source.magic(kLogMagic) && source.varint(sequence) && source.varint(baseMs)) {
+      scanTransitions(source, (uint32_t)sequence, baseMs, from, out, max, count);
+    }
+    file.close();
+  }
+  // Transitions still waiting for the next flush
+  if (logBufferLength > 0) {
+    UsageByteSource source(nullptr, logBuffer, logBufferLength);
+    scanTransitions(source, logBufferFirstSequence, logBufferBaseMs, from, out, max, count);
+  }
+
+  if (count > 0) {
+    next = out[count - 1].sequence + 1;
+  }
+  return count;
+}
+
+size_t FanUsageHistory::readBuckets(FanUsageKind kind, uint32_t from, FanUsageBucket *out, size_t max, uint32_t &next) {
+  next = from;
+  if (!started || max == 0 || kind == FAN_USAGE_TRANSITIONS) {
+    return 0;
+  }
+  xSemaphoreTake(lock, portMAX_DELAY);
+  size_t count = readBucketsLocked(kind, from, out, max, next);
+  xSemaphoreGive(lock);
+  return count;
+}
+
+size_t FanUsageHistory::readBucketsLocked(FanUsageKind kind, uint32_t from, FanUsageBucket *out, size_t max, uint32_t &next) {
+  size_t count = 0;
+  next = from;
+  const char *paths[2] = {kind == FAN_USAGE_HOURLY ? kHourlyOldPath : kDailyOldPath,
+                          kind == FAN_USAGE_HOURLY ? kHourlyPath : kDailyPath};
+  for (const char *path : paths) {
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file) {
+      continue;
+    }
+    UsageByteSource source(&file);
+    scanBuckets(source, kind == FAN_USAGE_HOURLY ? kHourlyMagic : kDailyMagic, from, out, max, count);
+    file.close();
+  }
+
+  if (count > 0) {
+    next = out[count - 1].index + 1;
+  }
+  return count;
+}
+
+bool FanUsageHistory::readEncoded(FanUsageKind kind, uint32_t from, uint8_t *buffer, size_t size, size_t &length, TickType_t wait) {
+  length = 0;
+  if (!started) {
+    return true;
+  }
+  // The writer task holds the lock across flash writes; give up instead of stalling the caller
+  if (xSemaphoreTake(lock, wait) != pdTRUE) {
+    return false;
+  }
+  length = encodeLocked(kind, from, buffer, size);
+  xSemaphoreGive(lock);
+  return true;
+}
+
+size_t FanUsageHistory::encodeLocked(FanUsageKind kind, uint32_t from, uint8_t *buffer, size_t size) {
+  uint8_t records[FAN_USAGE_CHUNK_MAX_BYTES];
+  size_t recordsLength = 0;
+  uint32_t first = from;
+  uint32_t next = from;
+  uint8_t header[4 + 5 + 10];
+  size_t headerLength = 0;
+  // kind, levels, varint(next) and the segment header must fit in front of the records
+  size_t budget = size > 2 + 5 + sizeof(header) ? size - 2 - 5 - sizeof(header) : 0;
+  if (budget > sizeof(records)) {
+    budget = sizeof(records);
+  }
+
+  if (kind == FAN_USAGE_TRANSITIONS) {
+    FanUsageTransition transitions[32];
+    size_t count = readTransitionsLocked(from, transitions, 32, next);
+    uint64_t previousMs = count > 0 ? transitions[0].operatingMs : 0;
+    size_t used = 0;
+    while (used < count && recordsLength + kMaxRecordBytes <= budget) {
+      recordsLength += putTransition(records + recordsLength, transitions[used].operatingMs - previousMs,
+                                     transitions[used].speed, transitions[used].rocking);
+      previousMs = transitions[used].operatingMs;
+      used++;
+    }
+    first = count > 0 ? transitions[0].sequence : from;
+    next = used > 0 ? transitions[used - 1].sequence + 1 : from;
+    memcpy(header, kLogMagic, 4);
+    headerLength = 4 + putVarint(header + 4, first);
+    headerLength += putVarint(header + headerLength, count > 0 ? transitions[0].operatingMs : 0);
+  } else {
+    FanUsageBucket buckets[4];
+    size_t count = readBucketsLocked(kind, from, buckets, 4, next);
+    size_t used = 0;
+    while (used < count && recordsLength + (FAN_USAGE_MAX_LEVELS + 2) * 5 <= budget) {
+      recordsLength += putBucket(records + recordsLength, buckets[used], levels);
+      used++;
+    }
+    first = count > 0 ? buckets[0].index : from;
+    next = used > 0 ? buckets[used - 1].index + 1 : from;
+    memcpy(header, kind == FAN_USAGE_HOURLY ? kHourlyMagic : kDailyMagic, 4);
+    header[4] = levels;
+    headerLength = 5 + putVarint(header + 5, first);
+  }
+
+  if (size < 2 + 5 + headerLength + recordsLength) {
+    return 0;
+  }
+  size_t length = 0;
+  buffer[length++] = kind;
+  buffer[length++] = levels;
+  length += putVarint(buffer + length, next);
+  memcpy(buffer + length, header, headerLength);
+  length += headerLength;
+  memcpy(buffer + length, records, recordsLength);
+  return length + recordsLength;
+}
@@ -0,0 +1,193 @@
+#ifndef FAN_USAGE_HISTORY_H
+#define FAN_USAGE_HISTORY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <Matter.h>
+#include <MatterEndPoint.h>
+#include <app/AttributeAccessInterface.h>
+
+// Vendor cluster exposing the usage history (test VID 0xFFF1, manufacturer specific range)
+#ifndef FAN_USAGE_CLUSTER_ID
+#define FAN_USAGE_CLUSTER_ID 0xFFF1FC01
+#endif
+
+#define FAN_USAGE_MAX_LEVELS 8          // Speed levels 0..7
+#define FAN_USAGE_LOG_MAX_BYTES 32768   // Transition log segment size before rotation
+#define FAN_USAGE_HOURLY_MAX_BYTES 4096 // ~2-3 weeks of hourly buckets per segment
+#define FAN_USAGE_DAILY_MAX_BYTES 32768 // ~7 years of daily buckets per segment
+#define FAN_USAGE_CHUNK_MAX_BYTES 200   // HistoryChunk attribute size
+#define FAN_USAGE_CHUNK_WAIT_MS 20      // HistoryChunk reads answer BUSY when the writer holds the history longer
+
+// Usage cluster attributes
+enum FanUsageAttribute : uint32_t {
+  FAN_USAGE_ATTR_OPERATING_SECONDS = 0x0000,  // uint32: powered-on time
+  FAN_USAGE_ATTR_SECONDS_AT_SPEED = 0x0001,   // list<uint32>: time per speed level, index = level
+  FAN_USAGE_ATTR_ROCKING_SECONDS = 0x0002,    // uint32: time with oscillation on
+  FAN_USAGE_ATTR_TRANSITIONS = 0x0003,        // uint32: speed/rock changes
+  FAN_USAGE_ATTR_HISTORY_CURSOR = 0x0010,     // uint32, writable: kind << 30 | first sequence/index
+  FAN_USAGE_ATTR_HISTORY_CHUNK = 0x0011       // octet string: encoded records from the cursor
+};
+
+enum FanUsageKind : uint8_t {
+  FAN_USAGE_TRANSITIONS = 0,
+  FAN_USAGE_HOURLY = 1,
+  FAN_USAGE_DAILY = 2
+};
+
+// One speed/rock change, timestamped in operating time (powered-on ms, continuous across reboots)
+struct FanUsageTransition {
+  uint32_t sequence;
+  uint64_t operatingMs;
+  uint8_t speed;
+  bool rocking;
+};
+
+// Hourly or daily rollup; index counts operating hours/days, so buckets are always contiguous
+struct FanUsageBucket {
+  uint32_t index;
+  uint32_t secondsAtSpeed[FAN_USAGE_MAX_LEVELS];
+  uint32_t rockingSeconds;
+  uint32_t transitions;
+};
+
+class FanUsageHistory;
+
+// Serves the usage cluster attributes straight from FanUsageHistory
+class FanUsageAttributeAccess : public chip::app::AttributeAccessInterface {
+public:
+  FanUsageAttributeAccess(chip::EndpointId endpoint, FanUsageHistory &history)
+    : chip::app::AttributeAccessInterface(chip::Optional<chip::EndpointId>(endpoint), FAN_USAGE_CLUSTER_ID), history(history) {}
+
+  CHIP_ERROR Read(const chip::app::ConcreteReadAttributePath &aPath, chip::app::AttributeValueEncoder &aEncoder) override;
+  CHIP_ERROR Write(const chip::app::ConcreteDataAttributePath &aPath, chip::app::AttributeValueDecoder &aDecoder) override;
+
+protected:
+  FanUsageHistory &history;
+  // HistoryCursor per accessing fabric (index 0: PASE, no fabric), so controllers do not move
+  // each other's position; only touched on the CHIP task
+  uint32_t cursors[CHIP_CONFIG_MAX_FABRICS + 1] = {0};
+
+  uint32_t &cursorFor(chip::FabricIndex fabricIndex);
+};
+
+// Append-only usage history in the spiffs partition
+//
+// Transitions are appended to a log as varint(delta ms) + varint(state). Time is also rolled
+// up into hourly buckets, and hourly buckets into daily ones. Every file rotates into a single
+// ".old" generation at a fixed size, so flash use stays bounded.
+// record() only posts to a queue; accounting and all flash writes run in a background task,
+// batched every flush interval or when the write buffer fills.
+class FanUsageHistory {
+public:
+  FanUsageHistory();
+
+  // Mount the partition, restore the last checkpoint and start the writer task
+  bool begin(uint8_t speedMax, const char *partitionLabel = "spiffs");
+
+  // Add the usage vendor cluster to the fan endpoint - call before Matter.begin()
+  bool addCluster(MatterEndPoint &fan);
+
+  // Control loop side - never blocks; call with the physical fan state
+  void record(uint8_t speed, bool rocking);
+
+  // Write everything buffered now instead of at the next interval
+  void flush();
+  void setFlushInterval(uint32_t intervalMs);
+
+  // Totals, including time buffered but not yet on flash
+  // Served from a snapshot, never waiting for the writer task while it is on flash
+  uint32_t getOperatingSeconds();
+  uint32_t getSecondsAtSpeed(uint8_t speed);
+  uint32_t getRockingSeconds();
+  uint32_t getTransitions();
+  uint32_t getDroppedEvents();
+  uint8_t getLevelCount();
+
+  // Incremental reads: return up to max entries starting at from (a sequence number for
+  // transitions, a bucket index for rollups) and set next to continue from
+  size_t readTransitions(uint32_t from, FanUsageTransition *out, size_t max, uint32_t &next);
+  size_t readBuckets(FanUsageKind kind, uint32_t from, FanUsageBucket *out, size_t max, uint32_t &next);
+
+  // Same entries, encoded as in flash for the HistoryChunk attribute:
+  // kind, level count, varint(next), then a file header and records in length.
+  // Returns false, with nothing read, when the writer task holds the history for longer than wait
+  bool readEncoded(FanUsageKind kind, uint32_t from, uint8_t *buffer, size_t size, size_t &length, TickType_t wait = portMAX_DELAY);
+
+protected:
+  struct Event {
+    uint64_t timestampMs;  // esp_timer time at capture
+    uint8_t speed;
+    bool rocking;
+    bool flush;
+  };
+
+  // Checkpointed to flash with every flush
+  struct State {
+    uint32_t magic;
+    uint8_t levels;
+    uint8_t speed;
+    bool rocking;
+    uint64_t operatingMs;
+    uint32_t sequence;                  // Next transition sequence number
+    uint64_t lastLogMs;                 // Operating time of the last logged transition
+    uint64_t msAtSpeed[FAN_USAGE_MAX_LEVELS];
+    uint64_t rockingMs;
+    uint32_t transitions;
+    uint32_t hourIndex;
+    uint32_t hourMsAtSpeed[FAN_USAGE_MAX_LEVELS];
+    uint32_t hourRockingMs;
+    uint32_t hourTransitions;
+    FanUsageBucket day;
+  };
+
+  // Running totals published by the writer task for the getters
+  struct Totals {
+    uint64_t operatingMs;
+    uint8_t speed;
+    bool rocking;
+    uint64_t msAtSpeed[FAN_USAGE_MAX_LEVELS];
+    uint64_t rockingMs;
+    uint32_t transitions;
+  };
+
+  bool started = false;
+  uint8_t levels = 4;
+  State state;
+  Totals totals = {};
+  portMUX_TYPE totalsMux = portMUX_INITIALIZER_UNLOCKED;
+  uint64_t bootOperatingMs = 0;         // Operating time at boot
+
+  uint8_t logBuffer[256];               // Transitions not yet on flash
+  size_t logBufferLength = 0;
+  uint32_t logBufferFirstSequence = 0;
+  uint64_t logBufferBaseMs = 0;
+  uint32_t flushIntervalMs = 300000;    // 5 minutes
+  uint32_t droppedEvents = 0;
+  uint8_t lastRecordedSpeed = 0;
+  bool lastRecordedRocking = false;
+
+  QueueHandle_t queue = NULL;
+  SemaphoreHandle_t lock = NULL;
+  TaskHandle_t task = NULL;
+  FanUsageAttributeAccess *attributeAccess = nullptr;
+
+  static void taskMain(void *arg);
+  void process(const Event &event);
+  void accumulate(uint64_t uptimeMs);
+  void closeHour();
+  void closeDay();
+  void writeBucket(FanUsageKind kind, const FanUsageBucket &bucket);
+  void flushLocked();
+  void publishTotals();
+  Totals readTotals();
+  size_t readTransitionsLocked(uint32_t from, FanUsageTransition *out, size_t max, uint32_t &next);
+  size_t readBucketsLocked(FanUsageKind kind, uint32_t from, FanUsageBucket *out, size_t max, uint32_t &next);
+  size_t encodeLocked(FanUsageKind kind, uint32_t from, uint8_t *buffer, size_t size);
+  void loadState();
+  void saveState();
+  uint64_t operatingNow();
+  uint32_t msUntilHourEnd();
+};
+
+#endif // FAN_USAGE_HISTORY_H
@@ -6,6 +6,13 @@ using namespace esp_matter::cluster;
 using namespace esp_matter::identification;
 using namespace chip::app::Clusters;
 
+// Objects of one fan endpoint: Descriptor, Identify, Groups and FanControl (MultiSpeed, Rocking)
+static const uint8_t kFanEndpointClusters = 4;
+static const uint16_t kFanEndpointAttributes = 6 + 4 + 3 + 11;
+static const uint16_t kFanEndpointCommands = 2 + 6;
+// A bridged fan adds BridgedDeviceBasicInformation
+static const uint16_t kBridgedEndpointAttributes = 4;
+
 // Attribute update callback
 static esp_err_t multi_speed_fan_attribute_update_cb(
   attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
@@ -19,7 +26,9 @@ static esp_err_t multi_speed_fan_attribute_update_cb(
     case attribute::PRE_UPDATE:
       log_v("Attribute update callback: PRE_UPDATE");
       if (fan != nullptr) {
+        unsigned long startUs = micros();
         err = fan->attributeChangeCB(endpoint_id, cluster_id, attribute_id, val) ? ESP_OK : ESP_FAIL;
+        fan->addCallbackTiming(micros() - startUs);
       }
       break;
     case attribute::POST_UPDATE:
@@ -52,7 +61,7 @@ MatterMultiSpeedFan::~MatterMultiSpeedFan() {
   end();
 }
 
-bool MatterMultiSpeedFan::begin(uint8_t speedMax, uint8_t rockSupport) {
+bool MatterMultiSpeedFan::begin(uint8_t speedMax, uint8_t rockSupport, uint16_t aggregatorEndpointId) {
   // Create Matter node if it doesn't exist
   ArduinoMatter::_init();
 
@@ -64,6 +73,37 @@ bool MatterMultiSpeedFan::begin(uint8_t speedMax, uint8_t rockSupport) {
   this->speedMax = speedMax;
   this->rockSupport = rockSupport;
 
+  // Advertise only the modes that map to distinct speed levels, plus Auto when supported
+  if (speedMax >= 3) {
+    fanModeSequence = static_cast<uint8_t>(autoSupported ? FanControl::FanModeSequenceEnum::kOffLowMedHighAuto
+                                                         : FanControl::FanModeSequenceEnum::kOffLowMedHigh);
+  } else if (speedMax == 2) {
+    fanModeSequence = static_cast<uint8_t>(autoSupported ? FanControl::FanModeSequenceEnum::kOffLowHighAuto
+                                                         : FanControl::FanModeSequenceEnum::kOffLowHigh);
+  } else {
+    fanModeSequence = static_cast<uint8_t>(autoSupported ? FanControl::FanModeSequenceEnum::kOffHighAuto
+                                                         : FanControl::FanModeSequenceEnum::kOffHigh);
+  }
+
+  // The arena is released for the construction and claimed again afterwards
+  if (arena != nullptr) {
+    arena->beginConstruction();
+  }
+  bool created = createEndpoint(aggregatorEndpointId);
+  if (arena != nullptr) {
+    constructionBytes = arena->endConstruction(created);
+  }
+  if (!created) {
+    return false;
+  }
+
+  log_i("Fan initialized: SpeedMax=%d, RockSupport=0x%02X, FanModeSequence=%d", speedMax, rockSupport, fanModeSequence);
+
+  started = true;
+  return true;
+}
+
+bool MatterMultiSpeedFan::createEndpoint(uint16_t aggregatorEndpointId) {
   node_t *matter_node = node::get();
   if (matter_node == nullptr) {
     log_e("Failed to get Matter node");
@@ -73,35 +113,42 @@ bool MatterMultiSpeedFan::begin(uint8_t speedMax, uint8_t rockSupport) {
   // Create fan endpoint with basic configuration
   fan::config_t fan_config;
   fan_config.fan_control.fan_mode = static_cast<uint8_t>(FanControl::FanModeEnum::kOff);
-  fan_config.fan_control.fan_mode_sequence = static_cast<uint8_t>(FanControl::FanModeSequenceEnum::kOffLowMedHigh);
+  fan_config.fan_control.fan_mode_sequence = fanModeSequence;
   fan_config.fan_control.percent_setting = (uint8_t)0;  // Cast to uint8_t for nullable assignment
   fan_config.fan_control.percent_current = 0;
 
-  endpoint_t *endpoint = fan::create(matter_node, &fan_config, ENDPOINT_FLAG_NONE, (void *)this);
+  endpoint_t *endpoint = nullptr;
+  if (aggregatorEndpointId == kNotBridged) {
+    endpoint = fan::create(matter_node, &fan_config, ENDPOINT_FLAG_DESTROYABLE, (void *)this);
+  } else {
+    endpoint = createBridgedEndpoint(matter_node, &fan_config, aggregatorEndpointId);
+  }
   if (endpoint == nullptr) {
     log_e("Failed to create fan endpoint");
     return false;
   }
 
   setEndPointId(endpoint::get_id(endpoint));
+  reports.begin(getEndPointId(), FanControl::Id);
   log_i("Fan created with endpoint_id %d", getEndPointId());
 
   // Get the fan control cluster
   cluster_t *cluster = cluster::get(endpoint, FanControl::Id);
   if (cluster == nullptr) {
     log_e("Failed to get fan control cluster");
+    discardEndpoint(matter_node, endpoint);
     return false;
   }
 
-  // Update FeatureMap to indicate MultiSpeed (0x01) and Rocking (0x04) support
+  // Update FeatureMap to indicate MultiSpeed (0x01), Rocking (0x04) and optionally Auto (0x02) support
   // The FeatureMap attribute is already created by fan::create(), so we need to update it
   attribute_t *feature_map_attr = attribute::get(cluster, FanControl::Attributes::FeatureMap::Id);
   if (feature_map_attr != nullptr) {
     esp_matter_attr_val_t feature_map_val = esp_matter_invalid(NULL);
     feature_map_val.type = ESP_MATTER_VAL_TYPE_BITMAP32;
-    feature_map_val.val.u32 = 0x05;  // MultiSpeed (0x01) | Rocking (0x04)
+    feature_map_val.val.u32 = FEATURE_MULTI_SPEED | FEATURE_ROCKING | (autoSupported ? FEATURE_AUTO : 0);
     attribute::set_val(feature_map_attr, &feature_map_val);
-    log_i("FeatureMap updated to 0x05 (MultiSpeed|Rocking)");
+    log_i("FeatureMap updated to 0x%02" PRIX32 " (MultiSpeed|Rocking%s)", feature_map_val.val.u32, autoSupported ? "|Auto" : "");
   } else {
     log_e("Failed to get FeatureMap attribute");
   }
@@ -139,14 +186,122 @@ bool MatterMultiSpeedFan::begin(uint8_t speedMax, uint8_t rockSupport) {
   rock_setting_val.val.u8 = 0;
   attribute::create(cluster, FanControl::Attributes::RockSetting::Id, ATTRIBUTE_FLAG_WRITABLE, rock_setting_val);
 
-  log_i("Fan initialized: SpeedMax=%d, RockSupport=0x%02X", speedMax, rockSupport);
+  // Add the manufacturer specific Stalled attribute, driven by setStalled()
+  esp_matter_attr_val_t stalled_val = esp_matter_invalid(NULL);
+  stalled_val.type = ESP_MATTER_VAL_TYPE_BOOLEAN;
+  stalled_val.val.b = false;
+  attribute::create(cluster, FAN_ATTR_STALLED, ATTRIBUTE_FLAG_NONE, stalled_val);
 
-  started = true;
+  // Endpoints added after esp_matter has started are only published once enabled
+  if (bridged && esp_matter::is_started() && endpoint::enable(endpoint) != ESP_OK) {
+    log_e("Failed to enable bridged fan endpoint %d", getEndPointId());
+    discardEndpoint(matter_node, endpoint);
+    return false;
+  }
   return true;
 }
 
+// A half built endpoint is not left in the node: begin() can be retried and end() has nothing to tear down
+void MatterMultiSpeedFan::discardEndpoint(node_t *node, endpoint_t *endpoint) {
+  if (endpoint::destroy(node, endpoint) != ESP_OK) {
+    log_e("Failed to destroy fan endpoint %d", getEndPointId());
+  }
+  setEndPointId(0);
+  bridged = false;
+}
+
+endpoint_t *MatterMultiSpeedFan::createBridgedEndpoint(node_t *node, fan::config_t *config, uint16_t aggregatorEndpointId) {
+  endpoint_t *aggregator = endpoint::get(node, aggregatorEndpointId);
+  if (aggregator == nullptr) {
+    log_e("Aggregator endpoint %d not found", aggregatorEndpointId);
+    return nullptr;
+  }
+
+  // Bridged Node device type (BridgedDeviceBasicInformation) plus the Fan device type
+  bridged_node::config_t bridged_config;
+  endpoint_t *endpoint = bridged_node::create(node, &bridged_config, ENDPOINT_FLAG_DESTROYABLE | ENDPOINT_FLAG_BRIDGE, (void *)this);
+  if (endpoint == nullptr) {
+    return nullptr;
+  }
+  if (fan::add(endpoint, config) != ESP_OK || set_parent_endpoint(endpoint, aggregator) != ESP_OK) {
+    log_e("Failed to set up bridged fan endpoint");
+    endpoint::destroy(node, endpoint);
+    return nullptr;
+  }
+
+  bridged = true;
+  return endpoint;
+}
+
+bool MatterMultiSpeedFan::isBridged() {
+  return bridged;
+}
+
+bool MatterMultiSpeedFan::setReachable(bool reachable) {
+  if (!started || !bridged) {
+    log_w("Matter Fan is not a started bridged device.");
+    return false;
+  }
+
+  esp_matter_attr_val_t reachable_val = esp_matter_invalid(NULL);
+  if (!getAttributeVal(BridgedDeviceBasicInformation::Id, BridgedDeviceBasicInformation::Attributes::Reachable::Id, &reachable_val)) {
+    return false;
+  }
+  if (reachable_val.val.b == reachable) {
+    return true;
+  }
+  reachable_val.val.b = reachable;
+  log_i("Bridged fan on endpoint %d is %s", getEndPointId(), reachable ? "reachable" : "unreachable");
+  return updateAttributeVal(BridgedDeviceBasicInformation::Id, BridgedDeviceBasicInformation::Attributes::Reachable::Id, &reachable_val);
+}
+
 void MatterMultiSpeedFan::end() {
   started = false;
+  uint16_t endpointId = getEndPointId();
+  if (endpointId == 0) {
+    return;
+  }
+
+  node_t *matter_node = node::get();
+  endpoint_t *endpoint = matter_node == nullptr ? nullptr : endpoint::get(matter_node, endpointId);
+  if (endpoint != nullptr) {
+    if (arena != nullptr) {
+      arena->beginTeardown();
+    }
+    esp_err_t err = endpoint::destroy(matter_node, endpoint);
+    if (arena != nullptr) {
+      arena->endTeardown(err == ESP_OK);
+    }
+    if (err != ESP_OK) {
+      log_e("Failed to destroy fan endpoint %d", endpointId);
+      return;
+    }
+    log_i("Fan endpoint %d destroyed", endpointId);
+  }
+
+  setEndPointId(0);
+  bridged = false;
+  constructionBytes = 0;
+}
+
+void MatterMultiSpeedFan::useArena(FanEndpointArena *arena) {
+  this->arena = arena;
+}
+
+bool MatterMultiSpeedFan::getFootprint(FanEndpointFootprint &footprint) {
+  if (!started || !FanEndpointArena::measure(getEndPointId(), footprint)) {
+    return false;
+  }
+  footprint.callbackCount = (_onChangeSpeedCB != nullptr) + (_onChangeRockCB != nullptr) + (_onActuationPlanCB != nullptr);
+  footprint.heapBytes = constructionBytes;
+  footprint.objectBytes = sizeof(*this);
+  return true;
+}
+
+size_t MatterMultiSpeedFan::estimateEndpointBytes(bool bridged) {
+  return FanEndpointArena::estimateBytes(kFanEndpointClusters + (bridged ? 1 : 0),
+                                         kFanEndpointAttributes + (bridged ? kBridgedEndpointAttributes : 0),
+                                         kFanEndpointCommands);
 }
 
 bool MatterMultiSpeedFan::attributeChangeCB(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val) {
@@ -157,6 +312,8 @@ bool MatterMultiSpeedFan::attributeChangeCB(uint16_t endpoint_id, uint32_t clust
 
   bool ret = true;
 
+  // Every write resolves to its final target here and is actuated once. Derived attributes are
+  // stored and reported by actuate(); the written attribute itself is stored by the framework.
   if (endpoint_id == getEndPointId() && cluster_id == FanControl::Id) {
     // Handle SpeedSetting changes
     if (attribute_id == FanControl::Attributes::SpeedSetting::Id) {
@@ -167,39 +324,13 @@ bool MatterMultiSpeedFan::attributeChangeCB(uint16_t endpoint_id, uint32_t clust
       if (newSpeed > speedMax) {
         log_w("Speed %d exceeds speedMax %d, clamping", newSpeed, speedMax);
         newSpeed = speedMax;
+        val->val.u8 = newSpeed;
       }
 
-      // Call user callback
-      if (_onChangeSpeedCB != nullptr) {
-        ret = _onChangeSpeedCB(newSpeed);
-      }
-
-      if (ret) {
-        currentSpeed = newSpeed;
-
-        // Update FanMode accordingly (required for HomeKit compatibility)
-        esp_matter_attr_val_t modeVal = esp_matter_invalid(NULL);
-        modeVal.type = ESP_MATTER_VAL_TYPE_UINT8;
-        modeVal.val.u8 = (newSpeed == 0) ? static_cast<uint8_t>(FanControl::FanModeEnum::kOff)
-                                        : static_cast<uint8_t>(FanControl::FanModeEnum::kOn);
-
-        if (!updateAttributeVal(FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal)) {
-          log_w("Failed to update FanMode attribute");
-        }
-
-        // Update SpeedCurrent to match SpeedSetting
-        esp_matter_attr_val_t speedCurrentVal = esp_matter_invalid(NULL);
-        speedCurrentVal.type = ESP_MATTER_VAL_TYPE_UINT8;
-        speedCurrentVal.val.u8 = newSpeed;
-
-        if (!updateAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &speedCurrentVal)) {
-          log_w("Failed to update SpeedCurrent attribute");
-        }
-
-        if (newSpeed == 0 && currentRockSetting != 0) {
-          setRockSetting(0, true);  // Turn off oscillation when speed is 0
-        }
-      }
+      FanActuationPlan plan;
+      plan.hasSpeed = true;
+      plan.speed = newSpeed;
+      ret = setAutoModeState(false, attribute_id) && actuate(plan, attribute_id);
     }
 
     // Handle RockSetting changes
@@ -212,41 +343,54 @@ bool MatterMultiSpeedFan::attributeChangeCB(uint16_t endpoint_id, uint32_t clust
         log_w("RockSetting 0x%02X includes unsupported bits (RockSupport: 0x%02X)", newRockSetting, rockSupport);
         // Mask to only supported bits
         newRockSetting &= rockSupport;
+        val->val.u8 = newRockSetting;
       }
 
-      // Call user callback
-      if (_onChangeRockCB != nullptr) {
-        ret = _onChangeRockCB(newRockSetting);
-      }
-
-      if (ret) {
-        currentRockSetting = newRockSetting;
-        // Report the attribute change
-        attribute::report(endpoint_id, FanControl::Id, FanControl::Attributes::RockSetting::Id, val);
-      }
+      FanActuationPlan plan;
+      plan.hasRock = true;
+      plan.rockSetting = newRockSetting;
+      ret = actuate(plan, attribute_id);
     }
 
-    // Handle FanMode changes (for On/Off via mode)
+    // Handle FanMode changes - each mode maps straight to its speed level
     if (attribute_id == FanControl::Attributes::FanMode::Id) {
       uint8_t fanMode = val->val.u8;
       log_i("FanMode changed to %d", fanMode);
 
-      setOnOff(fanMode != static_cast<uint8_t>(FanControl::FanModeEnum::kOff), true);
+      if (!isFanModeSupported(fanMode)) {
+        log_w("FanMode %d is not supported by FanModeSequence %d", fanMode, fanModeSequence);
+        return false;
+      }
+
+      // Smart is Auto when the fan has it; the Auto mode controller then picks the speed
+      if (autoSupported && (fanMode == static_cast<uint8_t>(FanControl::FanModeEnum::kAuto) ||
+                            fanMode == static_cast<uint8_t>(FanControl::FanModeEnum::kSmart))) {
+        val->val.u8 = static_cast<uint8_t>(FanControl::FanModeEnum::kAuto);
+        return setAutoModeState(true, attribute_id);
+      }
+
+      FanActuationPlan plan;
+      plan.hasSpeed = true;
+      plan.speed = speedForFanMode(fanMode);
+      // On and Smart are stored as the mode they resolve to
+      val->val.u8 = fanModeForSpeed(plan.speed);
+      ret = setAutoModeState(false, attribute_id) && actuate(plan, attribute_id);
     }
 
-    // Handle Percent Setting changes
+    // Handle PercentSetting changes - mapped to the speed level that covers the percentage
     if (attribute_id == FanControl::Attributes::PercentSetting::Id) {
       uint8_t percentValue = val->val.u8;
       log_i("PercentSetting changed to %d", percentValue);
 
-      // Update PercentCurrent to match PercentSetting
-      esp_matter_attr_val_t percentCurrentVal = esp_matter_invalid(NULL);
-      percentCurrentVal.type = ESP_MATTER_VAL_TYPE_UINT8;
-      percentCurrentVal.val.u8 = percentValue;
-
-      if (!updateAttributeVal(FanControl::Id, FanControl::Attributes::PercentCurrent::Id, &percentCurrentVal)) {
-        log_w("Failed to update PercentCurrent attribute");
+      if (percentValue > 100) {
+        log_w("PercentSetting %d is out of range", percentValue);
+        return false;
       }
+
+      FanActuationPlan plan;
+      plan.hasSpeed = true;
+      plan.speed = percentToSpeed(percentValue);
+      ret = setAutoModeState(false, attribute_id) && actuate(plan, attribute_id);
     }
   }
 
@@ -276,48 +420,16 @@ bool MatterMultiSpeedFan::setSpeed(uint8_t speed, bool performUpdate) {
 
   bool ret;
   if (performUpdate) {
+    // attributeChangeCB() actuates and updates the derived attributes
     ret = updateAttributeVal(FanControl::Id, FanControl::Attributes::SpeedSetting::Id, &speedVal);
-    if (ret) {
-      updateAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &speedVal);
-    }
   } else {
-    ret = setAttributeVal(FanControl::Id, FanControl::Attributes::SpeedSetting::Id, &speedVal);
-    if (ret) {
-      esp_matter_attr_val_t modeVal = esp_matter_invalid(NULL);
-      modeVal.type = ESP_MATTER_VAL_TYPE_UINT8;
-      modeVal.val.u8 = (speed == 0) ? static_cast<uint8_t>(FanControl::FanModeEnum::kOff)
-                                        : static_cast<uint8_t>(FanControl::FanModeEnum::kHigh);
-
-      if (!setAttributeVal(FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal)) {
-        log_w("Failed to update FanMode attribute");
-      }
-      if (!attribute::report(endpoint_id, FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal)) {
-        log_w("Failed to report FanMode attribute");
-      }
-        
-
-      if (!updateAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &speedVal)) {
-        log_w("Failed to update SpeedCurrent attribute");
-      }
-
-      esp_matter_attr_val_t percentVal = esp_matter_invalid(NULL);
-      percentVal.type = ESP_MATTER_VAL_TYPE_UINT8;
-      percentVal.val.u8 = speed == 0 ? 0 : speed  == 1 ? 33 : speed == 2 ? 66 : 100;
-
-      if (!setAttributeVal(FanControl::Id, FanControl::Attributes::PercentSetting::Id, &percentVal)) {
-        log_w("Failed to update PercentSetting attribute");
-      }
-      if (!attribute::report(endpoint_id, FanControl::Id, FanControl::Attributes::PercentSetting::Id, &percentVal)) {
-        log_w("Failed to update PercentSetting attribute");
-      }
-      if (!updateAttributeVal(FanControl::Id, FanControl::Attributes::PercentCurrent::Id, &percentVal)) {
-        log_w("Failed to update PercentCurrent attribute");
-      }
-
-      if(speed == 0 && currentRockSetting != 0) {
-        setRockSetting(0, false);
-      }
-    }
+    // The hardware is already at this speed (changed on the fan itself, which ends Auto mode):
+    // store the attributes and schedule their reports
+    FanActuationPlan plan;
+    plan.hasSpeed = true;
+    plan.speed = speed;
+    setAutoModeState(false, kNoWrittenAttribute);
+    ret = !normalizePlan(plan) || storePlan(plan, kNoWrittenAttribute);
   }
 
   if (ret) {
@@ -391,8 +503,10 @@ bool MatterMultiSpeedFan::setRockSetting(uint8_t rockSetting, bool performUpdate
   if (performUpdate) {
     ret = updateAttributeVal(FanControl::Id, FanControl::Attributes::RockSetting::Id, &rockVal);
   } else {
-    ret = setAttributeVal(FanControl::Id, FanControl::Attributes::RockSetting::Id, &rockVal);
-    attribute::report(endpoint_id, FanControl::Id, FanControl::Attributes::RockSetting::Id, &rockVal);
+    FanActuationPlan plan;
+    plan.hasRock = true;
+    plan.rockSetting = rockSetting;
+    ret = !normalizePlan(plan) || storePlan(plan, kNoWrittenAttribute);
   }
 
   if (ret) {
@@ -417,6 +531,415 @@ bool MatterMultiSpeedFan::isRocking() {
   return currentRockSetting != 0;
 }
 
+bool MatterMultiSpeedFan::applyActuationPlan(FanActuationPlan plan) {
+  if (!started) {
+    log_w("Matter Fan device has not begun.");
+    return false;
+  }
+
+  // A speed from outside the Auto mode controller (e.g. a scene recall) ends Auto mode
+  if (plan.hasSpeed && !setAutoModeState(false, kNoWrittenAttribute)) {
+    return false;
+  }
+  return actuate(plan, kNoWrittenAttribute);
+}
+
+bool MatterMultiSpeedFan::actuate(FanActuationPlan plan, uint32_t writtenAttributeId) {
+  if (!normalizePlan(plan)) {
+    return true;
+  }
+
+  bool ret = true;
+  if (_onActuationPlanCB != nullptr) {
+    ret = _onActuationPlanCB(plan);
+  } else {
+    if (plan.hasSpeed && _onChangeSpeedCB != nullptr) {
+      ret = _onChangeSpeedCB(plan.speed);
+    }
+    if (ret && plan.hasRock && _onChangeRockCB != nullptr) {
+      ret = _onChangeRockCB(plan.rockSetting);
+    }
+  }
+  if (!ret) {
+    log_w("Actuation plan rejected by the application");
+    return false;
+  }
+
+  return storePlan(plan, writtenAttributeId);
+}
+
+bool MatterMultiSpeedFan::normalizePlan(FanActuationPlan &plan) {
+  if (plan.hasSpeed && plan.speed > speedMax) {
+    log_w("Speed %d exceeds speedMax %d, clamping", plan.speed, speedMax);
+    plan.speed = speedMax;
+  }
+  if (plan.hasRock && (plan.rockSetting & ~rockSupport) != 0) {
+    log_w("RockSetting 0x%02X includes unsupported bits (RockSupport: 0x%02X)", plan.rockSetting, rockSupport);
+    plan.rockSetting &= rockSupport;
+  }
+
+  // Oscillation turns off with the fan
+  if (plan.hasSpeed && plan.speed == 0) {
+    plan.hasRock = true;
+    plan.rockSetting = 0;
+  }
+
+  // Only actuate what actually changes
+  if (plan.hasSpeed && plan.speed == currentSpeed) {
+    plan.hasSpeed = false;
+  }
+  if (plan.hasRock && plan.rockSetting == currentRockSetting) {
+    plan.hasRock = false;
+  }
+  return plan.hasSpeed || plan.hasRock;
+}
+
+bool MatterMultiSpeedFan::storePlan(const FanActuationPlan &plan, uint32_t writtenAttributeId) {
+  // Store every affected attribute without callbacks, then report them together
+  struct {
+    uint32_t attributeId;
+    uint8_t value;
+  } batch[6];
+  uint8_t batchSize = 0;
+
+  if (plan.hasSpeed) {
+    uint8_t percent = speedToPercent(plan.speed);
+    batch[batchSize++] = {FanControl::Attributes::SpeedSetting::Id, plan.speed};
+    uint8_t fanMode = autoMode ? static_cast<uint8_t>(FanControl::FanModeEnum::kAuto) : fanModeForSpeed(plan.speed);
+    batch[batchSize++] = {FanControl::Attributes::FanMode::Id, fanMode};
+    batch[batchSize++] = {FanControl::Attributes::PercentSetting::Id, percent};
+    if (!measuredSpeed) {
+      batch[batchSize++] = {FanControl::Attributes::SpeedCurrent::Id, plan.speed};
+      batch[batchSize++] = {FanControl::Attributes::PercentCurrent::Id, percent};
+    }
+    currentSpeed = plan.speed;
+  }
+  if (plan.hasRock) {
+    batch[batchSize++] = {FanControl::Attributes::RockSetting::Id, plan.rockSetting};
+    currentRockSetting = plan.rockSetting;
+  }
+
+  bool ret = true;
+  esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+  val.type = ESP_MATTER_VAL_TYPE_UINT8;
+  for (uint8_t i = 0; i < batchSize; i++) {
+    if (batch[i].attributeId == writtenAttributeId) {
+      continue;  // Stored and reported by the framework once the write is accepted
+    }
+    val.val.u8 = batch[i].value;
+    if (!setAttributeVal(FanControl::Id, batch[i].attributeId, &val)) {
+      log_w("Failed to set attribute 0x%04X", batch[i].attributeId);
+      ret = false;
+    }
+  }
+  for (uint8_t i = 0; i < batchSize; i++) {
+    if (batch[i].attributeId != writtenAttributeId) {
+      reports.markDirty(batch[i].attributeId);
+    }
+  }
+
+  log_d("Actuation plan applied: Speed=%d, Rock=0x%02X (%d attributes)", currentSpeed, currentRockSetting, batchSize);
+  return ret;
+}
+
+uint8_t MatterMultiSpeedFan::speedToPercent(uint8_t speed) {
+  if (speedMax == 0) {
+    return 0;
+  }
+  return (uint8_t)((uint16_t)speed * 100 / speedMax);
+}
+
+uint8_t MatterMultiSpeedFan::percentToSpeed(uint8_t percent) {
+  if (percent > 100) {
+    percent = 100;
+  }
+  return (uint8_t)(((uint16_t)percent * speedMax + 99) / 100);
+}
+
+uint8_t MatterMultiSpeedFan::getFanModeSequence() {
+  return fanModeSequence;
+}
+
+bool MatterMultiSpeedFan::isFanModeSupported(uint8_t fanMode) {
+  switch (static_cast<FanControl::FanModeEnum>(fanMode)) {
+    case FanControl::FanModeEnum::kOff:
+    case FanControl::FanModeEnum::kLow:
+    case FanControl::FanModeEnum::kHigh:
+    case FanControl::FanModeEnum::kOn:
+    case FanControl::FanModeEnum::kSmart:
+      return true;
+    case FanControl::FanModeEnum::kMedium:
+      return sequenceHasMedium();
+    case FanControl::FanModeEnum::kAuto:
+      return autoSupported;
+    default:
+      return false;
+  }
+}
+
+uint8_t MatterMultiSpeedFan::speedForFanMode(uint8_t fanMode) {
+  switch (static_cast<FanControl::FanModeEnum>(fanMode)) {
+    case FanControl::FanModeEnum::kOff:
+      return 0;
+    case FanControl::FanModeEnum::kLow:
+      return highestSpeedAtPercent(33);
+    case FanControl::FanModeEnum::kMedium:
+      return highestSpeedAtPercent(66);
+    case FanControl::FanModeEnum::kHigh:
+    case FanControl::FanModeEnum::kOn:     // On is equivalent to High
+    case FanControl::FanModeEnum::kSmart:  // Smart falls back to High without Auto
+    case FanControl::FanModeEnum::kAuto:   // Only used when Auto mode is not supported
+    default:
+      return speedMax;
+  }
+}
+
+uint8_t MatterMultiSpeedFan::fanModeForSpeed(uint8_t speed) {
+  if (speed == 0) {
+    return static_cast<uint8_t>(FanControl::FanModeEnum::kOff);
+  }
+  if (speed >= speedMax) {
+    return static_cast<uint8_t>(FanControl::FanModeEnum::kHigh);
+  }
+  // The same levels speedForFanMode() resolves Low and Medium to
+  if (speed <= speedForFanMode(static_cast<uint8_t>(FanControl::FanModeEnum::kLow))) {
+    return static_cast<uint8_t>(FanControl::FanModeEnum::kLow);
+  }
+  if (sequenceHasMedium() && speed <= speedForFanMode(static_cast<uint8_t>(FanControl::FanModeEnum::kMedium))) {
+    return static_cast<uint8_t>(FanControl::FanModeEnum::kMedium);
+  }
+  return static_cast<uint8_t>(FanControl::FanModeEnum::kHigh);
+}
+
+uint8_t MatterMultiSpeedFan::highestSpeedAtPercent(uint8_t percent) {
+  // speedToPercent() rounds down, so this is the inverse that stays within the mode
+  uint8_t speed = 1;
+  while (speed < speedMax && speedToPercent(speed + 1) <= percent) {
+    speed++;
+  }
+  return speed;
+}
+
+bool MatterMultiSpeedFan::sequenceHasMedium() {
+  return fanModeSequence == static_cast<uint8_t>(FanControl::FanModeSequenceEnum::kOffLowMedHigh) ||
+         fanModeSequence == static_cast<uint8_t>(FanControl::FanModeSequenceEnum::kOffLowMedHighAuto);
+}
+
+void MatterMultiSpeedFan::setAutoSupported(bool supported) {
+  if (started) {
+    log_w("Auto mode support must be set before begin()");
+    return;
+  }
+  autoSupported = supported;
+}
+
+bool MatterMultiSpeedFan::isAutoSupported() {
+  return autoSupported;
+}
+
+bool MatterMultiSpeedFan::isAutoMode() {
+  return autoMode;
+}
+
+bool MatterMultiSpeedFan::setAutoMode(bool enable) {
+  if (!started) {
+    log_w("Matter Fan device has not begun.");
+    return false;
+  }
+  if (enable && !autoSupported) {
+    log_w("Auto mode is not supported");
+    return false;
+  }
+  if (enable == autoMode) {
+    return true;
+  }
+
+  // Same path as a controller writing FanMode
+  esp_matter_attr_val_t modeVal = esp_matter_invalid(NULL);
+  modeVal.type = ESP_MATTER_VAL_TYPE_UINT8;
+  modeVal.val.u8 = enable ? static_cast<uint8_t>(FanControl::FanModeEnum::kAuto) : fanModeForSpeed(currentSpeed);
+  return updateAttributeVal(FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal);
+}
+
+bool MatterMultiSpeedFan::applyAutoSpeed(uint8_t speed) {
+  if (!started) {
+    log_w("Matter Fan device has not begun.");
+    return false;
+  }
+  if (!autoMode) {
+    log_w("Fan is not in Auto mode");
+    return false;
+  }
+
+  FanActuationPlan plan;
+  plan.hasSpeed = true;
+  plan.speed = speed;
+  return actuate(plan, kNoWrittenAttribute);
+}
+
+bool MatterMultiSpeedFan::setAutoModeState(bool enable, uint32_t writtenAttributeId) {
+  if (autoMode == enable) {
+    return true;
+  }
+  autoMode = enable;
+  log_i("Auto mode %s", enable ? "on" : "off");
+
+  if (writtenAttributeId == FanControl::Attributes::FanMode::Id) {
+    return true;  // Stored and reported by the framework once the write is accepted
+  }
+  esp_matter_attr_val_t modeVal = esp_matter_invalid(NULL);
+  modeVal.type = ESP_MATTER_VAL_TYPE_UINT8;
+  modeVal.val.u8 = enable ? static_cast<uint8_t>(FanControl::FanModeEnum::kAuto) : fanModeForSpeed(currentSpeed);
+  if (!setAttributeVal(FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal)) {
+    log_w("Failed to set FanMode attribute");
+    return false;
+  }
+  reports.markDirty(FanControl::Attributes::FanMode::Id);
+  return true;
+}
+
+void MatterMultiSpeedFan::useMeasuredSpeed(bool enable) {
+  measuredSpeed = enable;
+  log_i("SpeedCurrent/PercentCurrent source: %s", enable ? "tachometer" : "setting");
+}
+
+bool MatterMultiSpeedFan::isUsingMeasuredSpeed() {
+  return measuredSpeed;
+}
+
+void MatterMultiSpeedFan::setMeasuredReportLimits(uint32_t minIntervalMs, uint8_t percentDeadband) {
+  measuredMinIntervalMs = minIntervalMs;
+  measuredPercentDeadband = percentDeadband;
+}
+
+bool MatterMultiSpeedFan::setMeasuredSpeed(uint8_t speedCurrent, uint8_t percentCurrent) {
+  if (!started) {
+    log_w("Matter Fan device has not begun.");
+    return false;
+  }
+  if (!measuredSpeed) {
+    return false;
+  }
+
+  if (speedCurrent > speedMax) {
+    speedCurrent = speedMax;
+  }
+  if (percentCurrent > 100) {
+    percentCurrent = 100;
+  }
+
+  bool speedChanged = speedCurrent != measuredSpeedCurrent;
+  uint8_t percentDelta = percentCurrent > measuredPercentCurrent ? percentCurrent - measuredPercentCurrent
+                                                                 : measuredPercentCurrent - percentCurrent;
+  // Reaching 0% or 100% is always reported so a settled fan shows its final value
+  bool percentChanged = percentDelta >= measuredPercentDeadband ||
+                        (percentDelta != 0 && (percentCurrent == 0 || percentCurrent == 100));
+  if (!speedChanged && !percentChanged) {
+    return true;
+  }
+
+  // Rate limit reports while the motor spins up or down
+  if (millis() - lastMeasuredReportTime < measuredMinIntervalMs) {
+    return true;
+  }
+  lastMeasuredReportTime = millis();
+
+  bool ret = true;
+  if (speedChanged) {
+    esp_matter_attr_val_t speedCurrentVal = esp_matter_invalid(NULL);
+    speedCurrentVal.type = ESP_MATTER_VAL_TYPE_UINT8;
+    speedCurrentVal.val.u8 = speedCurrent;
+    if (setAttributeVal(FanControl::Id, FanControl::Attributes::SpeedCurrent::Id, &speedCurrentVal)) {
+      measuredSpeedCurrent = speedCurrent;
+      reports.markDirty(FanControl::Attributes::SpeedCurrent::Id);
+    } else {
+      log_w("Failed to update SpeedCurrent attribute");
+      ret = false;
+    }
+  }
+  if (percentChanged) {
+    esp_matter_attr_val_t percentCurrentVal = esp_matter_invalid(NULL);
+    percentCurrentVal.type = ESP_MATTER_VAL_TYPE_UINT8;
+    percentCurrentVal.val.u8 = percentCurrent;
+    if (setAttributeVal(FanControl::Id, FanControl::Attributes::PercentCurrent::Id, &percentCurrentVal)) {
+      measuredPercentCurrent = percentCurrent;
+      reports.markDirty(FanControl::Attributes::PercentCurrent::Id);
+    } else {
+      log_w("Failed to update PercentCurrent attribute");
+      ret = false;
+    }
+  }
+
+  log_d("Measured speed reported: SpeedCurrent=%d, PercentCurrent=%d", speedCurrent, percentCurrent);
+  return ret;
+}
+
+bool MatterMultiSpeedFan::setStalled(bool stalled) {
+  if (!started) {
+    log_w("Matter Fan device has not begun.");
+    return false;
+  }
+  if (stalled == this->stalled) {
+    return true;
+  }
+
+  // A fault is not batched with the derived attributes
+  esp_matter_attr_val_t stalledVal = esp_matter_invalid(NULL);
+  stalledVal.type = ESP_MATTER_VAL_TYPE_BOOLEAN;
+  stalledVal.val.b = stalled;
+  if (!updateAttributeVal(FanControl::Id, FAN_ATTR_STALLED, &stalledVal)) {
+    log_w("Failed to update Stalled attribute");
+    return false;
+  }
+  this->stalled = stalled;
+  return true;
+}
+
+bool MatterMultiSpeedFan::isStalled() {
+  return stalled;
+}
+
+void MatterMultiSpeedFan::setReportWindow(uint32_t windowMs) {
+  reports.setWindow(windowMs);
+  log_i("Report window: %lu ms", (unsigned long)windowMs);
+}
+
+void MatterMultiSpeedFan::setActuationSettled(bool settled) {
+  reports.setSettled(settled);
+}
+
+void MatterMultiSpeedFan::loop() {
+  if (started) {
+    reports.loop(millis());
+  }
+}
+
+FanReportScheduler &MatterMultiSpeedFan::getReportScheduler() {
+  return reports;
+}
+
+FanTimingStats MatterMultiSpeedFan::getCallbackTiming() {
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  FanTimingStats timing = callbackTiming;
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+  return timing;
+}
+
+void MatterMultiSpeedFan::resetCallbackTiming() {
+  lock::status_t lockStatus = lock::chip_stack_lock(portMAX_DELAY);
+  callbackTiming.reset();
+  if (lockStatus == lock::SUCCESS) {
+    lock::chip_stack_unlock();
+  }
+}
+
+// Attribute callbacks run on the CHIP task, which holds the stack lock
+void MatterMultiSpeedFan::addCallbackTiming(uint32_t us) {
+  callbackTiming.add(us);
+}
+
 void MatterMultiSpeedFan::onChangeSpeed(SpeedChangeCallback cb) {
   _onChangeSpeedCB = cb;
 }
@@ -425,6 +948,10 @@ void MatterMultiSpeedFan::onChangeRock(RockChangeCallback cb) {
   _onChangeRockCB = cb;
 }
 
+void MatterMultiSpeedFan::onActuationPlan(ActuationPlanCallback cb) {
+  _onActuationPlanCB = cb;
+}
+
 void MatterMultiSpeedFan::updateAccessory() {
   if (!started) {
     log_w("Matter Fan device has not begun.");
@@ -442,7 +969,12 @@ void MatterMultiSpeedFan::updateAccessory() {
     currentRockSetting = rockVal.val.u8;
   }
 
-  log_i("Fan accessory updated: Speed=%d, Rock=0x%02X", currentSpeed, currentRockSetting);
+  esp_matter_attr_val_t modeVal = esp_matter_invalid(NULL);
+  if (getAttributeVal(FanControl::Id, FanControl::Attributes::FanMode::Id, &modeVal)) {
+    autoMode = autoSupported && modeVal.val.u8 == static_cast<uint8_t>(FanControl::FanModeEnum::kAuto);
+  }
+
+  log_i("Fan accessory updated: Speed=%d, Rock=0x%02X%s", currentSpeed, currentRockSetting, autoMode ? ", Auto" : "");
 }
 
 MatterMultiSpeedFan &MatterMultiSpeedFan::operator=(uint8_t speed) {
@@ -3,6 +3,9 @@
 
 #include <Matter.h>
 #include <MatterEndPoint.h>
+#include "FanEndpointArena.h"
+#include "FanReportScheduler.h"
+#include "FanTimingStats.h"
 
 // Fan Speed Levels
 enum FanSpeedLevel_t : uint8_t {
@@ -27,7 +30,7 @@ enum RockSettingBitmap : uint8_t {
 };
 
 // FanControl Cluster FeatureMap (Matter Spec 7.4.4)
-// This implementation sets FeatureMap = 0x05 (MultiSpeed | Rocking)
+// This implementation sets FeatureMap = 0x05 (MultiSpeed | Rocking), 0x07 with Auto mode
 enum FanControlFeatureBitmap : uint32_t {
   FEATURE_MULTI_SPEED = 0x01,       // Bit 0: Supports SpeedMax, SpeedSetting, SpeedCurrent
   FEATURE_AUTO = 0x02,              // Bit 1: Supports automatic mode
@@ -37,23 +40,50 @@ enum FanControlFeatureBitmap : uint32_t {
   FEATURE_AIRFLOW_DIRECTION = 0x20  // Bit 5: Supports airflow direction
 };
 
+// Manufacturer specific FanControl attribute (test VID 0xFFF1): true while the tachometer reports a stall
+#ifndef FAN_ATTR_STALLED
+#define FAN_ATTR_STALLED 0xFFF10000
+#endif
+
+// Speed and oscillation targets applied together as one actuation (e.g. a scene recall)
+struct FanActuationPlan {
+  bool hasSpeed = false;
+  uint8_t speed = 0;
+  bool hasRock = false;
+  uint8_t rockSetting = 0;
+};
+
 // Callback types
 typedef std::function<bool(uint8_t speed)> SpeedChangeCallback;
 typedef std::function<bool(uint8_t rockSetting)> RockChangeCallback;
+typedef std::function<bool(const FanActuationPlan &plan)> ActuationPlanCallback;
 
 class MatterMultiSpeedFan : public MatterEndPoint {
 public:
   MatterMultiSpeedFan();
   ~MatterMultiSpeedFan();
 
+  static constexpr uint16_t kNotBridged = 0xFFFF;
+
   // Initialize the fan with multi-speed support and rock capability
   // speedMax: Maximum speed level (default 3 for Off, Low, Medium, High)
   // rockSupport: Bitmap of supported rock directions (default: left-right)
-  bool begin(uint8_t speedMax = 3, uint8_t rockSupport = ROCK_LEFT_RIGHT);
+  // aggregatorEndpointId: create a bridged fan under this Aggregator endpoint instead of a
+  //   top-level one; may be called after Matter.begin() (with the CHIP stack lock held)
+  bool begin(uint8_t speedMax = 3, uint8_t rockSupport = ROCK_LEFT_RIGHT, uint16_t aggregatorEndpointId = kNotBridged);
 
-  // Cleanup
+  // Destroy the endpoint and give its RAM back (with the CHIP stack lock held once Matter runs);
+  // begin() may be called again afterwards
   void end();
 
+  // Endpoint RAM (see FanEndpointArena)
+  // useArena() must be called before begin(): construction and teardown then go through the arena
+  void useArena(FanEndpointArena *arena);
+  // Clusters, attributes and callbacks of the endpoint, with the heap its construction took
+  bool getFootprint(FanEndpointFootprint &footprint);
+  // Heap estimate for one fan endpoint, before any exists
+  static size_t estimateEndpointBytes(bool bridged);
+
   // Speed control methods
   bool setSpeed(uint8_t speed, bool performUpdate = true);
   uint8_t getSpeed();
@@ -70,9 +100,75 @@ public:
   uint8_t getRockSupport();
   bool isRocking();
 
+  // Combined speed and oscillation change
+  // The hardware gets one onActuationPlan() callback (or the speed and rock callbacks back to back
+  // when none is registered) and all affected attributes are stored first, then reported as one batch
+  bool applyActuationPlan(FanActuationPlan plan);
+
+  // Speed level <-> percent conversion as defined by the FanControl cluster:
+  // percent = floor(speed * 100 / speedMax), speed = ceil(percent * speedMax / 100)
+  uint8_t speedToPercent(uint8_t speed);
+  uint8_t percentToSpeed(uint8_t percent);
+
+  // FanMode support
+  // FanModeSequence follows speedMax; every mode write resolves to one speed level, except Auto.
+  // Low is the highest speed at or below 33 percent (at least 1), Medium the highest at or below
+  // 66 percent; fanModeForSpeed() uses the same levels, so a mode write reads back as that mode.
+  uint8_t getFanModeSequence();
+  bool isFanModeSupported(uint8_t fanMode);
+  uint8_t speedForFanMode(uint8_t fanMode);
+  uint8_t fanModeForSpeed(uint8_t speed);
+
+  // Auto mode support (see FanAutoController)
+  // setAutoSupported() must be called before begin(): it adds the Auto feature and the *Auto
+  // FanModeSequence. FanMode Auto (or Smart) then hands the speed to applyAutoSpeed(); any other
+  // speed change - a controller write, a scene, setSpeed() - leaves Auto mode.
+  void setAutoSupported(bool supported);
+  bool isAutoSupported();
+  bool isAutoMode();
+  bool setAutoMode(bool enable);
+  // Speed chosen by the Auto mode controller; FanMode stays Auto
+  bool applyAutoSpeed(uint8_t speed);
+
+  // Measured speed (tachometer) support
+  // When enabled, SpeedCurrent/PercentCurrent are no longer copied from the settings
+  // and only change through setMeasuredSpeed()
+  void useMeasuredSpeed(bool enable);
+  bool isUsingMeasuredSpeed();
+  // Reports are rate limited: a new SpeedCurrent is reported at most every minIntervalMs,
+  // and PercentCurrent only when it moved by at least percentDeadband
+  void setMeasuredReportLimits(uint32_t minIntervalMs, uint8_t percentDeadband);
+  bool setMeasuredSpeed(uint8_t speedCurrent, uint8_t percentCurrent);
+  // Stalled (FAN_ATTR_STALLED) is reported at once, outside the report window, so controllers
+  // can tell a stalled motor from one that is simply off (both read SpeedCurrent=0)
+  bool setStalled(bool stalled);
+  bool isStalled();
+
+  // Report scheduling (see FanReportScheduler)
+  // Derived attributes (FanMode, Percent*, SpeedCurrent, ...) are reported in one batch once the
+  // hardware has settled, or after at most windowMs; 0 reports every change immediately (default)
+  void setReportWindow(uint32_t windowMs);
+  // False while the hardware is still moving towards the last actuation plan
+  void setActuationSettled(bool settled);
+  // Flush due reports; call from loop()
+  void loop();
+  FanReportScheduler &getReportScheduler();
+
+  // Time spent in attributeChangeCB() per accepted or rejected write, on the CHIP task.
+  // Updated with the CHIP stack lock held, so it is copied and reset under the same lock
+  FanTimingStats getCallbackTiming();
+  void resetCallbackTiming();
+  // Called by the attribute callback, which already holds the lock
+  void addCallbackTiming(uint32_t us);
+
   // Callbacks
   void onChangeSpeed(SpeedChangeCallback cb);
   void onChangeRock(RockChangeCallback cb);
+  void onActuationPlan(ActuationPlanCallback cb);
+
+  // Bridged fans: BridgedDeviceBasicInformation Reachable follows the bus device
+  bool isBridged();
+  bool setReachable(bool reachable);
 
   // Update the accessory state
   void updateAccessory();
@@ -92,9 +188,47 @@ protected:
   uint8_t speedMax = 3;              // Maximum speed level
   uint8_t rockSupport = 0;           // Bitmap of supported rock directions
   uint8_t currentRockSetting = 0;    // Current rock setting bitmap
+  uint8_t fanModeSequence = 0;       // FanModeSequenceEnum advertised to controllers
+  bool autoSupported = false;        // Auto feature advertised
+  bool autoMode = false;             // FanMode is Auto
+  bool bridged = false;              // Endpoint lives under an Aggregator
+
+  bool measuredSpeed = false;        // SpeedCurrent/PercentCurrent come from a tachometer
+  uint8_t measuredSpeedCurrent = 0;  // Last reported SpeedCurrent
+  uint8_t measuredPercentCurrent = 0; // Last reported PercentCurrent
+  uint32_t measuredMinIntervalMs = 1000;
+  uint8_t measuredPercentDeadband = 5;
+  unsigned long lastMeasuredReportTime = 0;
+  bool stalled = false;              // Last reported FAN_ATTR_STALLED
 
   SpeedChangeCallback _onChangeSpeedCB = nullptr;
   RockChangeCallback _onChangeRockCB = nullptr;
+  ActuationPlanCallback _onActuationPlanCB = nullptr;
+
+  FanReportScheduler reports;
+  FanTimingStats callbackTiming;    // Only touched with the CHIP stack lock held
+
+  FanEndpointArena *arena = nullptr;
+  int32_t constructionBytes = 0;     // Heap taken by begin(), measured by the arena
+
+  static const uint32_t kNoWrittenAttribute = 0xFFFFFFFF;
+
+  // Run the application callbacks for a plan, then store and report all derived attributes
+  // except writtenAttributeId, which the framework stores once the write is accepted
+  bool actuate(FanActuationPlan plan, uint32_t writtenAttributeId);
+  // Clamp a plan to the fan's capabilities and drop what would not change; false if nothing is left
+  bool normalizePlan(FanActuationPlan &plan);
+  // Store the attributes of a plan the hardware already follows and schedule their reports
+  bool storePlan(const FanActuationPlan &plan, uint32_t writtenAttributeId);
+  bool sequenceHasMedium();
+  // Highest speed level whose percent is at or below percent, at least 1
+  uint8_t highestSpeedAtPercent(uint8_t percent);
+  bool createEndpoint(uint16_t aggregatorEndpointId);
+  // Enter or leave Auto mode; FanMode is stored and reported unless it is the written attribute
+  bool setAutoModeState(bool enable, uint32_t writtenAttributeId);
+  esp_matter::endpoint_t *createBridgedEndpoint(esp_matter::node_t *node, esp_matter::endpoint::fan::config_t *config, uint16_t aggregatorEndpointId);
+  // Destroy an endpoint whose setup failed and forget its id
+  void discardEndpoint(esp_matter::node_t *node, esp_matter::endpoint_t *endpoint);
 };
 
 #endif // MATTER_MULTI_SPEED_FAN_H
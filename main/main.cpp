@@ -5,6 +5,30 @@
 #include <WiFi.h>
 #endif
 #include <MatterDeviceProvider.h>
+#include <esp_heap_caps.h>
+#include <FanBenchmark.h>
+#include <FanEndpointArena.h>
+#include <FanEnergyMeter.h>
+#include <FanIdlePolicy.h>
+#include <FanIdleSleep.h>
+#include <FanPowerModel.h>
+#include <FanScenes.h>
+#include <FanUsageHistory.h>
+#ifdef FAN_TACHOMETER_PIN
+#include <FanTachometer.h>
+#endif
+#if defined(FAN_BENCH_SPEED_LOOPBACK_PIN) && defined(FAN_BENCH_OSC_LOOPBACK_PIN)
+#include <FanPulseCapture.h>
+#endif
+#if defined(FAN_AUTO_ADC_PIN) || defined(FAN_AUTO_TMP102)
+#define FAN_AUTO_MODE
+#include <FanAutoController.h>
+#include <FanTemperatureSensors.h>
+#endif
+#ifdef FAN_BRIDGE_MODE
+#include <FanBridge.h>
+#include <FanBusSerial.h>
+#endif
 
 MatterMultiSpeedFan SmartFan;
 
@@ -19,6 +43,11 @@ enum CommissioningState {
 CommissioningState commissioningState = COMMISSIONING_NOT_STARTED;
 unsigned long lastCommissioningMessageTime = 0;
 
+// Local control runs from boot; input changes made while not commissioned only move the local
+// state and are pushed to Matter as one reconciled delta when commissioning completes
+uint32_t offlineSpeedChanges = 0;
+uint32_t offlineOscillationChanges = 0;
+
 
 #if CONFIG_ENABLE_MATTER_OVER_WIFI
 // WiFi is manually set and started
@@ -50,6 +79,150 @@ bool isOscillationControlPulsing = false;   // True when pulsing oscillation pin
 unsigned long oscillationControlPulseStartTime = 0;
 const unsigned long OSCILLATION_PULSE_DURATION = 200;  // Pulse duration in ms
 
+// Energy metering from the per-speed power model
+FanPowerModel fanPowerModel;
+FanEnergyMeter fanEnergyMeter;
+
+// Scenes Management: a recall moves speed and oscillation in one actuation
+FanScenes fanScenes;
+
+// Usage history in the spiffs partition, readable over serial and the usage vendor cluster
+FanUsageHistory usageHistory;
+
+// Derived attributes are reported in one batch once the pulse trains are done, at most this much later
+#ifndef FAN_REPORT_WINDOW_MS
+#define FAN_REPORT_WINDOW_MS 1000
+#endif
+
+// Idle policy: loop() blocks, with automatic light sleep, while no actuation or report is pending
+#ifndef FAN_IDLE_SLEEP
+#define FAN_IDLE_SLEEP 1
+#endif
+#ifndef FAN_IDLE_MAX_SLEEP_MS
+#define FAN_IDLE_MAX_SLEEP_MS 1000  // Bounds the latency of serial commands and commissioning checks
+#endif
+#ifndef FAN_IDLE_CONSOLE_AWAKE_MS
+#define FAN_IDLE_CONSOLE_AWAKE_MS 30000  // No light sleep this long after the last serial input
+#endif
+FanIdlePolicy idlePolicy;
+#if FAN_IDLE_SLEEP
+FanIdleSleep idleSleep;
+#endif
+unsigned long lastConsoleInputTime = 0;
+bool consoleInputSeen = false;
+
+#ifdef FAN_AUTO_MODE
+// Auto mode: the speed follows the room temperature (thresholds in 0.01 C)
+#ifndef FAN_AUTO_START_TEMPERATURE
+#define FAN_AUTO_START_TEMPERATURE 2600
+#endif
+#ifndef FAN_AUTO_STEP_TEMPERATURE
+#define FAN_AUTO_STEP_TEMPERATURE 200
+#endif
+#ifndef FAN_AUTO_HYSTERESIS
+#define FAN_AUTO_HYSTERESIS 50
+#endif
+#ifndef FAN_AUTO_MIN_DWELL_MS
+#define FAN_AUTO_MIN_DWELL_MS 300000
+#endif
+#ifndef FAN_AUTO_SAMPLE_INTERVAL_MS
+#define FAN_AUTO_SAMPLE_INTERVAL_MS 10000
+#endif
+#ifdef FAN_AUTO_ADC_PIN
+FanAdcSensor temperatureSensor(FAN_AUTO_ADC_PIN);
+#else
+#ifndef FAN_AUTO_SDA_PIN
+#define FAN_AUTO_SDA_PIN SDA
+#endif
+#ifndef FAN_AUTO_SCL_PIN
+#define FAN_AUTO_SCL_PIN SCL
+#endif
+FanTmp102Sensor temperatureSensor(Wire);
+#endif
+FanAutoController fanAuto;
+#endif
+
+#ifdef FAN_BRIDGE_MODE
+// Bridge mode: fans on a UART/RS-485 bus appear as bridged endpoints under an Aggregator
+#ifndef FAN_BUS_BAUD
+#define FAN_BUS_BAUD 115200
+#endif
+#ifndef FAN_BUS_DE_PIN
+#define FAN_BUS_DE_PIN -1
+#endif
+FanBusSerial fanBusSerial(Serial1);
+FanBridge fanBridge;
+#endif
+
+// Endpoint arena: heap for every fan endpoint the enabled features create, claimed at boot
+#ifdef FAN_BRIDGE_MODE
+#define FAN_ARENA_ENDPOINTS (1 + FAN_BUS_MAX_DEVICES)
+#define FAN_ARENA_BRIDGED true
+#else
+#define FAN_ARENA_ENDPOINTS 1
+#define FAN_ARENA_BRIDGED false
+#endif
+FanEndpointArena endpointArena;
+
+// On-device benchmark - "bench" command or three BOOT button presses
+// The pulse widths are only measured when both control outputs are wired to a loopback input
+FanBenchmark benchmark;
+#if defined(FAN_BENCH_SPEED_LOOPBACK_PIN) && defined(FAN_BENCH_OSC_LOOPBACK_PIN)
+FanPulseCapture pulseCapture;
+#endif
+
+#ifdef FAN_TACHOMETER_PIN
+// Optional tachometer: SpeedCurrent/PercentCurrent follow the measured RPM
+#ifndef FAN_TACHOMETER_PULSES_PER_REV
+#define FAN_TACHOMETER_PULSES_PER_REV 2
+#endif
+#ifndef FAN_TACHOMETER_RPM_LOW
+#define FAN_TACHOMETER_RPM_LOW 800
+#endif
+#ifndef FAN_TACHOMETER_RPM_MEDIUM
+#define FAN_TACHOMETER_RPM_MEDIUM 1100
+#endif
+#ifndef FAN_TACHOMETER_RPM_HIGH
+#define FAN_TACHOMETER_RPM_HIGH 1400
+#endif
+FanTachometer tachometer;
+const uint16_t FAN_TACHOMETER_SPEED_PROFILE[] = {0, FAN_TACHOMETER_RPM_LOW, FAN_TACHOMETER_RPM_MEDIUM, FAN_TACHOMETER_RPM_HIGH};
+const uint32_t FAN_STALL_TIMEOUT = 5000;  // Spin-up time allowed before a stall is reported
+#endif
+
+// Set a new target speed - pulseFanSpeedControl() handles the pulsing
+void startFanSpeedChange(uint8_t newSpeed) {
+  if (xSemaphoreTake(fanSpeedMutex, 5000) == pdTRUE) {
+    expectedFanSpeed = newSpeed;
+    Serial.printf("Expected speed set to %d\r\n", expectedFanSpeed);
+    if(isFanSpeedControlPulsing == false && expectedFanSpeed != currentFanSpeed) {
+      // Start pulsing process
+      isFanSpeedControlPulsing = true;
+    }
+    xSemaphoreGive(fanSpeedMutex);
+  }
+#if FAN_IDLE_SLEEP
+  idleSleep.wake();  // Called from the Matter task while loop() may be waiting
+#endif
+}
+
+// Set a new oscillation target - only pulse if the oscillation state actually changes
+void startOscillationChange(bool newOscillationState) {
+  if (xSemaphoreTake(fanOscillationMutex, 5000) == pdTRUE) {
+    expectedOscillationState = newOscillationState;
+    if (isOscillationControlPulsing == false && expectedOscillationState != currentOscillationState) {
+      Serial.printf("Pulsing oscillation control pin to toggle oscillation\r\n");
+      isOscillationControlPulsing = true;
+      digitalWrite(FAN_OSCILLATION_CONTROL_PIN, HIGH);
+      oscillationControlPulseStartTime = millis();
+    }
+    xSemaphoreGive(fanOscillationMutex);
+  }
+#if FAN_IDLE_SLEEP
+  idleSleep.wake();
+#endif
+}
+
 // Matter Protocol Callback - Speed changed from controller
 bool onSpeedChange(uint8_t newSpeed) {
   Serial.printf("Matter Callback :: New Speed Level = %d ", newSpeed);
@@ -63,16 +236,7 @@ bool onSpeedChange(uint8_t newSpeed) {
     default:               Serial.printf("(LEVEL %d)\r\n", newSpeed); break;
   }
 
-  if (xSemaphoreTake(fanSpeedMutex, 5000) == pdTRUE) {
-    // Set the expected speed - the state machine will handle pulsing
-    expectedFanSpeed = newSpeed;
-    Serial.printf("Expected speed set to %d\r\n", expectedFanSpeed);
-    if(isFanSpeedControlPulsing == false && expectedFanSpeed != currentFanSpeed) {
-      // Start pulsing process
-      isFanSpeedControlPulsing = true;
-    }
-    xSemaphoreGive(fanSpeedMutex);
-  }
+  startFanSpeedChange(newSpeed);
 
   // Return true to indicate success
   return true;
@@ -90,22 +254,31 @@ bool onRockChange(uint8_t rockSetting) {
     Serial.println("(OSCILLATION OFF)");
   }
 
-  // Only pulse if oscillation state actually changed
-  if (xSemaphoreTake(fanOscillationMutex, 5000) == pdTRUE) {
-    expectedOscillationState = newOscillationState; // Update current oscillation state
-    Serial.printf("Pulsing oscillation control pin to toggle oscillation\r\n");
-    if (isOscillationControlPulsing == false && expectedOscillationState != currentOscillationState) {
-      isOscillationControlPulsing = true;
-      digitalWrite(FAN_OSCILLATION_CONTROL_PIN, HIGH);
-      oscillationControlPulseStartTime = millis();
-    }
-    xSemaphoreGive(fanOscillationMutex);
-  }
+  startOscillationChange(newOscillationState);
 
   // Return true to indicate success
   return true;
 }
 
+// Matter Actuation Plan - the single path from Matter to the hardware
+// Every SpeedSetting, RockSetting, FanMode and PercentSetting write and every scene recall
+// arrives here as one plan; onSpeedChange()/onRockChange() only run when no plan callback is set
+bool onActuationPlan(const FanActuationPlan &plan) {
+  Serial.printf("Matter Callback :: Actuation Plan: Speed = %d%s, Rock = %d%s\r\n",
+                plan.speed, plan.hasSpeed ? "" : " (unchanged)", plan.rockSetting, plan.hasRock ? "" : " (unchanged)");
+
+  // Both state machines start in this same call and then run side by side in loop(),
+  // so the oscillation pulse overlaps the speed pulse train instead of following it
+  if (plan.hasSpeed) {
+    startFanSpeedChange(plan.speed);
+  }
+  if (plan.hasRock) {
+    startOscillationChange(plan.rockSetting != 0);
+  }
+
+  return true;
+}
+
 /*
   Print Periodically the current status of the Fan Matter Accessory
   Speed, On/Off state, Rock/Oscillation state
@@ -114,8 +287,40 @@ unsigned long lastPrintingTime = 0;
 void printStatusPeriodically() {
   if (millis() - lastPrintingTime >= 10000) { // Every 10 seconds
     lastPrintingTime = millis();
-    Serial.printf("Status :: Speed = %d, OnOff = %d, Rock = %d\r\n",
-                  SmartFan.getSpeed(), SmartFan.getOnOff(), SmartFan.getRockSetting());
+    if (commissioningState == COMMISSIONING_DONE) {
+      Serial.printf("Status :: Speed = %d, OnOff = %d, Rock = %d\r\n",
+                    SmartFan.getSpeed(), SmartFan.getOnOff(), SmartFan.getRockSetting());
+    } else {
+      Serial.printf("Status :: Not commissioned, Local Speed = %d, Rock = %d, Offline changes = %lu\r\n",
+                    currentFanSpeed, currentOscillationState, offlineSpeedChanges + offlineOscillationChanges);
+    }
+    // Energy is integrated on speed changes; this existing status tick only catches up long steady periods
+    fanEnergyMeter.sync();
+    Serial.printf("Status :: Power = %lld mW, Energy = %lld mWh\r\n",
+                  fanEnergyMeter.getActivePowerMilliWatts(), fanEnergyMeter.getEnergyMilliWattHours());
+#ifdef FAN_TACHOMETER_PIN
+    Serial.printf("Status :: Measured = %lu RPM (speed %d, %d%%)%s\r\n",
+                  tachometer.getRpm(), tachometer.getMeasuredSpeed(), tachometer.getMeasuredPercent(),
+                  tachometer.isStalled() ? " STALLED" : "");
+#endif
+  }
+}
+
+// Benchmark - Start a run from the physical state the fan is in now
+void startBenchmark() {
+  if (isFanSpeedControlPulsing || isOscillationControlPulsing) {
+    Serial.println("Benchmark :: Fan is still pulsing, try again when it has settled");
+    return;
+  }
+  if (benchmark.start(millis(), currentFanSpeed, currentOscillationState)) {
+    Serial.println("Benchmark :: Running (about 2 s, the fan steps away and back)");
+  }
+}
+
+void handleBenchmark() {
+  benchmark.loop(millis(), !isFanSpeedControlPulsing && !isOscillationControlPulsing);
+  if (benchmark.takeFinished()) {
+    benchmark.printReport(Serial);
   }
 }
 
@@ -139,6 +344,10 @@ void handleDecommission() {
   if (digitalRead(BOOT_BUTTON_PIN) == LOW && !bootButtonState) {
     bootButtonPressTimestamp = millis();
     bootButtonState = true;
+    // Three short presses start the benchmark
+    if (benchmark.onButtonPress(bootButtonPressTimestamp)) {
+      startBenchmark();
+    }
   }
   if (digitalRead(BOOT_BUTTON_PIN) == HIGH) {
     bootButtonState = false;
@@ -163,10 +372,12 @@ void handleDecommission() {
 }
 
 void syncFanSpeedBasedOnExternalInputs() {
+  if (benchmark.isRunning()) {
+    return;  // The benchmark moves the fan away and back; the LED inputs follow with a delay
+  }
   if(xSemaphoreTake(fanSpeedMutex, 0) == pdTRUE) {
     if(!isFanSpeedControlPulsing) {
       uint8_t newSpeedLevel = 0;
-      // Monitor input pins only when commissioned
       if (digitalRead(FAN_SPEED_HIGH_INPUT_PIN) == LOW) {
         newSpeedLevel = 3;
       } else if (digitalRead(FAN_SPEED_MEDIUM_INPUT_PIN) == LOW) {
@@ -178,7 +389,12 @@ void syncFanSpeedBasedOnExternalInputs() {
         Serial.printf("LED Input Pin: Setting speed level to %d\r\n", newSpeedLevel);
         expectedFanSpeed = newSpeedLevel; // Update expected speed for state machine
         currentFanSpeed = newSpeedLevel; // Physical input means fan already at this speed
-        SmartFan.setSpeed(newSpeedLevel, false); // Update Matter state without pulsing
+        fanEnergyMeter.setSpeed(currentFanSpeed);
+        if (commissioningState == COMMISSIONING_DONE) {
+          SmartFan.setSpeed(newSpeedLevel, false); // Update Matter state without pulsing
+        } else {
+          offlineSpeedChanges++;  // Reconciled when commissioning completes
+        }
       }
     }
     xSemaphoreGive(fanSpeedMutex);
@@ -199,6 +415,9 @@ void handleOscillationPulse() {
 }
 
 void syncOscillationBasedOnExternalInput() {
+  if (benchmark.isRunning()) {
+    return;
+  }
   if(xSemaphoreTake(fanOscillationMutex, 0) == pdTRUE) {
     if (!isOscillationControlPulsing) {
       // Read oscillation input pin (LOW = oscillation ON, HIGH = oscillation OFF due to pull-up)
@@ -213,14 +432,362 @@ void syncOscillationBasedOnExternalInput() {
         expectedOscillationState = physicalOscillationState;
 
         // Update Matter state without pulsing (physical input means hardware already changed)
-        uint8_t newRockSetting = physicalOscillationState ? 1 : 0;
-        SmartFan.setRockSetting(newRockSetting, false);
+        if (commissioningState == COMMISSIONING_DONE) {
+          uint8_t newRockSetting = physicalOscillationState ? 1 : 0;
+          SmartFan.setRockSetting(newRockSetting, false);
+        } else {
+          offlineOscillationChanges++;
+        }
       }
     }
     xSemaphoreGive(fanOscillationMutex);
   }
 }
 
+#ifdef FAN_TACHOMETER_PIN
+// Tachometer Callback - Fan stalled or recovered from a stall
+// Controllers see it through the Stalled attribute, the console gets the alarm line
+void onFanStallChange(bool stalled, uint32_t rpm) {
+  SmartFan.setStalled(stalled);
+  if (stalled) {
+    Serial.printf("ALARM :: Fan stalled! Commanded speed = %d, measured %lu RPM\r\n", expectedFanSpeed, rpm);
+  } else {
+    Serial.printf("Fan recovered from stall, measured %lu RPM\r\n", rpm);
+  }
+}
+
+void handleTachometer() {
+  // The tachometer follows the target speed so spin-up is not mistaken for a stall
+  tachometer.setCommandedSpeed(expectedFanSpeed);
+  if (tachometer.update()) {
+    SmartFan.setMeasuredSpeed(tachometer.getMeasuredSpeed(), tachometer.getMeasuredPercent());
+  }
+}
+#endif
+
+// Report Scheduler - Flush the batched reports once the hardware has reached its target
+void handleFanReports() {
+  SmartFan.setActuationSettled(!isFanSpeedControlPulsing && !isOscillationControlPulsing);
+  SmartFan.loop();
+}
+
+#ifdef FAN_AUTO_MODE
+// Auto mode - Samples the temperature at a low rate; the speed only changes when it leaves the band
+void handleAutoMode() {
+  fanAuto.loop();
+}
+
+void printAutoStatus() {
+  int16_t temperature = temperatureSensor.getTemperature();
+  Serial.printf("Auto :: Mode = %s, Temperature = %s%d.%02d C, Samples = %lu, Errors = %lu\r\n",
+                SmartFan.isAutoMode() ? "on" : "off", temperature < 0 ? "-" : "", abs(temperature) / 100,
+                abs(temperature) % 100, temperatureSensor.getSampleCount(), temperatureSensor.getErrorCount());
+  Serial.printf("Auto :: Evaluations = %lu, Speed changes = %lu, Deferred = %lu\r\n", fanAuto.getEvaluationCount(),
+                fanAuto.getSpeedChangeCount(), fanAuto.getDeferredCount());
+}
+#endif
+
+void printEndpointFootprint(MatterMultiSpeedFan &fan) {
+  FanEndpointFootprint footprint;
+  if (!fan.getFootprint(footprint)) {
+    return;
+  }
+  Serial.printf("RAM :: Endpoint %d: Clusters = %d (~%lu B), Attributes = %d (~%lu B), Commands = %d (~%lu B), Callbacks = %d\r\n",
+                footprint.endpointId, footprint.clusterCount, footprint.clusterBytes, footprint.attributeCount,
+                footprint.attributeBytes, footprint.commandCount, footprint.callbackBytes, footprint.callbackCount);
+  Serial.printf("RAM :: Endpoint %d: Construction = %ld B heap, Object = %lu B static\r\n", footprint.endpointId,
+                footprint.heapBytes, footprint.objectBytes);
+}
+
+void printRamReport() {
+  printEndpointFootprint(SmartFan);
+#ifdef FAN_BRIDGE_MODE
+  for (uint8_t address = 1; address <= FAN_BUS_MAX_ADDRESS; address++) {
+    MatterMultiSpeedFan *fan = fanBridge.getFan(address);
+    if (fan != nullptr) {
+      printEndpointFootprint(*fan);
+    }
+  }
+#endif
+  Serial.printf("RAM :: Arena: Endpoints = %d / %d, Used = %u B, Reserved = %u B (%u B per endpoint)\r\n",
+                endpointArena.getEndpointCount(), endpointArena.getCapacity(), (unsigned)endpointArena.getUsedBytes(),
+                (unsigned)endpointArena.getReservedBytes(), (unsigned)endpointArena.getBytesPerEndpoint());
+  Serial.printf("RAM :: Heap: Free = %u B, Largest block = %u B, Minimum free = %u B\r\n",
+                (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+}
+
+void printReportStats() {
+  FanReportScheduler &reports = SmartFan.getReportScheduler();
+  Serial.printf("Reports :: Window = %lu ms, Flushes = %lu, Reported = %lu, Coalesced = %lu, Pending = %d\r\n",
+                reports.getWindow(), reports.getFlushCount(), reports.getReportedCount(), reports.getCoalescedCount(),
+                reports.isPending());
+}
+
+// Idle Policy - Block loop() until the next deadline when nothing needs it at full rate
+void handleIdle() {
+  uint32_t now = millis();
+  idlePolicy.beginCycle(now);
+
+  // Pulse trains and the first pass after commissioning are timed by polling
+  if (isFanSpeedControlPulsing || isOscillationControlPulsing || commissioningState == COMMISSIONING_JUST_COMPLETED ||
+      benchmark.isRunning()) {
+    idlePolicy.keepAwake();
+  }
+  if (Serial.available() > 0) {
+    idlePolicy.keepAwake();
+  }
+#ifdef FAN_BRIDGE_MODE
+  idlePolicy.keepAwake();  // The fan bus is polled every 50 ms
+#endif
+#ifdef FAN_TACHOMETER_PIN
+  if (currentFanSpeed != 0 || expectedFanSpeed != 0) {
+    idlePolicy.keepAwake();  // The pulse counter stops in light sleep
+  }
+#endif
+
+  // Held buttons: the decommission timeout (a release wakes through GPIO)
+  if (bootButtonState) {
+    idlePolicy.wakeAt(bootButtonPressTimestamp + decommissioningTimeout + 1);
+  }
+  if (decommButtonState) {
+    idlePolicy.wakeAt(decommButtonPressTimestamp + decommissioningTimeout + 1);
+  }
+  uint32_t flushTime;
+  if (SmartFan.getReportScheduler().getNextFlushTime(now, flushTime)) {
+    idlePolicy.wakeAt(flushTime);
+  }
+#ifdef FAN_AUTO_MODE
+  if (SmartFan.isAutoSupported()) {
+    idlePolicy.wakeAt(fanAuto.getNextWakeTime());
+  }
+#endif
+  if (commissioningState == COMMISSIONING_WAITING) {
+    idlePolicy.wakeAt(lastCommissioningMessageTime + 5000);
+  }
+  idlePolicy.wakeAt(lastPrintingTime + 10000);
+
+#if FAN_IDLE_SLEEP
+  // Serial input has no wake source: no light sleep while a console is in use
+  bool consoleInUse = consoleInputSeen && millis() - lastConsoleInputTime < FAN_IDLE_CONSOLE_AWAKE_MS;
+#if ARDUINO_USB_CDC_ON_BOOT && ARDUINO_USB_MODE
+  consoleInUse = consoleInUse || Serial.isConnected();
+#endif
+  idleSleep.holdAwake(consoleInUse);
+
+  uint32_t sleepMs = idlePolicy.planSleep();
+  if (sleepMs > 0) {
+    FanWakeReason reason = idleSleep.sleep(sleepMs);
+    idlePolicy.recordSleep(now, millis(), reason);
+  }
+#else
+  idlePolicy.planSleep();  // Statistics only
+#endif
+}
+
+void printIdleStats() {
+  uint32_t now = millis();
+  uint32_t asleepMs = idlePolicy.getAsleepMs();
+  uint32_t awakeMs = idlePolicy.getAwakeMs(now);
+  uint64_t totalMs = (uint64_t)asleepMs + awakeMs;
+  Serial.printf("Idle :: Asleep = %lu ms, Awake = %lu ms (%lu%% asleep), Light sleep = %s\r\n", asleepMs, awakeMs,
+                totalMs > 0 ? (unsigned long)((uint64_t)asleepMs * 100 / totalMs) : 0UL,
+#if FAN_IDLE_SLEEP
+                !idleSleep.isLightSleepEnabled() ? "off" : idleSleep.isHeldAwake() ? "held off (console)" : "on");
+#else
+                "disabled");
+#endif
+  Serial.printf("Idle :: Sleeps = %lu, Wakes: timer = %lu, gpio = %lu, other = %lu, Busy passes = %lu\r\n",
+                idlePolicy.getSleepCount(), idlePolicy.getWakeCount(FAN_WAKE_TIMER), idlePolicy.getWakeCount(FAN_WAKE_GPIO),
+                idlePolicy.getWakeCount(FAN_WAKE_OTHER), idlePolicy.getBusyCycleCount());
+}
+
+// Usage History - Hand the physical state to the history writer (never blocks)
+void handleUsageHistory() {
+  usageHistory.record(currentFanSpeed, currentOscillationState);
+}
+
+void printUsageTotals() {
+  uint32_t operatingSeconds = usageHistory.getOperatingSeconds();
+  Serial.printf("Usage :: Operating %lu h %02lu m, Transitions = %lu, Dropped = %lu\r\n",
+                operatingSeconds / 3600, (operatingSeconds / 60) % 60,
+                usageHistory.getTransitions(), usageHistory.getDroppedEvents());
+  for (uint8_t speed = 0; speed < usageHistory.getLevelCount(); speed++) {
+    uint32_t seconds = usageHistory.getSecondsAtSpeed(speed);
+    Serial.printf("  Speed %d: %lu h %02lu m\r\n", speed, seconds / 3600, (seconds / 60) % 60);
+  }
+  uint32_t rockingSeconds = usageHistory.getRockingSeconds();
+  Serial.printf("  Rocking: %lu h %02lu m (%lu%%)\r\n", rockingSeconds / 3600, (rockingSeconds / 60) % 60,
+                operatingSeconds > 0 ? (unsigned long)((uint64_t)rockingSeconds * 100 / operatingSeconds) : 0UL);
+}
+
+void printUsageTransitions(uint32_t from, uint32_t count) {
+  FanUsageTransition transitions[16];
+  uint32_t next = from;
+  while (count > 0) {
+    size_t read = usageHistory.readTransitions(next, transitions, count < 16 ? count : 16, next);
+    if (read == 0) {
+      break;
+    }
+    for (size_t i = 0; i < read; i++) {
+      Serial.printf("#%lu t=%llus speed=%d rock=%d\r\n", transitions[i].sequence,
+                    transitions[i].operatingMs / 1000, transitions[i].speed, transitions[i].rocking);
+    }
+    count -= read;
+  }
+  Serial.printf("next=%lu\r\n", next);
+}
+
+void printUsageBuckets(FanUsageKind kind, uint32_t from, uint32_t count) {
+  FanUsageBucket buckets[4];
+  uint32_t next = from;
+  while (count > 0) {
+    size_t read = usageHistory.readBuckets(kind, next, buckets, count < 4 ? count : 4, next);
+    if (read == 0) {
+      break;
+    }
+    for (size_t i = 0; i < read; i++) {
+      Serial.printf("%s %lu:", kind == FAN_USAGE_HOURLY ? "hour" : "day", buckets[i].index);
+      for (uint8_t speed = 0; speed < usageHistory.getLevelCount(); speed++) {
+        Serial.printf(" s%d=%lu", speed, buckets[i].secondsAtSpeed[speed]);
+      }
+      Serial.printf(" rock=%lu transitions=%lu\r\n", buckets[i].rockingSeconds, buckets[i].transitions);
+    }
+    count -= read;
+  }
+  Serial.printf("next=%lu\r\n", next);
+}
+
+/*
+  Serial commands (115200 baud, newline terminated)
+    power-cal <speed> <milliwatts>  Store the measured power draw of one speed level
+    power-reset                     Drop the stored power calibration
+    usage                           Print operating time per speed, rocking time and transitions
+    usage-log [from] [count]        Print transitions starting at sequence number <from>
+    usage-hourly [from] [count]     Print hourly rollups starting at operating hour <from>
+    usage-daily [from] [count]      Print daily rollups starting at operating day <from>
+    usage-flush                     Write buffered history to flash now
+    reports                         Print report scheduler statistics
+    ram                             Print the RAM of every endpoint, the endpoint arena and the heap
+    idle                            Print time asleep versus awake and the wake reasons
+    idle-reset                      Restart the idle statistics
+    auto [on|off]                   Print the Auto mode state, or enter/leave Auto mode
+    bench                           Run the on-device benchmark and print a FANBEN report
+  Reads print "next=<n>"; pass it as <from> to continue where the last read stopped.
+*/
+String serialCommandBuffer;
+void handleSerialCommand(const String &command) {
+  if (command.startsWith("power-cal ")) {
+    int speed = 0;
+    unsigned long milliWatts = 0;
+    if (sscanf(command.c_str(), "power-cal %d %lu", &speed, &milliWatts) == 2 && speed >= 0) {
+      if (fanPowerModel.calibrate((uint8_t)speed, (uint32_t)milliWatts)) {
+        Serial.printf("Power calibration stored: speed %d = %lu mW\r\n", speed, milliWatts);
+      }
+    } else {
+      Serial.println("Usage: power-cal <speed> <milliwatts>");
+    }
+  } else if (command == "power-reset") {
+    fanPowerModel.resetCalibration();
+    Serial.println("Power calibration reset to defaults");
+  } else if (command == "usage") {
+    printUsageTotals();
+  } else if (command.startsWith("usage-log") || command.startsWith("usage-hourly") || command.startsWith("usage-daily")) {
+    unsigned long from = 0;
+    unsigned long count = 16;
+    int separator = command.indexOf(' ');
+    if (separator > 0) {
+      sscanf(command.c_str() + separator, "%lu %lu", &from, &count);
+    }
+    if (command.startsWith("usage-log")) {
+      printUsageTransitions(from, count);
+    } else {
+      printUsageBuckets(command.startsWith("usage-hourly") ? FAN_USAGE_HOURLY : FAN_USAGE_DAILY, from, count);
+    }
+  } else if (command == "usage-flush") {
+    usageHistory.flush();
+    Serial.println("Usage history flush requested");
+  } else if (command == "reports") {
+    printReportStats();
+  } else if (command == "ram") {
+    printRamReport();
+  } else if (command == "idle") {
+    printIdleStats();
+  } else if (command == "idle-reset") {
+    idlePolicy.resetStats(millis());
+    Serial.println("Idle statistics reset");
+  } else if (command == "bench") {
+    startBenchmark();
+#ifdef FAN_AUTO_MODE
+  } else if (command == "auto") {
+    printAutoStatus();
+  } else if (command == "auto on" || command == "auto off") {
+    if (!SmartFan.setAutoMode(command == "auto on")) {
+      Serial.println("Auto mode change failed");
+    }
+#endif
+  } else if (command.length() > 0) {
+    Serial.printf("Unknown command: %s\r\n", command.c_str());
+  }
+}
+
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    lastConsoleInputTime = millis();
+    consoleInputSeen = true;
+    char c = (char)Serial.read();
+    if (c == '\n' || c == '\r') {
+      serialCommandBuffer.trim();
+      handleSerialCommand(serialCommandBuffer);
+      serialCommandBuffer = "";
+    } else if (serialCommandBuffer.length() < 64) {
+      serialCommandBuffer += c;
+    }
+  }
+}
+
+/*
+  Push the local state to Matter as one delta
+
+  The control loop has followed the LED inputs since boot without touching the attributes.
+  Only the attributes that differ from the physical state are written, and the report scheduler
+  sends them together, instead of one report per offline input change.
+*/
+void reconcileOfflineChanges() {
+  // Catch up with the inputs first: after a commissioned boot loop() has not read them yet
+  syncFanSpeedBasedOnExternalInputs();
+  syncOscillationBasedOnExternalInput();
+
+  if(xSemaphoreTake(fanSpeedMutex, 0) == pdTRUE) {
+    // A running pulse train was started through SmartFan, which already holds its target
+    if(!isFanSpeedControlPulsing) {
+      uint8_t matterSpeed = SmartFan.getSpeed();
+      if(currentFanSpeed != matterSpeed) {
+        Serial.printf("Reconcile :: Speed %d -> %d (%lu offline input changes)\r\n",
+                      matterSpeed, currentFanSpeed, offlineSpeedChanges);
+        SmartFan.setSpeed(currentFanSpeed, false);
+      }
+    }
+    xSemaphoreGive(fanSpeedMutex);
+  }
+
+  if(xSemaphoreTake(fanOscillationMutex, 0) == pdTRUE) {
+    if(!isOscillationControlPulsing) {
+      bool matterOscillationState = SmartFan.getRockSetting() != 0;
+      if(currentOscillationState != matterOscillationState) {
+        Serial.printf("Reconcile :: Oscillation %s -> %s (%lu offline input changes)\r\n",
+                      matterOscillationState ? "ON" : "OFF", currentOscillationState ? "ON" : "OFF",
+                      offlineOscillationChanges);
+        SmartFan.setRockSetting(currentOscillationState ? ROCK_LEFT_RIGHT : 0, false);
+      }
+    }
+    xSemaphoreGive(fanOscillationMutex);
+  }
+
+  offlineSpeedChanges = 0;
+  offlineOscillationChanges = 0;
+}
+
 void handleCommissioning() {
   switch (commissioningState) {
     case COMMISSIONING_NOT_STARTED:
@@ -258,59 +825,11 @@ void handleCommissioning() {
       break;
 
     case COMMISSIONING_JUST_COMPLETED:
-      // Initialize state once after commissioning completes
+      // Bring Matter up to date once after commissioning completes (or after a commissioned boot)
       Serial.printf("Initial State :: Speed = %d, OnOff = %d, Rock = 0x%02X\r\n",
                     SmartFan.getSpeed(), SmartFan.getOnOff(), SmartFan.getRockSetting());
       SmartFan.updateAccessory();
-
-      if(xSemaphoreTake(fanSpeedMutex, 0) == pdTRUE) {
-        if(!isFanSpeedControlPulsing) {
-          uint8_t matterSpeed = SmartFan.getSpeed();
-          currentFanSpeed = matterSpeed;
-
-          uint8_t newSpeedLevel = 0;
-          // Initialize input pin states
-          if (digitalRead(FAN_SPEED_HIGH_INPUT_PIN) == LOW) {
-            newSpeedLevel = 3;
-          } else if (digitalRead(FAN_SPEED_MEDIUM_INPUT_PIN) == LOW) {
-            newSpeedLevel = 2;
-          } else if (digitalRead(FAN_SPEED_LOW_INPUT_PIN) == LOW) {
-            newSpeedLevel = 1;
-          }
-
-          if(currentFanSpeed != newSpeedLevel) {
-            Serial.printf("LED Input Pin: Setting speed level to %d\r\n", newSpeedLevel);
-            expectedFanSpeed = newSpeedLevel;
-            currentFanSpeed = newSpeedLevel;
-            SmartFan.setSpeed(newSpeedLevel, false);
-          } else {
-            expectedFanSpeed = matterSpeed;
-            currentFanSpeed = matterSpeed;
-          }
-        }
-        xSemaphoreGive(fanSpeedMutex);
-      }
-
-      if(xSemaphoreTake(fanOscillationMutex, 0) == pdTRUE) {
-        // Initialize oscillation state
-        uint8_t matterRockSetting = SmartFan.getRockSetting();
-        bool currentOscillationState = matterRockSetting != 0;
-
-        // Check physical oscillation input pin
-        bool physicalOscillationState = (digitalRead(FAN_OSCILLATION_INPUT_PIN) == LOW);
-
-        if (currentOscillationState != physicalOscillationState) {
-          Serial.printf("Oscillation Input Pin: Setting oscillation to %s\r\n",
-                          physicalOscillationState ? "ON" : "OFF");
-          currentOscillationState = physicalOscillationState;
-          expectedOscillationState = physicalOscillationState;
-          uint8_t newRockSetting = physicalOscillationState ? ROCK_LEFT_RIGHT : 0;
-          SmartFan.setRockSetting(newRockSetting, false);
-        } else {
-          expectedOscillationState = currentOscillationState; 
-        }
-        xSemaphoreGive(fanOscillationMutex);
-      }
+      reconcileOfflineChanges();
 
       Serial.println("Matter Node is commissioned and connected to the network. Ready for use.");
       commissioningState = COMMISSIONING_DONE;
@@ -362,6 +881,7 @@ void pulseFanSpeedControl() {
           // Pulsing complete - update current speed
           if (xSemaphoreTake(fanSpeedMutex, 0) == pdTRUE) {
             currentFanSpeed = (currentFanSpeed + 1) % 4; // Cycle through 0-3
+            fanEnergyMeter.setSpeed(currentFanSpeed);
             uint8_t pulsesNeeded = (expectedFanSpeed - currentFanSpeed + 4) % 4;
 
             if (pulsesNeeded > 0) {
@@ -387,6 +907,9 @@ void setup() {
   fanSpeedMutex = xSemaphoreCreateMutex();
   fanOscillationMutex = xSemaphoreCreateMutex();
 
+  // Claim the endpoint heap first, before WiFi and Matter break it up
+  endpointArena.begin(FAN_ARENA_ENDPOINTS, MatterMultiSpeedFan::estimateEndpointBytes(FAN_ARENA_BRIDGED));
+
   // Initialize decommission buttons (both active LOW with pull-up)
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
   pinMode(DECOMMISSION_BUTTON_PIN, INPUT_PULLUP);
@@ -439,14 +962,80 @@ void setup() {
     Serial.println("===========================================");
   #endif
 
+#ifdef FAN_AUTO_MODE
+  // Auto mode is only advertised when the temperature sensor answers
+#ifdef FAN_AUTO_TMP102
+  Wire.begin(FAN_AUTO_SDA_PIN, FAN_AUTO_SCL_PIN);
+#endif
+  temperatureSensor.setSampleInterval(FAN_AUTO_SAMPLE_INTERVAL_MS);
+  SmartFan.setAutoSupported(temperatureSensor.begin());
+#endif
+
   // Initialize Matter Multi-Speed Fan
   // speedMax = 3 (0=Off, 1=Low, 2=Medium, 3=High)
   // rockSupport = ROCK_LEFT_RIGHT (supports left-right oscillation)
+  SmartFan.useArena(&endpointArena);
   SmartFan.begin(3, ROCK_LEFT_RIGHT);
 
   // Register callbacks
   SmartFan.onChangeSpeed(onSpeedChange);
   SmartFan.onChangeRock(onRockChange);
+  SmartFan.onActuationPlan(onActuationPlan);
+  SmartFan.setReportWindow(FAN_REPORT_WINDOW_MS);
+
+#ifdef FAN_TACHOMETER_PIN
+  // Report the measured speed instead of echoing SpeedSetting
+  if (tachometer.begin(FAN_TACHOMETER_PIN, FAN_TACHOMETER_PULSES_PER_REV)) {
+    tachometer.setSpeedProfile(FAN_TACHOMETER_SPEED_PROFILE, 3);
+    tachometer.setStallDetection(FAN_TACHOMETER_RPM_LOW / 4, FAN_STALL_TIMEOUT);
+    tachometer.onStallChange(onFanStallChange);
+    SmartFan.useMeasuredSpeed(true);
+  }
+#endif
+
+#ifdef FAN_AUTO_MODE
+  if (SmartFan.isAutoSupported()) {
+    FanAutoConfig autoConfig;
+    autoConfig.startTemperature = FAN_AUTO_START_TEMPERATURE;
+    autoConfig.stepTemperature = FAN_AUTO_STEP_TEMPERATURE;
+    autoConfig.hysteresis = FAN_AUTO_HYSTERESIS;
+    autoConfig.minDwellMs = FAN_AUTO_MIN_DWELL_MS;
+    fanAuto.begin(SmartFan, temperatureSensor, autoConfig);
+  }
+#endif
+
+  // Benchmark: drives the same pulse state machines as a controller write
+#if defined(FAN_BENCH_SPEED_LOOPBACK_PIN) && defined(FAN_BENCH_OSC_LOOPBACK_PIN)
+  const uint8_t loopbackPins[] = {FAN_BENCH_SPEED_LOOPBACK_PIN, FAN_BENCH_OSC_LOOPBACK_PIN};
+  pulseCapture.begin(loopbackPins, sizeof(loopbackPins));
+  benchmark.begin(SmartFan, &pulseCapture, 0, 1);
+#else
+  benchmark.begin(SmartFan, nullptr, 0, 0);
+#endif
+  benchmark.onSpeedChange(startFanSpeedChange);
+  benchmark.onOscillationChange(startOscillationChange);
+  benchmark.setNominalWidths(200, 100, OSCILLATION_PULSE_DURATION);
+
+  // Electrical Power/Energy Measurement on the fan endpoint, fed by the calibrated power model
+  fanPowerModel.begin(3);
+  fanEnergyMeter.begin(SmartFan, &fanPowerModel);
+
+  // Scenes Management on the fan endpoint (stores speed, percent and rock together)
+  fanScenes.begin(SmartFan);
+
+  // Usage history: restore the checkpoint and expose it through the usage vendor cluster
+  if (usageHistory.begin(3)) {
+    usageHistory.addCluster(SmartFan);
+  }
+
+#ifdef FAN_BRIDGE_MODE
+  // Bridged fans are added at runtime as they are discovered on the bus
+  if (fanBusSerial.begin(FAN_BUS_BAUD, FAN_BUS_RX_PIN, FAN_BUS_TX_PIN, FAN_BUS_DE_PIN)) {
+    fanBridge.setReportWindow(FAN_REPORT_WINDOW_MS);
+    fanBridge.setArena(&endpointArena);
+    fanBridge.begin(fanBusSerial);
+  }
+#endif
 
   // Matter beginning - Last step, after all EndPoints are initialized
   Matter.begin();
@@ -455,6 +1044,9 @@ void setup() {
   // sets up default providers. Our Set*Provider() calls override them.
   initMatterDeviceProviders();
 
+  // The scene table only exists once the data model is up
+  fanScenes.registerHandler();
+
   // This may be a restart of a already commissioned Matter accessory
   if (Matter.isDeviceCommissioned()) {
     Serial.println("Matter Node is commissioned and connected to the network. Ready for use.");
@@ -467,22 +1059,52 @@ void setup() {
     // Set commissioning state to DONE since already commissioned
     commissioningState = COMMISSIONING_JUST_COMPLETED;
   }
+
+  // Idle policy: wake on the LED inputs and the buttons, everything else is a deadline
+  idlePolicy.setSleepLimits(5, FAN_IDLE_MAX_SLEEP_MS);
+#if FAN_IDLE_SLEEP
+  const uint8_t wakePins[] = {FAN_SPEED_LOW_INPUT_PIN, FAN_SPEED_MEDIUM_INPUT_PIN, FAN_SPEED_HIGH_INPUT_PIN,
+                              FAN_OSCILLATION_INPUT_PIN, BOOT_BUTTON_PIN, DECOMMISSION_BUTTON_PIN};
+  idleSleep.begin(wakePins, sizeof(wakePins));
+#endif
+  idlePolicy.resetStats(millis());
 }
 
 void loop() {
   // Non-blocking commissioning handler
   handleCommissioning();
 
-  // Only run these functions when commissioned
-  if (commissioningState == COMMISSIONING_DONE) {
-    pulseFanSpeedControl();
-    syncFanSpeedBasedOnExternalInputs();
+  handleSerialCommands();
 
-    handleOscillationPulse();
-    syncOscillationBasedOnExternalInput();
+#ifdef FAN_BRIDGE_MODE
+  // The bus keeps running while commissioning so bridged fans are ready when it completes
+  fanBridge.loop();
+#endif
 
-    handleDecommission();
-    
-    printStatusPeriodically();
-  }
+  // Control and input handling run regardless of commissioning: the fan responds from boot
+  pulseFanSpeedControl();
+  syncFanSpeedBasedOnExternalInputs();
+
+  handleOscillationPulse();
+  syncOscillationBasedOnExternalInput();
+
+#ifdef FAN_AUTO_MODE
+  handleAutoMode();
+#endif
+
+  handleFanReports();
+
+#ifdef FAN_TACHOMETER_PIN
+  handleTachometer();
+#endif
+
+  handleUsageHistory();
+
+  handleBenchmark();
+
+  handleDecommission();
+
+  printStatusPeriodically();
+
+  handleIdle();
 }
\ No newline at end of file